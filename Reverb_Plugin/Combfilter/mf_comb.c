@@ -1,5 +1,7 @@
 #include "mf_comb.h"
 #include "math.h"
+#include "mf_kernels.h"
+#include <string.h>
 
 mf_comb *mf_comb_new()
 {
@@ -7,6 +9,13 @@ mf_comb *mf_comb_new()
     x-> delay = 0;
     x-> counter = 1;
     x-> gain = 1;
+    x-> modDepth = 0;
+    x-> modPhase = 0;
+    x-> modIncrement = 0;
+    x-> modOffset = 0;
+    x-> modStep = 0;
+    x-> modLeft = 0;
+    x-> half = false;
     return x;
 }
 
@@ -17,7 +26,7 @@ void mf_comb_free(mf_comb *x)
 
 void mf_comb_setDelay(mf_comb *x, int delay)
 {
-    x->delay = delay/2;
+    x->delay = delay/2 < 2000 ? delay/2 : 2000;
 }
 
 void mf_comb_setGain(mf_comb *x, float t60, float fs)
@@ -25,26 +34,252 @@ void mf_comb_setGain(mf_comb *x, float t60, float fs)
     x->gain = pow(10,(-3*x->delay)/(t60*fs));
 }
 
+/* parabolic sine approximation, phase normalized to [0, 1) */
+static float mf_comb_lfo(float phase)
+{
+    float t = 2 * phase - 1;
+    return 4 * t * (1 - fabsf(t));
+}
+
+void mf_comb_setModulation(mf_comb *x, float depth, float rate, float phase, float fs)
+{
+    float maxDepth = (x->delay - 5) / 2.f;
+    if (depth > maxDepth) depth = maxDepth;
+    if (depth < 0) depth = 0;
+    x->modDepth = depth;
+    x->modPhase = phase - floorf(phase);
+    x->modIncrement = rate / fs;
+    x->modOffset = 1 + depth * (1 + mf_comb_lfo(x->modPhase));
+    x->modStep = 0;
+    x->modLeft = 0;
+
+    /* the mirror behind the line is only kept up to date while it is modulated */
+    if (x->delay > 0 && x->delay <= 2000)
+    {
+        size_t size = x->half ? sizeof(uint16_t) : sizeof(float);
+        int n = x->delay < MF_COMB_GUARD ? x->delay : MF_COMB_GUARD;
+        memcpy((char *)x->buffer + x->delay * size, x->buffer, n * size);
+    }
+}
+
+void mf_comb_setHalf(mf_comb *x, bool on)
+{
+    float chunk[256];
+    uint16_t halves[256];
+
+    if (on == x->half)
+        return;
+
+    /* in place: a half sample never overlaps a float that is still to be read, going
+       forward, and a float never overlaps a half still to be read, going backward */
+    if (on)
+    {
+        for (int i = 0; i < 2000 + MF_COMB_GUARD; i += 256)
+        {
+            int n = 2000 + MF_COMB_GUARD - i < 256 ? 2000 + MF_COMB_GUARD - i : 256;
+            memcpy(chunk, x->buffer + i, n * sizeof(float));
+            mf_kernels_current.toHalf(chunk, x->hbuffer + i, n);
+        }
+    }
+    else
+    {
+        for (int end = 2000 + MF_COMB_GUARD; end > 0; end -= 256)
+        {
+            int n = end < 256 ? end : 256;
+            memcpy(halves, x->hbuffer + end - n, n * sizeof(uint16_t));
+            mf_kernels_current.toFloat(halves, x->buffer + end - n, n);
+        }
+    }
+    x->half = on;
+}
+
+/* copies 16 samples from the start of the line to its mirror, through a chunk as they overlap on short lines */
+static void mf_comb_mirror(mf_comb *x, int start)
+{
+    float chunk[16];
+
+    if (x->half)
+    {
+        memcpy(chunk, x->hbuffer + start, 16 * sizeof(uint16_t));
+        memcpy(x->hbuffer + x->delay + start, chunk, 16 * sizeof(uint16_t));
+    }
+    else
+    {
+        memcpy(chunk, x->buffer + start, sizeof(chunk));
+        memcpy(x->buffer + x->delay + start, chunk, sizeof(chunk));
+    }
+}
+
+static void mf_comb_performModulated(mf_comb *x, float *in, float *out, int vectorSize)
+{
+    /* the LFO is only evaluated where a ramp of whole blocks ends and the read offset ramped linearly
+       towards it, a block longer than the rest of the ramp starts the next one */
+    if (x->modLeft < vectorSize)
+    {
+        int ramp = vectorSize < MF_COMB_RAMP ? MF_COMB_RAMP / vectorSize * vectorSize : vectorSize;
+        x->modPhase += x->modIncrement * ramp;
+        if (x->modPhase >= 1)
+            x->modPhase -= (int)x->modPhase;
+        x->modStep = (1 + x->modDepth * (1 + mf_comb_lfo(x->modPhase)) - x->modOffset) / ramp;
+        x->modLeft = ramp;
+    }
+    x->modLeft -= vectorSize;
+
+    if (x->counter >= x->delay)
+        x->counter = 0;
+
+    /* the offset of the read position in front of the oldest sample stays between 1 and 2 * depth + 1,
+       so the reads run past the end of the line into the mirror of its first samples, and a span ends
+       before they come around to samples written in it */
+    float offset = x->modOffset;
+    float step = x->modStep;
+    x->modOffset = offset + step * vectorSize;
+    int length = x->delay;
+    int mirror = (int)(2 * x->modDepth) + 3;
+    int reach = length - mirror;
+    bool deep = mirror + 16 > MF_COMB_GUARD;
+    int i = 0;
+
+    while (i < vectorSize)
+    {
+        int span = length - x->counter;
+        if (span > vectorSize - i) span = vectorSize - i;
+        if (span > reach) span = reach;
+
+        float position = offset + i * step;
+        int whole = (int)position;
+
+        /* a mirror too short for deep modulation is not kept, the reads that come around the end of
+           the line go through a window there */
+        if (deep && x->counter + span + mirror > length)
+        {
+            if (x->half)
+                mf_kernels_runModulatedHalf(mf_kernels_current.combModulatedHalf, x->hbuffer, length, x->counter, position, step, in + i, out + i, x->gain, span);
+            else
+                mf_kernels_runModulated(mf_kernels_current.combModulated, x->buffer, length, x->counter, position, step, in + i, out + i, x->gain, span);
+        }
+        else if (x->half)
+            mf_kernels_current.combModulatedHalf(x->hbuffer + x->counter, x->hbuffer + x->counter + whole, in + i, out + i, x->gain, position - whole, step, span);
+        else
+            mf_kernels_current.combModulated(x->buffer + x->counter, x->buffer + x->counter + whole, in + i, out + i, x->gain, position - whole, step, span);
+
+        for (int j = x->counter; !deep && j < mirror && j < x->counter + span; j += 16)
+            mf_comb_mirror(x, j);
+
+        i += span;
+        x->counter += span;
+        if (x->counter == length)
+            x->counter = 0;
+    }
+}
+
 void mf_comb_perform(mf_comb *x, float *in, float *out, int vectorSize)
 {
-    float delayout = 0;
-    for (int i = 0; i < vectorSize; i++)
+    if (x->modDepth > 0)
+    {
+        mf_comb_performModulated(x, in, out, vectorSize);
+        return;
+    }
+
+    if (x->counter >= x->delay)
+        x->counter = 0;
+
+    /* spans of the delay line that do not wrap go to the vectorized kernel */
+    int i = 0;
+    while (i < vectorSize)
     {
-        delayout = x->buffer[x->counter];
-        x->buffer[(x->counter)] = in[i] + (delayout * x->gain);
-        out[i] = delayout;
-        
-        if (x->counter != x->delay-1)
-            x->counter++;
+        int span = x->delay - x->counter;
+        if (span > vectorSize - i) span = vectorSize - i;
+
+        if (x->half)
+            mf_kernels_current.combHalf(x->hbuffer + x->counter, in + i, out + i, x->gain, span);
         else
+            mf_kernels_current.comb(x->buffer + x->counter, x->buffer + x->counter, in + i, out + i, x->gain, span);
+
+        i += span;
+        x->counter += span;
+        if (x->counter == x->delay)
+            x->counter = 0;
+    }
+}
+
+void mf_comb_performFrozen(mf_comb *x, float *out, int vectorSize)
+{
+    if (x->counter >= x->delay)
+        x->counter = 0;
+
+    /* the same spans as mf_comb_perform, copied instead of filtered */
+    int i = 0;
+    while (i < vectorSize)
+    {
+        int span = x->delay - x->counter;
+        if (span > vectorSize - i) span = vectorSize - i;
+
+        if (x->half)
+            mf_kernels_current.toFloat(x->hbuffer + x->counter, out + i, span);
+        else
+            memcpy(out + i, x->buffer + x->counter, span * sizeof(float));
+
+        i += span;
+        x->counter += span;
+        if (x->counter == x->delay)
             x->counter = 0;
     }
 }
 
 void mf_comb_clearBuffer(mf_comb *x)
 {
-    for (int i = 0; i < 2000; i++)
+    for (int i = 0; i < 2000 + MF_COMB_GUARD; i++)
     {
         x->buffer[i] = 0;
     }
 }
+
+bool mf_comb_recover(mf_comb *x)
+{
+    int length = x->delay < 2000 ? x->delay : 2000;
+    bool finite = true;
+
+    if (length <= 0)
+        return false;
+
+    /* a half sample with all exponent bits set is an infinity or a NaN */
+    if (x->half)
+    {
+        for (int i = 0; i < length; i++)
+            if ((x->hbuffer[i] & 0x7c00) == 0x7c00)
+                finite = false;
+    }
+    else
+        finite = mf_kernels_current.finite(x->buffer, length);
+
+    if (finite)
+        return false;
+    memset(x->buffer, 0, (length + MF_COMB_GUARD) * (x->half ? sizeof(uint16_t) : sizeof(float)));
+    return true;
+}
+
+float mf_comb_peak(mf_comb *x)
+{
+    int length = x->delay < 2000 ? x->delay : 2000;
+    float peak = 0;
+
+    /* below the sign bit, the bits of a half grow with its magnitude, so only the largest is converted */
+    if (x->half)
+    {
+        uint16_t largest = 0;
+        for (int i = 0; i < length; i++)
+            if ((x->hbuffer[i] & 0x7fff) > largest)
+                largest = x->hbuffer[i] & 0x7fff;
+        mf_kernels_current.toFloat(&largest, &peak, 1);
+        return peak;
+    }
+
+    for (int i = 0; i < length; i++)
+    {
+        float magnitude = fabsf(x->buffer[i]);
+        if (magnitude > peak)
+            peak = magnitude;
+    }
+    return peak;
+}
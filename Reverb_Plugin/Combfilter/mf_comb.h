@@ -13,9 +13,13 @@
 
 #ifndef mf_comb_h
 #define mf_comb_h
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#define MF_COMB_RAMP 256      /**< samples between two values of the modulating LFO */
+#define MF_COMB_GUARD 64      /**< samples behind the delay line that mirror its start for the modulated reads */
 
 /**
  * @struct mf_comb
@@ -24,7 +28,15 @@
  * delay in Samples of the multi tap delay
  * @var mf::counter A value for indexing the current sample <br>
  * @var mf::gain The parameter value for the recursive gain <br>
+ * @var mf::modDepth The modulation depth of the delay in samples <br>
+ * @var mf::modPhase The phase of the delay modulating LFO <br>
+ * @var mf::modIncrement The phase increment of the LFO per sample <br>
+ * @var mf::modOffset The read offset the next block starts from <br>
+ * @var mf::modStep The increment of the read offset per sample up to the next value of the LFO <br>
+ * @var mf::modLeft The samples left until the next value of the LFO <br>
+ * @var mf::half True if the delay line holds half-precision samples <br>
  * @var mf::buffer An array to store the delayed samples <br>
+ * @var mf::hbuffer The same memory as half-precision samples <br>
  */
 
 typedef struct mf_comb
@@ -32,7 +44,18 @@ typedef struct mf_comb
     int delay;  /**< parameter for adjusting the delay of the multi tap delay */
     int counter;    /**< parameter for indexing the current sample */
     float gain;     /**< parameter for adjusting the level of the recursive gain */
-    float buffer[2000]; /**< An array to store the delayed samples */
+    float modDepth; /**< modulation depth of the delay in samples, 0 disables the modulation */
+    float modPhase; /**< normalized phase [0, 1) of the LFO at the end of the current ramp */
+    float modIncrement; /**< normalized phase increment of the LFO per sample */
+    float modOffset;    /**< read offset in front of the oldest sample where the last block ended */
+    float modStep;      /**< increment of the read offset per sample along the current ramp */
+    int modLeft;        /**< samples left on the current ramp */
+    bool half;          /**< true if hbuffer is in use instead of buffer */
+    union
+    {
+        float buffer[2000 + MF_COMB_GUARD];    /**< An array to store the delayed samples */
+        uint16_t hbuffer[2000 + MF_COMB_GUARD]; /**< the delayed samples in half precision, only the first half of the memory is touched */
+    };
 
 } mf_comb;
 
@@ -62,7 +85,7 @@ void mf_comb_free(mf_comb *x);
 * @param x My combfilter object <br>
 * @param delay The delay value <br>
 * The function sets the delay parameter of <br>
-* the combfilter class
+* the combfilter class, delays longer than the buffer are cut to it
 */
 
 void mf_comb_setDelay(mf_comb *x, int delay);
@@ -81,6 +104,35 @@ void mf_comb_setDelay(mf_comb *x, int delay);
 
 void mf_comb_setGain(mf_comb *x, float t60, float fs);
 
+/**
+ * @related mf_comb
+ * @brief Sets the modulation of the delay length <br>
+ * @param x My combfilter object <br>
+ * @param depth The modulation depth in samples, 0 turns the modulation off <br>
+ * @param rate The frequency of the modulating LFO in Hz <br>
+ * @param phase The start phase of the LFO, normalized to [0, 1) <br>
+ * @param fs The current sample rate <br>
+ * The LFO is evaluated every MF_COMB_RAMP samples, rounded <br>
+ * to whole blocks, and ramped linearly in between, the delay <br>
+ * line is read with linear interpolation. The depth is limited to half of the delay, <br>
+ * so the delay has to be set before the modulation <br>
+ */
+
+void mf_comb_setModulation(mf_comb *x, float depth, float rate, float phase, float fs);
+
+/**
+ * @related mf_comb
+ * @brief Switches the delay line between float and half-precision samples <br>
+ * @param x My combfilter object <br>
+ * @param on True for half precision <br>
+ * The samples in the delay line are converted, so the tail goes on. Half <br>
+ * precision halves the memory the filter reads and writes per sample, the <br>
+ * feedback is still computed in float. Every pass through the delay line <br>
+ * rounds to 11 significant bits, about -67 dB below the signal in mf_bench <br>
+ */
+
+void mf_comb_setHalf(mf_comb *x, bool on);
+
 /**
  * @related mf_comb
  * @brief Performs a combfilter structure in realtime <br>
@@ -97,6 +149,20 @@ void mf_comb_setGain(mf_comb *x, float t60, float fs);
 
 void mf_comb_perform(mf_comb *x, float *in, float *out, int vectorSize);
 
+/**
+ * @related mf_comb
+ * @brief Replays the delay line without changing it<br>
+ * @param x My combfilter object <br>
+ * @param out The output vector <br>
+ * @param vectorSize The vectorSize <br>
+ * The samples are read where mf_comb_perform would read them, but nothing is <br>
+ * written back, so the delay line loops forever like a comb with a gain of 1 <br>
+ * and no input, without the feedback arithmetic and its rounding. A modulated <br>
+ * delay is read at its nominal length <br>
+ */
+
+void mf_comb_performFrozen(mf_comb *x, float *out, int vectorSize);
+
 
 /**
  * @related mf_comb
@@ -108,5 +174,25 @@ void mf_comb_perform(mf_comb *x, float *in, float *out, int vectorSize);
 
 void mf_comb_clearBuffer(mf_comb *x);
 
+/**
+ * @related mf_comb
+ * @brief Clears the delay line if it holds an infinite or NaN sample<br>
+ * @param x My combfilter object <br>
+ * Only the part of the delay line in use is checked and cleared, <br>
+ * in float or half precision <br>
+ * @return true if the delay line was cleared <br>
+ */
+
+bool mf_comb_recover(mf_comb *x);
+
+/**
+ * @related mf_comb
+ * @brief Returns the largest magnitude in the delay line<br>
+ * @param x My combfilter object <br>
+ * Only the part of the delay line in use is read, in float or half precision <br>
+ */
+
+float mf_comb_peak(mf_comb *x);
+
 
 #endif /* mf_comb_h */
@@ -0,0 +1,51 @@
+#include "mf_diag.h"
+
+mf_diag *mf_diag_new(void)
+{
+    return (mf_diag *)calloc(1, sizeof(mf_diag));
+}
+
+void mf_diag_free(mf_diag *d)
+{
+    free(d);
+}
+
+bool mf_diag_push(mf_diag *d, mf_diag_type type, uint32_t block, float value)
+{
+    /* the producer owns head, the acquire on tail keeps the slot from being overwritten before it was read */
+    uint32_t head = d->head;
+    if (head - __atomic_load_n(&d->tail, __ATOMIC_ACQUIRE) >= MF_DIAG_EVENTS)
+    {
+        __atomic_add_fetch(&d->dropped, 1, __ATOMIC_RELAXED);
+        return false;
+    }
+
+    mf_diag_event *e = &d->events[head & (MF_DIAG_EVENTS - 1)];
+    e->type = type;
+    e->block = block;
+    e->value = value;
+    __atomic_store_n(&d->head, head + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+bool mf_diag_pop(mf_diag *d, mf_diag_event *e)
+{
+    uint32_t tail = d->tail;
+    if (tail == __atomic_load_n(&d->head, __ATOMIC_ACQUIRE))
+        return false;
+
+    *e = d->events[tail & (MF_DIAG_EVENTS - 1)];
+    __atomic_store_n(&d->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+uint32_t mf_diag_dropped(mf_diag *d)
+{
+    return __atomic_exchange_n(&d->dropped, 0, __ATOMIC_RELAXED);
+}
+
+const char *mf_diag_name(mf_diag_type type)
+{
+    static const char *names[MF_DIAG_TYPES] = {"deadline overrun", "denormal", "clipped", "recovered", "allpass stages"};
+    return type >= 0 && type < MF_DIAG_TYPES ? names[type] : "unknown";
+}
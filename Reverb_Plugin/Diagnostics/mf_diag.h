@@ -0,0 +1,136 @@
+/**
+ * @file mf_diag.h
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Diagnostics events <br>
+ * <br>
+ * @brief A lock-free ring that carries events from the audio thread to another thread <br>
+ * <br>
+ * The audio thread is the only producer and pushes small fixed-size records, <br>
+ * one thread that is allowed to block, e.g. a Pd clock, is the only consumer <br>
+ * and pops them. Both sides only touch their own index and read the other one <br>
+ * with acquire semantics, so neither side ever waits or calls into the system. <br>
+ * A full ring drops the new event and counts it instead of overwriting events <br>
+ * the consumer may be reading. <br>
+ * <br>
+ */
+
+#ifndef mf_diag_h
+#define mf_diag_h
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MF_DIAG_EVENTS 256 /**< events in the ring, a power of two */
+
+/**
+ * @brief The kinds of events <br>
+ * MF_DIAG_OVERRUN: a block took longer than its period, the value is the time as part of the period <br>
+ * MF_DIAG_DENORMAL: many output samples were denormal, the value is their share of the block <br>
+ * MF_DIAG_CLIP: an output sample exceeded 1, the value is the peak <br>
+ * MF_DIAG_RECOVERY: an infinite or NaN output was recovered, the value is the number of cleared delay lines <br>
+ * MF_DIAG_STAGES: the adaptive mode changed the allpass stages, the value is the new number per channel <br>
+ */
+
+typedef enum mf_diag_type
+{
+    MF_DIAG_OVERRUN,
+    MF_DIAG_DENORMAL,
+    MF_DIAG_CLIP,
+    MF_DIAG_RECOVERY,
+    MF_DIAG_STAGES,
+    MF_DIAG_TYPES
+} mf_diag_type;
+
+/**
+ * @struct mf_diag_event
+ * @brief A single event <br>
+ * @var mf_diag_event::type The kind of the event, an mf_diag_type <br>
+ * @var mf_diag_event::block The number of the block since the engine was created <br>
+ * @var mf_diag_event::value A value that depends on the type <br>
+ */
+
+typedef struct mf_diag_event
+{
+    int type;
+    uint32_t block;
+    float value;
+} mf_diag_event;
+
+/**
+ * @struct mf_diag
+ * @brief A structure for the ring <br>
+ * @var mf_diag::head The number of events pushed, written by the producer only <br>
+ * @var mf_diag::tail The number of events popped, written by the consumer only <br>
+ * @var mf_diag::dropped The number of events lost to a full ring since the last mf_diag_dropped <br>
+ * @var mf_diag::events The records <br>
+ * The indices are padded to their own cache lines, so the two threads do not <br>
+ * invalidate each other's line on every event <br>
+ */
+
+typedef struct mf_diag
+{
+    uint32_t head;
+    char padHead[60];
+    uint32_t tail;
+    char padTail[60];
+    uint32_t dropped;
+    mf_diag_event events[MF_DIAG_EVENTS];
+} mf_diag;
+
+/**
+ * @related mf_diag
+ * @brief Creates an empty ring<br>
+ * @return a pointer to the newly created mf_diag object <br>
+ */
+
+mf_diag *mf_diag_new(void);
+
+/**
+ * @related mf_diag
+ * @brief Frees a ring<br>
+ * @param d My ring <br>
+ */
+
+void mf_diag_free(mf_diag *d);
+
+/**
+ * @related mf_diag
+ * @brief Adds an event, only called by the producer<br>
+ * @param d My ring <br>
+ * @param type The kind of the event <br>
+ * @param block The number of the block <br>
+ * @param value The value of the event <br>
+ * @return false if the ring was full and the event was dropped <br>
+ */
+
+bool mf_diag_push(mf_diag *d, mf_diag_type type, uint32_t block, float value);
+
+/**
+ * @related mf_diag
+ * @brief Takes the oldest event, only called by the consumer<br>
+ * @param d My ring <br>
+ * @param e The event <br>
+ * @return false if the ring was empty <br>
+ */
+
+bool mf_diag_pop(mf_diag *d, mf_diag_event *e);
+
+/**
+ * @related mf_diag
+ * @brief Returns and resets the number of dropped events, only called by the consumer<br>
+ * @param d My ring <br>
+ */
+
+uint32_t mf_diag_dropped(mf_diag *d);
+
+/**
+ * @related mf_diag
+ * @brief Returns a short description of a kind of event, e.g. "clipped" <br>
+ * @param type The kind of the event <br>
+ */
+
+const char *mf_diag_name(mf_diag_type type);
+
+#endif /* mf_diag_h */
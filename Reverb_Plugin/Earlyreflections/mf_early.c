@@ -0,0 +1,113 @@
+#include "mf_early.h"
+#include "math.h"
+#include "mf_kernels.h"
+#include <string.h>
+
+/* positions relative to the room size, keeps the pattern asymmetric */
+static const float mf_early_source[3] = {.3f, .4f, .45f};
+static const float mf_early_listener[3] = {.65f, .7f, .4f};
+
+mf_early *mf_early_new(void)
+{
+    mf_early *x = (mf_early *)malloc(sizeof(mf_early));
+    x->taps = 0;
+    x->counter = 0;
+    mf_early_clearBuffer(x);
+    return x;
+}
+
+void mf_early_free(mf_early *x)
+{
+    free(x);
+}
+
+void mf_early_setSampleRate(mf_early *x, float fs)
+{
+    for (int t = 0; t < x->taps; t++)
+    {
+        int position = (int)(x->time[t] * fs + .5f);
+        if (position < 0) position = 0;
+        if (position > MF_EARLY_LENGTH - MF_EARLY_CHUNK) position = MF_EARLY_LENGTH - MF_EARLY_CHUNK;
+        x->position[t] = position;
+    }
+}
+
+void mf_early_setTaps(mf_early *x, const float *time, const float *gain, int taps, float fs)
+{
+    if (taps > MF_EARLY_TAPS) taps = MF_EARLY_TAPS;
+    if (taps < 0) taps = 0;
+
+    for (int t = 0; t < taps; t++)
+    {
+        x->time[t] = time[t];
+        x->gain[t] = gain[t];
+    }
+    x->taps = taps;
+    mf_early_setSampleRate(x, fs);
+}
+
+/* coordinate of the image source after n reflections on one axis */
+static float mf_early_image(int n, float size, float source)
+{
+    return n % 2 == 0 ? n * size + source : (n + 1) * size - source;
+}
+
+void mf_early_setRoom(mf_early *x, float width, float depth, float height, float reflection, float fs)
+{
+    float size[3] = {width, depth, height};
+    float source[3], listener[3];
+    float time[MF_EARLY_TAPS], gain[MF_EARLY_TAPS];
+    int taps = 0;
+
+    for (int a = 0; a < 3; a++)
+    {
+        source[a] = mf_early_source[a] * size[a];
+        listener[a] = mf_early_listener[a] * size[a];
+    }
+
+    float direct = sqrtf((source[0] - listener[0]) * (source[0] - listener[0]) +
+                         (source[1] - listener[1]) * (source[1] - listener[1]) +
+                         (source[2] - listener[2]) * (source[2] - listener[2]));
+
+    /* 6 first and 18 second order images, 24 taps */
+    for (int i = -MF_EARLY_ORDER; i <= MF_EARLY_ORDER; i++)
+    {
+        for (int j = -MF_EARLY_ORDER; j <= MF_EARLY_ORDER; j++)
+        {
+            for (int k = -MF_EARLY_ORDER; k <= MF_EARLY_ORDER; k++)
+            {
+                int order = abs(i) + abs(j) + abs(k);
+                if (order == 0 || order > MF_EARLY_ORDER || taps == MF_EARLY_TAPS)
+                    continue;
+
+                float dx = mf_early_image(i, size[0], source[0]) - listener[0];
+                float dy = mf_early_image(j, size[1], source[1]) - listener[1];
+                float dz = mf_early_image(k, size[2], source[2]) - listener[2];
+                float distance = sqrtf(dx * dx + dy * dy + dz * dz);
+
+                time[taps] = (distance - direct) / 343.f;
+                gain[taps] = powf(reflection, order) * direct / distance;
+                taps++;
+            }
+        }
+    }
+
+    mf_early_setTaps(x, time, gain, taps, fs);
+}
+
+void mf_early_clearBuffer(mf_early *x)
+{
+    memset(x->buffer, 0, sizeof(x->buffer));
+}
+
+void mf_early_perform(mf_early *x, const float *in, float *out, int vectorSize)
+{
+    if (x->taps == 0)
+    {
+        if (out != in)
+            memcpy(out, in, vectorSize * sizeof(float));
+        return;
+    }
+
+    mf_kernels_runTaps(x->buffer, MF_EARLY_LENGTH, MF_EARLY_CHUNK, &x->counter, x->position, x->gain, x->taps, in, out, vectorSize, true);
+}
@@ -0,0 +1,124 @@
+/**
+ * @file mf_early.h
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Early reflections <br>
+ * <br>
+ * @brief Audio Object for a sparse tap delay line in front of the comb filters <br>
+ * <br>
+ * mf_early adds up to MF_EARLY_TAPS delayed and scaled copies of its input <br>
+ * to the input itself. The taps are set directly, e.g. from a Pd array, or <br>
+ * calculated from a shoebox room with first and second order image sources. <br>
+ * Each block is written to the delay line first, then every tap reads one <br>
+ * contiguous span of it. The first MF_EARLY_CHUNK samples of the delay line <br>
+ * are mirrored behind its end, so no span wraps and all taps of a block go <br>
+ * to a single call of the vectorized tap kernel, which keeps the sum of the <br>
+ * taps in a register instead of gathering single samples. <br>
+ * <br>
+ */
+
+#ifndef mf_early_h
+#define mf_early_h
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MF_EARLY_TAPS 64
+#define MF_EARLY_ORDER 2      /**< highest image source order of a room, 24 taps; the third order adds 38 taps for little audible detail */
+#define MF_EARLY_LENGTH 16384 /**< length of the delay line, a power of two */
+#define MF_EARLY_CHUNK 512    /**< longer blocks are processed in chunks of this size */
+
+/**
+ * @struct mf_early
+ * @brief A structure for the early reflections <br>
+ * @var mf_early::taps The number of taps in use, 0 bypasses the stage <br>
+ * @var mf_early::counter The index of the next sample written to the delay line <br>
+ * @var mf_early::time The delays of the taps in seconds <br>
+ * @var mf_early::position The delays of the taps in samples <br>
+ * @var mf_early::gain The gains of the taps <br>
+ * @var mf_early::buffer An array to store the delayed samples, followed by the mirrored start <br>
+ */
+
+typedef struct mf_early
+{
+    int taps;
+    int counter;
+    float time[MF_EARLY_TAPS];
+    int position[MF_EARLY_TAPS];
+    float gain[MF_EARLY_TAPS];
+    float buffer[MF_EARLY_LENGTH + MF_EARLY_CHUNK];
+} mf_early;
+
+/**
+ * @related mf_early
+ * @brief Creates a new early reflection stage without taps<br>
+ * @return a pointer to the newly created mf_early object <br>
+ */
+
+mf_early *mf_early_new(void);
+
+/**
+ * @related mf_early
+ * @brief Frees an early reflection stage<br>
+ * @param x My early reflection object <br>
+ */
+
+void mf_early_free(mf_early *x);
+
+/**
+ * @related mf_early
+ * @brief Sets the taps <br>
+ * @param x My early reflection object <br>
+ * @param time The delays in seconds <br>
+ * @param gain The gains <br>
+ * @param taps The number of taps, at most MF_EARLY_TAPS are used <br>
+ * @param fs The sample rate <br>
+ * Delays longer than the delay line allows are shortened <br>
+ */
+
+void mf_early_setTaps(mf_early *x, const float *time, const float *gain, int taps, float fs);
+
+/**
+ * @related mf_early
+ * @brief Calculates the taps of a shoebox room <br>
+ * @param x My early reflection object <br>
+ * @param width The width of the room in metres <br>
+ * @param depth The depth of the room in metres <br>
+ * @param height The height of the room in metres <br>
+ * @param reflection The reflection coefficient of the walls from 0 to 1 <br>
+ * @param fs The sample rate <br>
+ * Source and listener sit at fixed fractions of the room. Every image source <br>
+ * up to MF_EARLY_ORDER becomes one tap, delayed and attenuated by 1/r relative <br>
+ * to the direct sound, which is the dry signal of the reverb. <br>
+ */
+
+void mf_early_setRoom(mf_early *x, float width, float depth, float height, float reflection, float fs);
+
+/**
+ * @related mf_early
+ * @brief Recalculates the tap positions for a new sample rate<br>
+ * @param x My early reflection object <br>
+ * @param fs The sample rate <br>
+ */
+
+void mf_early_setSampleRate(mf_early *x, float fs);
+
+/**
+ * @related mf_early
+ * @brief Clears the delay line<br>
+ * @param x My early reflection object <br>
+ */
+
+void mf_early_clearBuffer(mf_early *x);
+
+/**
+ * @related mf_early
+ * @brief Adds the reflections to the input <br>
+ * @param x My early reflection object <br>
+ * @param in The input vector <br>
+ * @param out The output vector, may be the input <br>
+ * @param vectorSize The vectorSize <br>
+ */
+
+void mf_early_perform(mf_early *x, const float *in, float *out, int vectorSize);
+
+#endif /* mf_early_h */
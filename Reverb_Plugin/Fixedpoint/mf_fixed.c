@@ -0,0 +1,122 @@
+#include "mf_fixed.h"
+#include "math.h"
+#include <string.h>
+
+static inline int16_t mf_fixed_saturate(int32_t v)
+{
+    if (v > INT16_MAX) return INT16_MAX;
+    if (v < INT16_MIN) return INT16_MIN;
+    return (int16_t)v;
+}
+
+void mf_fixed_comb_configure(mf_fixed_comb *x, const mf_comb *comb)
+{
+    double gain = comb->gain * 2147483648.0;
+    x->delay = comb->delay;
+    x->counter = comb->counter;
+    x->gain = gain >= INT32_MAX ? INT32_MAX : (int32_t)lrint(gain);
+    memset(x->buffer, 0, sizeof(x->buffer));
+}
+
+void mf_fixed_comb_perform(mf_fixed_comb *x, const int16_t *in, int16_t *out, int vectorSize)
+{
+    int32_t delayout = 0;
+    for (int i = 0; i < vectorSize; i++)
+    {
+        delayout = x->buffer[x->counter];
+        /* Q15 * Q31 = Q46, rounded back to Q15 */
+        int32_t feedback = (int32_t)(((int64_t)delayout * x->gain + ((int64_t)1 << 30)) >> 31);
+        x->buffer[x->counter] = mf_fixed_saturate(in[i] + feedback);
+        out[i] = (int16_t)delayout;
+
+        if (x->counter != x->delay-1)
+            x->counter++;
+        else
+            x->counter = 0;
+    }
+}
+
+void mf_fixed_comb_performFrozen(mf_fixed_comb *x, int16_t *out, int vectorSize)
+{
+    if (x->counter >= x->delay)
+        x->counter = 0;
+
+    int i = 0;
+    while (i < vectorSize)
+    {
+        int span = x->delay - x->counter;
+        if (span > vectorSize - i) span = vectorSize - i;
+
+        memcpy(out + i, x->buffer + x->counter, span * sizeof(int16_t));
+        i += span;
+        x->counter += span;
+        if (x->counter == x->delay)
+            x->counter = 0;
+    }
+}
+
+void mf_fixed_allpass_configure(mf_fixed_allpass *x, const mf_allpass *allpass)
+{
+    x->delay = allpass->delay;
+    x->counter = allpass->counter;
+    x->gain = mf_fixed_saturate((int32_t)lrintf(allpass->gain * 32768.f));
+    memset(x->buffer, 0, sizeof(x->buffer));
+}
+
+void mf_fixed_allpass_perform(mf_fixed_allpass *x, const int16_t *in, int16_t *out, int vectorSize)
+{
+    int32_t delayout = 0;
+    for (int i = 0; i < vectorSize; i++)
+    {
+        int32_t input = in[i];
+        delayout = x->buffer[x->counter];
+        /* Q15 * Q15 = Q30, rounded back to Q15 */
+        x->buffer[x->counter] = mf_fixed_saturate(input + ((delayout * x->gain + (1 << 14)) >> 15));
+        out[i] = mf_fixed_saturate(delayout - ((input * x->gain + (1 << 14)) >> 15));
+
+        if (x->counter != x->delay-1)
+            x->counter++;
+        else
+            x->counter = 0;
+    }
+}
+
+static float mf_fixed_peak(const int16_t *buffer, int length)
+{
+    int peak = 0;
+    for (int i = 0; i < length; i++)
+    {
+        int magnitude = buffer[i] < 0 ? -buffer[i] : buffer[i];
+        if (magnitude > peak)
+            peak = magnitude;
+    }
+    return peak / 32768.f;
+}
+
+float mf_fixed_comb_peak(const mf_fixed_comb *x)
+{
+    return mf_fixed_peak(x->buffer, x->delay < 2000 ? x->delay : 2000);
+}
+
+float mf_fixed_allpass_peak(const mf_fixed_allpass *x)
+{
+    return mf_fixed_peak(x->buffer, x->delay < 10000 ? x->delay : 10000);
+}
+
+void mf_fixed_fromFloat(const float *in, int16_t *out, int vectorSize)
+{
+    for (int i = 0; i < vectorSize; i++)
+    {
+        float v = in[i] * 32768.f;
+        v = v > 32767.f ? 32767.f : (v < -32768.f ? -32768.f : v);
+        out[i] = (int16_t)lrintf(v);
+    }
+}
+
+void mf_fixed_toFloat(const int16_t *in, float *out, int vectorSize)
+{
+    for (int i = 0; i < vectorSize; i++)
+    {
+        out[i] = in[i] * (1.f / 32768.f);
+    }
+}
@@ -0,0 +1,154 @@
+/**
+ * @file mf_fixed.h
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Fixed-point comb and allpass filters <br>
+ * <br>
+ * @brief Integer versions of mf_comb and mf_allpass for targets without a strong FPU <br>
+ * <br>
+ * The signals are Q15 and the delay lines store 16 bit samples. The comb <br>
+ * gain is Q31, since gains close to 1 need the resolution for a correct t60, <br>
+ * the allpass gain is Q15. All products are rounded and every result that <br>
+ * goes back into a delay line or an output is saturated. Delays and gains are <br>
+ * taken from configured float filters, so mf_comb_setGain stays the only <br>
+ * place where gains are calculated. The fixed-point filters do not modulate. <br>
+ * <br>
+ * Error bound against the float filters: every delay line write rounds to <br>
+ * half an LSB (2^-16). A comb feeds that error back with its gain g, so its <br>
+ * output deviates by at most 2^-16 / (1 - g). An allpass adds at most one <br>
+ * LSB per stage on top of the error of its input. For the default graph <br>
+ * (t60 = 3 s, 44.1 kHz, combs with g <= 0.96, 10 allpasses per channel) the <br>
+ * deviation of the wet signal therefore stays below 2^-10, about -60 dBFS, <br>
+ * as long as no signal saturates. mf_bench checks this bound. <br>
+ * <br>
+ */
+
+#ifndef mf_fixed_h
+#define mf_fixed_h
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include "mf_allpass.h"
+#include "mf_comb.h"
+
+/**
+ * @struct mf_fixed_comb
+ * @brief A structure for a fixed-point comb filter <br>
+ * @var mf_fixed_comb::delay The delay in samples <br>
+ * @var mf_fixed_comb::counter A value for indexing the current sample <br>
+ * @var mf_fixed_comb::gain The recursive gain in Q31 <br>
+ * @var mf_fixed_comb::buffer An array to store the delayed Q15 samples <br>
+ */
+
+typedef struct mf_fixed_comb
+{
+    int delay;
+    int counter;
+    int32_t gain;
+    int16_t buffer[2000];
+} mf_fixed_comb;
+
+/**
+ * @struct mf_fixed_allpass
+ * @brief A structure for a fixed-point allpass filter <br>
+ * @var mf_fixed_allpass::delay The delay in samples <br>
+ * @var mf_fixed_allpass::counter A value for indexing the current sample <br>
+ * @var mf_fixed_allpass::gain The feedback and feedforward gain in Q15 <br>
+ * @var mf_fixed_allpass::buffer An array to store the delayed Q15 samples <br>
+ */
+
+typedef struct mf_fixed_allpass
+{
+    int delay;
+    int counter;
+    int16_t gain;
+    int16_t buffer[10000];
+} mf_fixed_allpass;
+
+/**
+ * @related mf_fixed_comb
+ * @brief Takes over delay, position and quantized gain of a float comb filter<br>
+ * @param x My fixed-point combfilter object <br>
+ * @param comb The configured float combfilter <br>
+ * The delay line is cleared <br>
+ */
+
+void mf_fixed_comb_configure(mf_fixed_comb *x, const mf_comb *comb);
+
+/**
+ * @related mf_fixed_comb
+ * @brief Performs a fixed-point combfilter <br>
+ * @param x My fixed-point combfilter object <br>
+ * @param in The Q15 input vector <br>
+ * @param out The Q15 output vector <br>
+ * @param vectorSize The vectorSize <br>
+ */
+
+void mf_fixed_comb_perform(mf_fixed_comb *x, const int16_t *in, int16_t *out, int vectorSize);
+
+/**
+ * @related mf_fixed_comb
+ * @brief Replays the delay line without changing it, see mf_comb_performFrozen <br>
+ * @param x My fixed-point combfilter object <br>
+ * @param out The Q15 output vector <br>
+ * @param vectorSize The vectorSize <br>
+ */
+
+void mf_fixed_comb_performFrozen(mf_fixed_comb *x, int16_t *out, int vectorSize);
+
+/**
+ * @related mf_fixed_allpass
+ * @brief Takes over delay, position and quantized gain of a float allpass filter<br>
+ * @param x My fixed-point allpassfilter object <br>
+ * @param allpass The configured float allpassfilter <br>
+ * The delay line is cleared <br>
+ */
+
+void mf_fixed_allpass_configure(mf_fixed_allpass *x, const mf_allpass *allpass);
+
+/**
+ * @related mf_fixed_allpass
+ * @brief Performs a fixed-point allpassfilter <br>
+ * @param x My fixed-point allpassfilter object <br>
+ * @param in The Q15 input vector <br>
+ * @param out The Q15 output vector, may be the input vector <br>
+ * @param vectorSize The vectorSize <br>
+ */
+
+void mf_fixed_allpass_perform(mf_fixed_allpass *x, const int16_t *in, int16_t *out, int vectorSize);
+
+/**
+ * @related mf_fixed_comb
+ * @brief Returns the largest magnitude in the delay line as a float, see mf_comb_peak <br>
+ * @param x My fixed-point combfilter object <br>
+ */
+
+float mf_fixed_comb_peak(const mf_fixed_comb *x);
+
+/**
+ * @related mf_fixed_allpass
+ * @brief Returns the largest magnitude in the delay line as a float, see mf_comb_peak <br>
+ * @param x My fixed-point allpassfilter object <br>
+ */
+
+float mf_fixed_allpass_peak(const mf_fixed_allpass *x);
+
+/**
+ * @brief Converts float samples to Q15 with saturation <br>
+ * @param in The float input vector <br>
+ * @param out The Q15 output vector <br>
+ * @param vectorSize The vectorSize <br>
+ */
+
+void mf_fixed_fromFloat(const float *in, int16_t *out, int vectorSize);
+
+/**
+ * @brief Converts Q15 samples to float <br>
+ * @param in The Q15 input vector <br>
+ * @param out The float output vector <br>
+ * @param vectorSize The vectorSize <br>
+ */
+
+void mf_fixed_toFloat(const int16_t *in, float *out, int vectorSize);
+
+#endif /* mf_fixed_h */
@@ -0,0 +1,1941 @@
+#include "mf_kernels.h"
+#include <math.h>
+#include <string.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MF_KERNELS_X86
+#include <immintrin.h>
+#endif
+
+static void mf_kernels_combScalar(float *buffer, const float *delayed, const float *in, float *out, float gain, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        float delayout = delayed[k];
+        buffer[k] = in[k] + delayout * gain;
+        out[k] = delayout;
+    }
+}
+
+static void mf_kernels_allpassScalar(float *buffer, const float *delayed, const float *in, float *out, float gain, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        float input = in[k];
+        float delayout = delayed[k];
+        buffer[k] = input + delayout * gain;
+        out[k] = delayout - gain * input;
+    }
+}
+
+/* floorf without the call into libm */
+static inline int mf_kernels_floor(float x)
+{
+    int whole = (int)x;
+    return whole > x ? whole - 1 : whole;
+}
+
+/* samples from the first one on, in whole vectors of width, whose fractions first + k * step stay in [0, 1) */
+static inline int mf_kernels_flat(float first, float step, int width, int left)
+{
+    if (first < 0 || first >= 1)
+        return 0;
+    float last = first + (left - 1) * step;
+    if (last >= 0 && last < 1)
+        return left / width * width;
+    int inside = (int)(step > 0 ? (1 - first) / step : first / -step);
+    return inside / width * width;
+}
+
+/* the sample where the fraction of a modulated span crosses an integer, count if it crosses none
+   and -1 if it crosses more than one */
+static inline int mf_kernels_crossing(float frac, float step, int count)
+{
+    float last = frac + (count - 1) * step;
+    if (last >= 0 && last < 1)
+        return count;
+    if (last < -1 || last >= 2)
+        return -1;
+    int cut = (int)(step > 0 ? (1 - frac) / step : frac / -step);
+    while (cut > 0 && (frac + (cut - 1) * step >= 1 || frac + (cut - 1) * step < 0))
+        cut--;
+    while (cut < count && frac + cut * step < 1 && frac + cut * step >= 0)
+        cut++;
+    return cut;
+}
+
+/* moves the read pointer of a modulated kernel by one sample when the first lane of the next vector
+   has crossed an integer, and its fractions the other way */
+#define MF_KERNELS_REBASE(first, read, back, forth) \
+    do { float lane = (first); if (lane >= 1) { back; read++; } else if (lane < 0) { forth; read--; } } while (0)
+
+static void mf_kernels_combModulatedScalar(float *buffer, const float *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        float position = frac + k * step;
+        int whole = mf_kernels_floor(position);
+        const float *r = read + k + whole;
+        float delayout = r[0] + (position - whole) * (r[1] - r[0]);
+        buffer[k] = in[k] + delayout * gain;
+        out[k] = delayout;
+    }
+}
+
+static void mf_kernels_allpassModulatedScalar(float *buffer, const float *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        float input = in[k];
+        float position = frac + k * step;
+        int whole = mf_kernels_floor(position);
+        const float *r = read + k + whole;
+        float delayout = r[0] + (position - whole) * (r[1] - r[0]);
+        buffer[k] = input + delayout * gain;
+        out[k] = delayout - gain * input;
+    }
+}
+
+static void mf_kernels_tapsScalar(const float *buffer, const int *start, const float *gain, int taps, float *out, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        float sum = out[k];
+        for (int t = 0; t < taps; t++)
+        {
+            sum += gain[t] * buffer[start[t] + k];
+        }
+        out[k] = sum;
+    }
+}
+
+/* peaks are kept as the largest magnitude, energies as sums of squares, in the order of MF_KERNELS_METER */
+static inline void mf_kernels_meterScalar(float *meter, float wetl, float wetr, float outl, float outr)
+{
+    const float value[4] = {wetl, wetr, outl, outr};
+    for (int m = 0; m < 4; m++)
+    {
+        meter[m] = fabsf(value[m]) > meter[m] ? fabsf(value[m]) : meter[m];
+        meter[4 + m] += value[m] * value[m];
+    }
+}
+
+/* folds the lanes of the vector accumulators into the meter, once per call */
+static void mf_kernels_meterMerge(float *meter, const float *lanes, int width)
+{
+    for (int m = 0; m < MF_KERNELS_METER; m++)
+    {
+        for (int k = 0; k < width; k++)
+        {
+            float v = lanes[m * width + k];
+            if (m < 4)
+                meter[m] = v > meter[m] ? v : meter[m];
+            else
+                meter[m] += v;
+        }
+    }
+}
+
+static void mf_kernels_mixScalar(const float *in, const float *left, const float *right, float *outl, float *outr, float level, float levelStep, float wet, float wetStep, int count, float *meter)
+{
+    for (int k = 0; k < count; k++)
+    {
+        float dry = in[k];
+        float l = level + k * levelStep;
+        float w = wet + k * wetStep;
+        outl[k] = l * (dry + w * left[k]);
+        outr[k] = l * (dry + w * right[k]);
+        if (meter)
+            mf_kernels_meterScalar(meter, w * left[k], w * right[k], outl[k], outr[k]);
+    }
+}
+
+static void mf_kernels_mixSignalScalar(const float *in, const float *left, const float *right, float *outl, float *outr, const float *level, const float *wet, int count, float *meter)
+{
+    for (int k = 0; k < count; k++)
+    {
+        float dry = in[k];
+        float l = level[k];
+        float w = wet[k];
+        outl[k] = l * (dry + w * left[k]);
+        outr[k] = l * (dry + w * right[k]);
+        if (meter)
+            mf_kernels_meterScalar(meter, w * left[k], w * right[k], outl[k], outr[k]);
+    }
+}
+
+#define MF_KERNELS_SAMPLEWISE 4 /**< blocks up to this size run through the graph sample by sample */
+
+/* up to MF_KERNELS_SAMPLEWISE samples pass all filters one after the other, which has no
+   per filter overhead. Longer blocks run each filter over its spans of the block, a span
+   never reaches samples written in the same span, so the samples are independent */
+static inline __attribute__((always_inline)) void mf_kernels_graphBody(float *const *line, const float *gain, const int *delay, int *counter, int stages, const float *in, float *left, float *right, int count)
+{
+    int filters = MF_KERNELS_COMBS + 2 * stages;
+
+    if (count <= MF_KERNELS_SAMPLEWISE)
+    {
+        for (int k = 0; k < count; k++)
+        {
+            float input = in[k];
+            float sum = 0;
+
+            for (int f = 0; f < MF_KERNELS_COMBS; f++)
+            {
+                int c = counter[f];
+                float delayout = line[f][c];
+                line[f][c] = input + delayout * gain[f];
+                sum += delayout;
+                counter[f] = ++c == delay[f] ? 0 : c;
+            }
+
+            float a = sum / MF_KERNELS_COMBS;
+            float b = a;
+
+            for (int f = MF_KERNELS_COMBS; f < filters; f += 2)
+            {
+                int c = counter[f];
+                float delayout = line[f][c];
+                line[f][c] = a + delayout * gain[f];
+                a = delayout - gain[f] * a;
+                counter[f] = ++c == delay[f] ? 0 : c;
+
+                c = counter[f + 1];
+                delayout = line[f + 1][c];
+                line[f + 1][c] = b + delayout * gain[f + 1];
+                b = delayout - gain[f + 1] * b;
+                counter[f + 1] = ++c == delay[f + 1] ? 0 : c;
+            }
+
+            left[k] = a;
+            right[k] = b;
+        }
+        return;
+    }
+
+    for (int k = 0; k < count; k++)
+    {
+        left[k] = 0;
+    }
+
+    for (int f = 0; f < filters; f++)
+    {
+        float g = gain[f];
+        int c = counter[f];
+        float *chain = f < MF_KERNELS_COMBS || (f - MF_KERNELS_COMBS) % 2 == 0 ? left : right;
+
+        /* the comb sum is complete before the first allpass */
+        if (f == MF_KERNELS_COMBS)
+        {
+            for (int k = 0; k < count; k++)
+            {
+                left[k] = left[k] / MF_KERNELS_COMBS;
+                right[k] = left[k];
+            }
+        }
+
+        for (int k = 0; k < count; )
+        {
+            int span = delay[f] - c < count - k ? delay[f] - c : count - k;
+            float *restrict p = line[f] + c;
+            float *restrict v = chain + k;
+
+            if (f < MF_KERNELS_COMBS)
+            {
+                const float *restrict x = in + k;
+                for (int j = 0; j < span; j++)
+                {
+                    float delayout = p[j];
+                    p[j] = x[j] + delayout * g;
+                    v[j] += delayout;
+                }
+            }
+            else
+            {
+                for (int j = 0; j < span; j++)
+                {
+                    float input = v[j];
+                    float delayout = p[j];
+                    p[j] = input + delayout * g;
+                    v[j] = delayout - g * input;
+                }
+            }
+
+            k += span;
+            c += span;
+            if (c == delay[f])
+                c = 0;
+        }
+        counter[f] = c;
+    }
+
+    /* a graph without allpass stages */
+    if (filters == MF_KERNELS_COMBS)
+    {
+        for (int k = 0; k < count; k++)
+        {
+            left[k] = left[k] / MF_KERNELS_COMBS;
+            right[k] = left[k];
+        }
+    }
+}
+
+static void mf_kernels_graphScalar(float *const *line, const float *gain, const int *delay, int *counter, int stages, const float *in, float *left, float *right, int count)
+{
+    mf_kernels_graphBody(line, gain, delay, counter, stages, in, left, right, count);
+}
+
+static float mf_kernels_halfToFloat(uint16_t h)
+{
+    uint32_t sign = (uint32_t)(h & 0x8000) << 16;
+    uint32_t exponent = (h >> 10) & 0x1f;
+    uint32_t mantissa = h & 0x3ff;
+    uint32_t bits;
+    float f;
+
+    if (exponent == 0)
+    {
+        /* zero and subnormals are multiples of 2^-24 */
+        f = mantissa * 5.9604645e-8f;
+        return sign ? -f : f;
+    }
+    if (exponent == 0x1f)
+        bits = sign | 0x7f800000 | (mantissa << 13);
+    else
+        bits = sign | ((exponent + 112) << 23) | (mantissa << 13);
+    memcpy(&f, &bits, sizeof(f));
+    return f;
+}
+
+static uint16_t mf_kernels_floatToHalf(float f)
+{
+    uint32_t bits;
+    memcpy(&bits, &f, sizeof(bits));
+    uint16_t sign = (bits >> 16) & 0x8000;
+    uint32_t magnitude = bits & 0x7fffffff;
+
+    if (magnitude > 0x7f800000)
+        return sign | 0x7e00;
+    /* 65520 and above round to infinity */
+    if (magnitude >= 0x477ff000)
+        return sign | 0x7c00;
+    if (magnitude < 0x38800000)
+    {
+        /* below 2^-14, adding .5 leaves the value rounded to a multiple of 2^-24 in the mantissa */
+        float rounded;
+        memcpy(&rounded, &magnitude, sizeof(rounded));
+        rounded += .5f;
+        memcpy(&bits, &rounded, sizeof(bits));
+        return sign | (uint16_t)(bits - 0x3f000000);
+    }
+    /* rebias the exponent and round the mantissa to 10 bits, to nearest even */
+    return sign | (uint16_t)((magnitude - 0x38000000 + 0xfff + ((magnitude >> 13) & 1)) >> 13);
+}
+
+static void mf_kernels_combHalfScalar(uint16_t *buffer, const float *in, float *out, float gain, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        float delayout = mf_kernels_halfToFloat(buffer[k]);
+        buffer[k] = mf_kernels_floatToHalf(in[k] + delayout * gain);
+        out[k] = delayout;
+    }
+}
+
+static void mf_kernels_allpassHalfScalar(uint16_t *buffer, const float *in, float *out, float gain, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        float input = in[k];
+        float delayout = mf_kernels_halfToFloat(buffer[k]);
+        buffer[k] = mf_kernels_floatToHalf(input + delayout * gain);
+        out[k] = delayout - gain * input;
+    }
+}
+
+static void mf_kernels_combModulatedHalfScalar(uint16_t *buffer, const uint16_t *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        float position = frac + k * step;
+        int whole = mf_kernels_floor(position);
+        float a = mf_kernels_halfToFloat(read[k + whole]);
+        float delayout = a + (position - whole) * (mf_kernels_halfToFloat(read[k + whole + 1]) - a);
+        buffer[k] = mf_kernels_floatToHalf(in[k] + delayout * gain);
+        out[k] = delayout;
+    }
+}
+
+static void mf_kernels_allpassModulatedHalfScalar(uint16_t *buffer, const uint16_t *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        float input = in[k];
+        float position = frac + k * step;
+        int whole = mf_kernels_floor(position);
+        float a = mf_kernels_halfToFloat(read[k + whole]);
+        float delayout = a + (position - whole) * (mf_kernels_halfToFloat(read[k + whole + 1]) - a);
+        buffer[k] = mf_kernels_floatToHalf(input + delayout * gain);
+        out[k] = delayout - gain * input;
+    }
+}
+
+static void mf_kernels_toFloatScalar(const uint16_t *in, float *out, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        out[k] = mf_kernels_halfToFloat(in[k]);
+    }
+}
+
+static void mf_kernels_toHalfScalar(const float *in, uint16_t *out, int count)
+{
+    for (int k = 0; k < count; k++)
+    {
+        out[k] = mf_kernels_floatToHalf(in[k]);
+    }
+}
+
+/* an exponent of all ones is an infinity or a NaN, the bits are tested so DAZ and FTZ do not matter */
+static int mf_kernels_finiteScalar(const float *in, int count)
+{
+    uint32_t worst = 0;
+    for (int k = 0; k < count; k++)
+    {
+        uint32_t bits;
+        memcpy(&bits, in + k, sizeof(bits));
+        bits &= 0x7f800000;
+        worst = bits > worst ? bits : worst;
+    }
+    return worst != 0x7f800000;
+}
+
+#ifdef MF_KERNELS_X86
+
+/* the vector loops leave the remainder of a span to the scalar versions. The AVX versions
+   clear the upper halves of the registers first: the call may become a jump that skips the
+   vzeroupper of the epilogue, and the SSE code after it would pay for the dirty state */
+
+__attribute__((target("sse2")))
+static void mf_kernels_combSse2(float *buffer, const float *delayed, const float *in, float *out, float gain, int count)
+{
+    __m128 g = _mm_set1_ps(gain);
+    int k = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        __m128 delayout = _mm_loadu_ps(delayed + k);
+        _mm_storeu_ps(buffer + k, _mm_add_ps(_mm_loadu_ps(in + k), _mm_mul_ps(delayout, g)));
+        _mm_storeu_ps(out + k, delayout);
+    }
+    mf_kernels_combScalar(buffer + k, delayed + k, in + k, out + k, gain, count - k);
+}
+
+__attribute__((target("sse2")))
+static void mf_kernels_allpassSse2(float *buffer, const float *delayed, const float *in, float *out, float gain, int count)
+{
+    __m128 g = _mm_set1_ps(gain);
+    int k = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        __m128 input = _mm_loadu_ps(in + k);
+        __m128 delayout = _mm_loadu_ps(delayed + k);
+        _mm_storeu_ps(buffer + k, _mm_add_ps(input, _mm_mul_ps(delayout, g)));
+        _mm_storeu_ps(out + k, _mm_sub_ps(delayout, _mm_mul_ps(g, input)));
+    }
+    mf_kernels_allpassScalar(buffer + k, delayed + k, in + k, out + k, gain, count - k);
+}
+
+/* the modulated kernels keep a vector between the same two neighbours as long as its first lane stays
+   between them and move on by one sample when it crosses; the rare vector whose later lanes have crossed
+   takes them from the neighbours on the other side, reading one sample before or after the span. Ramps
+   that cross more than one integer within a vector are left to the scalar kernels */
+__attribute__((target("sse2")))
+static inline __m128 mf_kernels_interpolateSse2(const float *r, __m128 f, bool flat)
+{
+    __m128 a = _mm_loadu_ps(r);
+    __m128 b = _mm_loadu_ps(r + 1);
+    if (!flat)
+    {
+        __m128 one = _mm_set1_ps(1);
+        __m128 up = _mm_cmpge_ps(f, one);
+        __m128 down = _mm_cmplt_ps(f, _mm_setzero_ps());
+        if (_mm_movemask_ps(_mm_or_ps(up, down)))
+        {
+            __m128 lo = _mm_or_ps(_mm_andnot_ps(up, a), _mm_and_ps(up, b));
+            __m128 hi = _mm_or_ps(_mm_andnot_ps(up, b), _mm_and_ps(up, _mm_loadu_ps(r + 2)));
+            a = _mm_or_ps(_mm_andnot_ps(down, lo), _mm_and_ps(down, _mm_loadu_ps(r - 1)));
+            b = _mm_or_ps(_mm_andnot_ps(down, hi), _mm_and_ps(down, lo));
+            f = _mm_add_ps(_mm_sub_ps(f, _mm_and_ps(up, one)), _mm_and_ps(down, one));
+        }
+    }
+    return _mm_add_ps(a, _mm_mul_ps(f, _mm_sub_ps(b, a)));
+}
+
+__attribute__((target("sse2")))
+static void mf_kernels_combModulatedSse2(float *buffer, const float *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    if (fabsf(step) * 4 >= 1)
+    {
+        mf_kernels_combModulatedScalar(buffer, read, in, out, gain, frac, step, count);
+        return;
+    }
+    __m128 g = _mm_set1_ps(gain);
+    __m128 f = _mm_add_ps(_mm_set1_ps(frac), _mm_mul_ps(_mm_set_ps(3, 2, 1, 0), _mm_set1_ps(step)));
+    __m128 advance = _mm_set1_ps(4 * step);
+    const float *r = read;
+    int k = 0;
+    while (k + 4 <= count)
+    {
+        /* the vectors before the next integer crossing of the fraction skip its test */
+        int end = k + mf_kernels_flat(_mm_cvtss_f32(f), step, 4, count - k);
+        for (; k + 4 <= end; k += 4)
+        {
+            __m128 delayout = mf_kernels_interpolateSse2(r + k, f, true);
+            _mm_storeu_ps(buffer + k, _mm_add_ps(_mm_loadu_ps(in + k), _mm_mul_ps(delayout, g)));
+            _mm_storeu_ps(out + k, delayout);
+            f = _mm_add_ps(f, advance);
+        }
+        if (k + 4 <= count)
+        {
+            __m128 delayout = mf_kernels_interpolateSse2(r + k, f, false);
+            _mm_storeu_ps(buffer + k, _mm_add_ps(_mm_loadu_ps(in + k), _mm_mul_ps(delayout, g)));
+            _mm_storeu_ps(out + k, delayout);
+            f = _mm_add_ps(f, advance);
+            MF_KERNELS_REBASE(_mm_cvtss_f32(f), r, f = _mm_sub_ps(f, _mm_set1_ps(1)), f = _mm_add_ps(f, _mm_set1_ps(1)));
+            k += 4;
+        }
+    }
+    mf_kernels_combModulatedScalar(buffer + k, r + k, in + k, out + k, gain, _mm_cvtss_f32(f), step, count - k);
+}
+
+__attribute__((target("sse2")))
+static void mf_kernels_allpassModulatedSse2(float *buffer, const float *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    if (fabsf(step) * 4 >= 1)
+    {
+        mf_kernels_allpassModulatedScalar(buffer, read, in, out, gain, frac, step, count);
+        return;
+    }
+    __m128 g = _mm_set1_ps(gain);
+    __m128 f = _mm_add_ps(_mm_set1_ps(frac), _mm_mul_ps(_mm_set_ps(3, 2, 1, 0), _mm_set1_ps(step)));
+    __m128 advance = _mm_set1_ps(4 * step);
+    const float *r = read;
+    int k = 0;
+    while (k + 4 <= count)
+    {
+        /* the vectors before the next integer crossing of the fraction skip its test */
+        int end = k + mf_kernels_flat(_mm_cvtss_f32(f), step, 4, count - k);
+        for (; k + 4 <= end; k += 4)
+        {
+            __m128 input = _mm_loadu_ps(in + k);
+            __m128 delayout = mf_kernels_interpolateSse2(r + k, f, true);
+            _mm_storeu_ps(buffer + k, _mm_add_ps(input, _mm_mul_ps(delayout, g)));
+            _mm_storeu_ps(out + k, _mm_sub_ps(delayout, _mm_mul_ps(g, input)));
+            f = _mm_add_ps(f, advance);
+        }
+        if (k + 4 <= count)
+        {
+            __m128 input = _mm_loadu_ps(in + k);
+            __m128 delayout = mf_kernels_interpolateSse2(r + k, f, false);
+            _mm_storeu_ps(buffer + k, _mm_add_ps(input, _mm_mul_ps(delayout, g)));
+            _mm_storeu_ps(out + k, _mm_sub_ps(delayout, _mm_mul_ps(g, input)));
+            f = _mm_add_ps(f, advance);
+            MF_KERNELS_REBASE(_mm_cvtss_f32(f), r, f = _mm_sub_ps(f, _mm_set1_ps(1)), f = _mm_add_ps(f, _mm_set1_ps(1)));
+            k += 4;
+        }
+    }
+    mf_kernels_allpassModulatedScalar(buffer + k, r + k, in + k, out + k, gain, _mm_cvtss_f32(f), step, count - k);
+}
+
+__attribute__((target("sse2")))
+static void mf_kernels_tapsSse2(const float *buffer, const int *start, const float *gain, int taps, float *out, int count)
+{
+    int k = 0;
+
+    /* four independent sums per tap hide the latency of the accumulation */
+    for (; k + 16 <= count; k += 16)
+    {
+        __m128 sum0 = _mm_loadu_ps(out + k);
+        __m128 sum1 = _mm_loadu_ps(out + k + 4);
+        __m128 sum2 = _mm_loadu_ps(out + k + 8);
+        __m128 sum3 = _mm_loadu_ps(out + k + 12);
+        for (int t = 0; t < taps; t++)
+        {
+            __m128 g = _mm_set1_ps(gain[t]);
+            const float *read = buffer + start[t] + k;
+            sum0 = _mm_add_ps(sum0, _mm_mul_ps(g, _mm_loadu_ps(read)));
+            sum1 = _mm_add_ps(sum1, _mm_mul_ps(g, _mm_loadu_ps(read + 4)));
+            sum2 = _mm_add_ps(sum2, _mm_mul_ps(g, _mm_loadu_ps(read + 8)));
+            sum3 = _mm_add_ps(sum3, _mm_mul_ps(g, _mm_loadu_ps(read + 12)));
+        }
+        _mm_storeu_ps(out + k, sum0);
+        _mm_storeu_ps(out + k + 4, sum1);
+        _mm_storeu_ps(out + k + 8, sum2);
+        _mm_storeu_ps(out + k + 12, sum3);
+    }
+    for (; k + 4 <= count; k += 4)
+    {
+        __m128 sum = _mm_loadu_ps(out + k);
+        for (int t = 0; t < taps; t++)
+        {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_set1_ps(gain[t]), _mm_loadu_ps(buffer + start[t] + k)));
+        }
+        _mm_storeu_ps(out + k, sum);
+    }
+    mf_kernels_tapsScalar(buffer + k, start, gain, taps, out + k, count - k);
+}
+
+__attribute__((target("sse2")))
+static inline void mf_kernels_meterSse2(__m128 *acc, __m128 wetl, __m128 wetr, __m128 outl, __m128 outr)
+{
+    const __m128 sign = _mm_set1_ps(-0.f);
+    const __m128 value[4] = {wetl, wetr, outl, outr};
+    for (int m = 0; m < 4; m++)
+    {
+        acc[m] = _mm_max_ps(acc[m], _mm_andnot_ps(sign, value[m]));
+        acc[4 + m] = _mm_add_ps(acc[4 + m], _mm_mul_ps(value[m], value[m]));
+    }
+}
+
+__attribute__((target("sse2")))
+static void mf_kernels_meterStoreSse2(float *meter, const __m128 *acc)
+{
+    float lanes[MF_KERNELS_METER * 4];
+    for (int m = 0; m < MF_KERNELS_METER; m++)
+        _mm_storeu_ps(lanes + 4 * m, acc[m]);
+    mf_kernels_meterMerge(meter, lanes, 4);
+}
+
+__attribute__((target("sse2")))
+static void mf_kernels_mixSse2(const float *in, const float *left, const float *right, float *outl, float *outr, float level, float levelStep, float wet, float wetStep, int count, float *meter)
+{
+    __m128 index = _mm_set_ps(3, 2, 1, 0);
+    __m128 l = _mm_add_ps(_mm_set1_ps(level), _mm_mul_ps(index, _mm_set1_ps(levelStep)));
+    __m128 w = _mm_add_ps(_mm_set1_ps(wet), _mm_mul_ps(index, _mm_set1_ps(wetStep)));
+    __m128 levelAdvance = _mm_set1_ps(4 * levelStep);
+    __m128 wetAdvance = _mm_set1_ps(4 * wetStep);
+    __m128 acc[MF_KERNELS_METER];
+    for (int m = 0; m < MF_KERNELS_METER; m++)
+        acc[m] = _mm_setzero_ps();
+    int k = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        __m128 dry = _mm_loadu_ps(in + k);
+        __m128 wetl = _mm_mul_ps(w, _mm_loadu_ps(left + k));
+        __m128 wetr = _mm_mul_ps(w, _mm_loadu_ps(right + k));
+        __m128 ol = _mm_mul_ps(l, _mm_add_ps(dry, wetl));
+        __m128 or = _mm_mul_ps(l, _mm_add_ps(dry, wetr));
+        _mm_storeu_ps(outl + k, ol);
+        _mm_storeu_ps(outr + k, or);
+        if (meter)
+            mf_kernels_meterSse2(acc, wetl, wetr, ol, or);
+        l = _mm_add_ps(l, levelAdvance);
+        w = _mm_add_ps(w, wetAdvance);
+    }
+    if (meter && k > 0)
+        mf_kernels_meterStoreSse2(meter, acc);
+    mf_kernels_mixScalar(in + k, left + k, right + k, outl + k, outr + k, level + k * levelStep, levelStep, wet + k * wetStep, wetStep, count - k, meter);
+}
+
+__attribute__((target("sse2")))
+static void mf_kernels_mixSignalSse2(const float *in, const float *left, const float *right, float *outl, float *outr, const float *level, const float *wet, int count, float *meter)
+{
+    __m128 acc[MF_KERNELS_METER];
+    for (int m = 0; m < MF_KERNELS_METER; m++)
+        acc[m] = _mm_setzero_ps();
+    int k = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        __m128 dry = _mm_loadu_ps(in + k);
+        __m128 l = _mm_loadu_ps(level + k);
+        __m128 w = _mm_loadu_ps(wet + k);
+        __m128 wetl = _mm_mul_ps(w, _mm_loadu_ps(left + k));
+        __m128 wetr = _mm_mul_ps(w, _mm_loadu_ps(right + k));
+        __m128 ol = _mm_mul_ps(l, _mm_add_ps(dry, wetl));
+        __m128 or = _mm_mul_ps(l, _mm_add_ps(dry, wetr));
+        _mm_storeu_ps(outl + k, ol);
+        _mm_storeu_ps(outr + k, or);
+        if (meter)
+            mf_kernels_meterSse2(acc, wetl, wetr, ol, or);
+    }
+    if (meter && k > 0)
+        mf_kernels_meterStoreSse2(meter, acc);
+    mf_kernels_mixSignalScalar(in + k, left + k, right + k, outl + k, outr + k, level + k, wet + k, count - k, meter);
+}
+
+__attribute__((target("sse2")))
+static int mf_kernels_finiteSse2(const float *in, int count)
+{
+    __m128i exponent = _mm_set1_epi32(0x7f800000);
+    __m128i found = _mm_setzero_si128();
+    int k = 0;
+    for (; k + 4 <= count; k += 4)
+    {
+        __m128i bits = _mm_and_si128(_mm_castps_si128(_mm_loadu_ps(in + k)), exponent);
+        found = _mm_or_si128(found, _mm_cmpeq_epi32(bits, exponent));
+    }
+    return _mm_movemask_epi8(found) == 0 && mf_kernels_finiteScalar(in + k, count - k);
+}
+
+__attribute__((target("avx2,fma")))
+static void mf_kernels_combAvx2(float *buffer, const float *delayed, const float *in, float *out, float gain, int count)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    int k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        __m256 delayout = _mm256_loadu_ps(delayed + k);
+        _mm256_storeu_ps(buffer + k, _mm256_fmadd_ps(delayout, g, _mm256_loadu_ps(in + k)));
+        _mm256_storeu_ps(out + k, delayout);
+    }
+    _mm256_zeroupper();
+    mf_kernels_combScalar(buffer + k, delayed + k, in + k, out + k, gain, count - k);
+}
+
+__attribute__((target("avx2,fma")))
+static void mf_kernels_allpassAvx2(float *buffer, const float *delayed, const float *in, float *out, float gain, int count)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    int k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        __m256 input = _mm256_loadu_ps(in + k);
+        __m256 delayout = _mm256_loadu_ps(delayed + k);
+        _mm256_storeu_ps(buffer + k, _mm256_fmadd_ps(delayout, g, input));
+        _mm256_storeu_ps(out + k, _mm256_fnmadd_ps(g, input, delayout));
+    }
+    _mm256_zeroupper();
+    mf_kernels_allpassScalar(buffer + k, delayed + k, in + k, out + k, gain, count - k);
+}
+
+__attribute__((target("avx2,fma")))
+static inline __m256 mf_kernels_interpolateAvx2(const float *r, __m256 f, __m256i m, bool tail, bool flat)
+{
+    __m256 a = tail ? _mm256_maskload_ps(r, m) : _mm256_loadu_ps(r);
+    __m256 b = tail ? _mm256_maskload_ps(r + 1, m) : _mm256_loadu_ps(r + 1);
+    if (!flat)
+    {
+        __m256 one = _mm256_set1_ps(1);
+        __m256 up = _mm256_cmp_ps(f, one, _CMP_GE_OQ);
+        __m256 down = _mm256_cmp_ps(f, _mm256_setzero_ps(), _CMP_LT_OQ);
+        if (_mm256_movemask_ps(_mm256_or_ps(up, down)))
+        {
+            __m256 lo = _mm256_blendv_ps(a, b, up);
+            __m256 hi = _mm256_blendv_ps(b, tail ? _mm256_maskload_ps(r + 2, m) : _mm256_loadu_ps(r + 2), up);
+            a = _mm256_blendv_ps(lo, tail ? _mm256_maskload_ps(r - 1, m) : _mm256_loadu_ps(r - 1), down);
+            b = _mm256_blendv_ps(hi, lo, down);
+            f = _mm256_add_ps(_mm256_sub_ps(f, _mm256_and_ps(up, one)), _mm256_and_ps(down, one));
+        }
+    }
+    return _mm256_fmadd_ps(f, _mm256_sub_ps(b, a), a);
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static inline __m256 mf_kernels_interpolateHalfAvx2(const uint16_t *r, __m256 f, bool flat)
+{
+    __m256 a = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)r));
+    __m256 b = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(r + 1)));
+    if (!flat)
+    {
+        __m256 one = _mm256_set1_ps(1);
+        __m256 up = _mm256_cmp_ps(f, one, _CMP_GE_OQ);
+        __m256 down = _mm256_cmp_ps(f, _mm256_setzero_ps(), _CMP_LT_OQ);
+        if (_mm256_movemask_ps(_mm256_or_ps(up, down)))
+        {
+            __m256 lo = _mm256_blendv_ps(a, b, up);
+            __m256 hi = _mm256_blendv_ps(b, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(r + 2))), up);
+            a = _mm256_blendv_ps(lo, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(r - 1))), down);
+            b = _mm256_blendv_ps(hi, lo, down);
+            f = _mm256_add_ps(_mm256_sub_ps(f, _mm256_and_ps(up, one)), _mm256_and_ps(down, one));
+        }
+    }
+    return _mm256_fmadd_ps(f, _mm256_sub_ps(b, a), a);
+}
+
+__attribute__((target("avx2,fma")))
+static void mf_kernels_combModulatedAvx2(float *buffer, const float *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    if (fabsf(step) * 8 >= 1)
+    {
+        mf_kernels_combModulatedScalar(buffer, read, in, out, gain, frac, step, count);
+        return;
+    }
+    __m256 g = _mm256_set1_ps(gain);
+    __m256 f = _mm256_fmadd_ps(_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_ps(step), _mm256_set1_ps(frac));
+    __m256 advance = _mm256_set1_ps(8 * step);
+    __m256i all = _mm256_set1_epi32(-1);
+    const float *r = read;
+    int k = 0;
+    while (k + 8 <= count)
+    {
+        /* the vectors before the next integer crossing of the fraction skip its test */
+        int end = k + mf_kernels_flat(_mm256_cvtss_f32(f), step, 8, count - k);
+        for (; k + 8 <= end; k += 8)
+        {
+            __m256 delayout = mf_kernels_interpolateAvx2(r + k, f, all, false, true);
+            _mm256_storeu_ps(buffer + k, _mm256_fmadd_ps(delayout, g, _mm256_loadu_ps(in + k)));
+            _mm256_storeu_ps(out + k, delayout);
+            f = _mm256_add_ps(f, advance);
+        }
+        if (k + 8 <= count)
+        {
+            __m256 delayout = mf_kernels_interpolateAvx2(r + k, f, all, false, false);
+            _mm256_storeu_ps(buffer + k, _mm256_fmadd_ps(delayout, g, _mm256_loadu_ps(in + k)));
+            _mm256_storeu_ps(out + k, delayout);
+            f = _mm256_add_ps(f, advance);
+            MF_KERNELS_REBASE(_mm256_cvtss_f32(f), r, f = _mm256_sub_ps(f, _mm256_set1_ps(1)), f = _mm256_add_ps(f, _mm256_set1_ps(1)));
+            k += 8;
+        }
+    }
+    if (k < count)
+    {
+        __m256i m = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - k), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+        __m256 delayout = mf_kernels_interpolateAvx2(r + k, f, m, true, false);
+        _mm256_maskstore_ps(buffer + k, m, _mm256_fmadd_ps(delayout, g, _mm256_maskload_ps(in + k, m)));
+        _mm256_maskstore_ps(out + k, m, delayout);
+    }
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx2,fma")))
+static void mf_kernels_allpassModulatedAvx2(float *buffer, const float *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    if (fabsf(step) * 8 >= 1)
+    {
+        mf_kernels_allpassModulatedScalar(buffer, read, in, out, gain, frac, step, count);
+        return;
+    }
+    __m256 g = _mm256_set1_ps(gain);
+    __m256 f = _mm256_fmadd_ps(_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_ps(step), _mm256_set1_ps(frac));
+    __m256 advance = _mm256_set1_ps(8 * step);
+    __m256i all = _mm256_set1_epi32(-1);
+    const float *r = read;
+    int k = 0;
+    while (k + 8 <= count)
+    {
+        /* the vectors before the next integer crossing of the fraction skip its test */
+        int end = k + mf_kernels_flat(_mm256_cvtss_f32(f), step, 8, count - k);
+        for (; k + 8 <= end; k += 8)
+        {
+            __m256 input = _mm256_loadu_ps(in + k);
+            __m256 delayout = mf_kernels_interpolateAvx2(r + k, f, all, false, true);
+            _mm256_storeu_ps(buffer + k, _mm256_fmadd_ps(delayout, g, input));
+            _mm256_storeu_ps(out + k, _mm256_fnmadd_ps(g, input, delayout));
+            f = _mm256_add_ps(f, advance);
+        }
+        if (k + 8 <= count)
+        {
+            __m256 input = _mm256_loadu_ps(in + k);
+            __m256 delayout = mf_kernels_interpolateAvx2(r + k, f, all, false, false);
+            _mm256_storeu_ps(buffer + k, _mm256_fmadd_ps(delayout, g, input));
+            _mm256_storeu_ps(out + k, _mm256_fnmadd_ps(g, input, delayout));
+            f = _mm256_add_ps(f, advance);
+            MF_KERNELS_REBASE(_mm256_cvtss_f32(f), r, f = _mm256_sub_ps(f, _mm256_set1_ps(1)), f = _mm256_add_ps(f, _mm256_set1_ps(1)));
+            k += 8;
+        }
+    }
+    if (k < count)
+    {
+        __m256i m = _mm256_cmpgt_epi32(_mm256_set1_epi32(count - k), _mm256_set_epi32(7, 6, 5, 4, 3, 2, 1, 0));
+        __m256 input = _mm256_maskload_ps(in + k, m);
+        __m256 delayout = mf_kernels_interpolateAvx2(r + k, f, m, true, false);
+        _mm256_maskstore_ps(buffer + k, m, _mm256_fmadd_ps(delayout, g, input));
+        _mm256_maskstore_ps(out + k, m, _mm256_fnmadd_ps(g, input, delayout));
+    }
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx2,fma")))
+static void mf_kernels_tapsAvx2(const float *buffer, const int *start, const float *gain, int taps, float *out, int count)
+{
+    int k = 0;
+
+    /* four independent sums per tap hide the latency of the accumulation */
+    for (; k + 32 <= count; k += 32)
+    {
+        __m256 sum0 = _mm256_loadu_ps(out + k);
+        __m256 sum1 = _mm256_loadu_ps(out + k + 8);
+        __m256 sum2 = _mm256_loadu_ps(out + k + 16);
+        __m256 sum3 = _mm256_loadu_ps(out + k + 24);
+        for (int t = 0; t < taps; t++)
+        {
+            __m256 g = _mm256_set1_ps(gain[t]);
+            const float *read = buffer + start[t] + k;
+            sum0 = _mm256_fmadd_ps(g, _mm256_loadu_ps(read), sum0);
+            sum1 = _mm256_fmadd_ps(g, _mm256_loadu_ps(read + 8), sum1);
+            sum2 = _mm256_fmadd_ps(g, _mm256_loadu_ps(read + 16), sum2);
+            sum3 = _mm256_fmadd_ps(g, _mm256_loadu_ps(read + 24), sum3);
+        }
+        _mm256_storeu_ps(out + k, sum0);
+        _mm256_storeu_ps(out + k + 8, sum1);
+        _mm256_storeu_ps(out + k + 16, sum2);
+        _mm256_storeu_ps(out + k + 24, sum3);
+    }
+    for (; k + 8 <= count; k += 8)
+    {
+        __m256 sum = _mm256_loadu_ps(out + k);
+        for (int t = 0; t < taps; t++)
+        {
+            sum = _mm256_fmadd_ps(_mm256_set1_ps(gain[t]), _mm256_loadu_ps(buffer + start[t] + k), sum);
+        }
+        _mm256_storeu_ps(out + k, sum);
+    }
+    _mm256_zeroupper();
+    mf_kernels_tapsScalar(buffer + k, start, gain, taps, out + k, count - k);
+}
+
+__attribute__((target("avx2,fma")))
+static inline void mf_kernels_meterAvx2(__m256 *acc, __m256 wetl, __m256 wetr, __m256 outl, __m256 outr)
+{
+    const __m256 sign = _mm256_set1_ps(-0.f);
+    const __m256 value[4] = {wetl, wetr, outl, outr};
+    for (int m = 0; m < 4; m++)
+    {
+        acc[m] = _mm256_max_ps(acc[m], _mm256_andnot_ps(sign, value[m]));
+        acc[4 + m] = _mm256_fmadd_ps(value[m], value[m], acc[4 + m]);
+    }
+}
+
+__attribute__((target("avx2,fma")))
+static void mf_kernels_meterStoreAvx2(float *meter, const __m256 *acc)
+{
+    float lanes[MF_KERNELS_METER * 4];
+    for (int m = 0; m < MF_KERNELS_METER; m++)
+    {
+        __m128 low = _mm256_castps256_ps128(acc[m]);
+        __m128 high = _mm256_extractf128_ps(acc[m], 1);
+        _mm_storeu_ps(lanes + 4 * m, m < 4 ? _mm_max_ps(low, high) : _mm_add_ps(low, high));
+    }
+    mf_kernels_meterMerge(meter, lanes, 4);
+}
+
+__attribute__((target("avx2,fma")))
+static void mf_kernels_mixAvx2(const float *in, const float *left, const float *right, float *outl, float *outr, float level, float levelStep, float wet, float wetStep, int count, float *meter)
+{
+    __m256 index = _mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0);
+    __m256 l = _mm256_fmadd_ps(index, _mm256_set1_ps(levelStep), _mm256_set1_ps(level));
+    __m256 w = _mm256_fmadd_ps(index, _mm256_set1_ps(wetStep), _mm256_set1_ps(wet));
+    __m256 levelAdvance = _mm256_set1_ps(8 * levelStep);
+    __m256 wetAdvance = _mm256_set1_ps(8 * wetStep);
+    __m256 acc[MF_KERNELS_METER];
+    for (int m = 0; m < MF_KERNELS_METER; m++)
+        acc[m] = _mm256_setzero_ps();
+    int k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        __m256 dry = _mm256_loadu_ps(in + k);
+        __m256 left8 = _mm256_loadu_ps(left + k);
+        __m256 right8 = _mm256_loadu_ps(right + k);
+        __m256 ol = _mm256_mul_ps(l, _mm256_fmadd_ps(w, left8, dry));
+        __m256 or = _mm256_mul_ps(l, _mm256_fmadd_ps(w, right8, dry));
+        _mm256_storeu_ps(outl + k, ol);
+        _mm256_storeu_ps(outr + k, or);
+        if (meter)
+            mf_kernels_meterAvx2(acc, _mm256_mul_ps(w, left8), _mm256_mul_ps(w, right8), ol, or);
+        l = _mm256_add_ps(l, levelAdvance);
+        w = _mm256_add_ps(w, wetAdvance);
+    }
+    if (meter && k > 0)
+        mf_kernels_meterStoreAvx2(meter, acc);
+    _mm256_zeroupper();
+    mf_kernels_mixScalar(in + k, left + k, right + k, outl + k, outr + k, level + k * levelStep, levelStep, wet + k * wetStep, wetStep, count - k, meter);
+}
+
+__attribute__((target("avx2,fma")))
+static void mf_kernels_mixSignalAvx2(const float *in, const float *left, const float *right, float *outl, float *outr, const float *level, const float *wet, int count, float *meter)
+{
+    __m256 acc[MF_KERNELS_METER];
+    for (int m = 0; m < MF_KERNELS_METER; m++)
+        acc[m] = _mm256_setzero_ps();
+    int k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        __m256 dry = _mm256_loadu_ps(in + k);
+        __m256 l = _mm256_loadu_ps(level + k);
+        __m256 w = _mm256_loadu_ps(wet + k);
+        __m256 left8 = _mm256_loadu_ps(left + k);
+        __m256 right8 = _mm256_loadu_ps(right + k);
+        __m256 ol = _mm256_mul_ps(l, _mm256_fmadd_ps(w, left8, dry));
+        __m256 or = _mm256_mul_ps(l, _mm256_fmadd_ps(w, right8, dry));
+        _mm256_storeu_ps(outl + k, ol);
+        _mm256_storeu_ps(outr + k, or);
+        if (meter)
+            mf_kernels_meterAvx2(acc, _mm256_mul_ps(w, left8), _mm256_mul_ps(w, right8), ol, or);
+    }
+    if (meter && k > 0)
+        mf_kernels_meterStoreAvx2(meter, acc);
+    _mm256_zeroupper();
+    mf_kernels_mixSignalScalar(in + k, left + k, right + k, outl + k, outr + k, level + k, wet + k, count - k, meter);
+}
+
+/* the scalar loop with FMA, a stage costs one fused multiply-add of latency instead of two operations */
+__attribute__((target("avx2,fma")))
+static void mf_kernels_graphAvx2(float *const *line, const float *gain, const int *delay, int *counter, int stages, const float *in, float *left, float *right, int count)
+{
+    mf_kernels_graphBody(line, gain, delay, counter, stages, in, left, right, count);
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static void mf_kernels_combHalfAvx2(uint16_t *buffer, const float *in, float *out, float gain, int count)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    int k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        __m256 delayout = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(buffer + k)));
+        _mm_storeu_si128((__m128i *)(buffer + k), _mm256_cvtps_ph(_mm256_fmadd_ps(delayout, g, _mm256_loadu_ps(in + k)), _MM_FROUND_TO_NEAREST_INT));
+        _mm256_storeu_ps(out + k, delayout);
+    }
+    _mm256_zeroupper();
+    mf_kernels_combHalfScalar(buffer + k, in + k, out + k, gain, count - k);
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static void mf_kernels_allpassHalfAvx2(uint16_t *buffer, const float *in, float *out, float gain, int count)
+{
+    __m256 g = _mm256_set1_ps(gain);
+    int k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        __m256 input = _mm256_loadu_ps(in + k);
+        __m256 delayout = _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(buffer + k)));
+        _mm_storeu_si128((__m128i *)(buffer + k), _mm256_cvtps_ph(_mm256_fmadd_ps(delayout, g, input), _MM_FROUND_TO_NEAREST_INT));
+        _mm256_storeu_ps(out + k, _mm256_fnmadd_ps(g, input, delayout));
+    }
+    _mm256_zeroupper();
+    mf_kernels_allpassHalfScalar(buffer + k, in + k, out + k, gain, count - k);
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static void mf_kernels_combModulatedHalfAvx2(uint16_t *buffer, const uint16_t *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    if (fabsf(step) * 8 >= 1)
+    {
+        mf_kernels_combModulatedHalfScalar(buffer, read, in, out, gain, frac, step, count);
+        return;
+    }
+    __m256 g = _mm256_set1_ps(gain);
+    __m256 f = _mm256_fmadd_ps(_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_ps(step), _mm256_set1_ps(frac));
+    __m256 advance = _mm256_set1_ps(8 * step);
+    const uint16_t *r = read;
+    int k = 0;
+    while (k + 8 <= count)
+    {
+        /* the vectors before the next integer crossing of the fraction skip its test */
+        int end = k + mf_kernels_flat(_mm256_cvtss_f32(f), step, 8, count - k);
+        for (; k + 8 <= end; k += 8)
+        {
+            __m256 delayout = mf_kernels_interpolateHalfAvx2(r + k, f, true);
+            _mm_storeu_si128((__m128i *)(buffer + k), _mm256_cvtps_ph(_mm256_fmadd_ps(delayout, g, _mm256_loadu_ps(in + k)), _MM_FROUND_TO_NEAREST_INT));
+            _mm256_storeu_ps(out + k, delayout);
+            f = _mm256_add_ps(f, advance);
+        }
+        if (k + 8 <= count)
+        {
+            __m256 delayout = mf_kernels_interpolateHalfAvx2(r + k, f, false);
+            _mm_storeu_si128((__m128i *)(buffer + k), _mm256_cvtps_ph(_mm256_fmadd_ps(delayout, g, _mm256_loadu_ps(in + k)), _MM_FROUND_TO_NEAREST_INT));
+            _mm256_storeu_ps(out + k, delayout);
+            f = _mm256_add_ps(f, advance);
+            MF_KERNELS_REBASE(_mm256_cvtss_f32(f), r, f = _mm256_sub_ps(f, _mm256_set1_ps(1)), f = _mm256_add_ps(f, _mm256_set1_ps(1)));
+            k += 8;
+        }
+    }
+    float rest = _mm256_cvtss_f32(f);
+    _mm256_zeroupper();
+    mf_kernels_combModulatedHalfScalar(buffer + k, r + k, in + k, out + k, gain, rest, step, count - k);
+}
+
+__attribute__((target("avx2,fma,f16c")))
+static void mf_kernels_allpassModulatedHalfAvx2(uint16_t *buffer, const uint16_t *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    if (fabsf(step) * 8 >= 1)
+    {
+        mf_kernels_allpassModulatedHalfScalar(buffer, read, in, out, gain, frac, step, count);
+        return;
+    }
+    __m256 g = _mm256_set1_ps(gain);
+    __m256 f = _mm256_fmadd_ps(_mm256_set_ps(7, 6, 5, 4, 3, 2, 1, 0), _mm256_set1_ps(step), _mm256_set1_ps(frac));
+    __m256 advance = _mm256_set1_ps(8 * step);
+    const uint16_t *r = read;
+    int k = 0;
+    while (k + 8 <= count)
+    {
+        /* the vectors before the next integer crossing of the fraction skip its test */
+        int end = k + mf_kernels_flat(_mm256_cvtss_f32(f), step, 8, count - k);
+        for (; k + 8 <= end; k += 8)
+        {
+            __m256 input = _mm256_loadu_ps(in + k);
+            __m256 delayout = mf_kernels_interpolateHalfAvx2(r + k, f, true);
+            _mm_storeu_si128((__m128i *)(buffer + k), _mm256_cvtps_ph(_mm256_fmadd_ps(delayout, g, input), _MM_FROUND_TO_NEAREST_INT));
+            _mm256_storeu_ps(out + k, _mm256_fnmadd_ps(g, input, delayout));
+            f = _mm256_add_ps(f, advance);
+        }
+        if (k + 8 <= count)
+        {
+            __m256 input = _mm256_loadu_ps(in + k);
+            __m256 delayout = mf_kernels_interpolateHalfAvx2(r + k, f, false);
+            _mm_storeu_si128((__m128i *)(buffer + k), _mm256_cvtps_ph(_mm256_fmadd_ps(delayout, g, input), _MM_FROUND_TO_NEAREST_INT));
+            _mm256_storeu_ps(out + k, _mm256_fnmadd_ps(g, input, delayout));
+            f = _mm256_add_ps(f, advance);
+            MF_KERNELS_REBASE(_mm256_cvtss_f32(f), r, f = _mm256_sub_ps(f, _mm256_set1_ps(1)), f = _mm256_add_ps(f, _mm256_set1_ps(1)));
+            k += 8;
+        }
+    }
+    float rest = _mm256_cvtss_f32(f);
+    _mm256_zeroupper();
+    mf_kernels_allpassModulatedHalfScalar(buffer + k, r + k, in + k, out + k, gain, rest, step, count - k);
+}
+
+__attribute__((target("avx2,f16c")))
+static void mf_kernels_toFloatAvx2(const uint16_t *in, float *out, int count)
+{
+    int k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        _mm256_storeu_ps(out + k, _mm256_cvtph_ps(_mm_loadu_si128((const __m128i *)(in + k))));
+    }
+    _mm256_zeroupper();
+    mf_kernels_toFloatScalar(in + k, out + k, count - k);
+}
+
+__attribute__((target("avx2,f16c")))
+static void mf_kernels_toHalfAvx2(const float *in, uint16_t *out, int count)
+{
+    int k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        _mm_storeu_si128((__m128i *)(out + k), _mm256_cvtps_ph(_mm256_loadu_ps(in + k), _MM_FROUND_TO_NEAREST_INT));
+    }
+    _mm256_zeroupper();
+    mf_kernels_toHalfScalar(in + k, out + k, count - k);
+}
+
+__attribute__((target("avx2")))
+static int mf_kernels_finiteAvx2(const float *in, int count)
+{
+    __m256i exponent = _mm256_set1_epi32(0x7f800000);
+    __m256i found = _mm256_setzero_si256();
+    int k = 0;
+    for (; k + 8 <= count; k += 8)
+    {
+        __m256i bits = _mm256_and_si256(_mm256_castps_si256(_mm256_loadu_ps(in + k)), exponent);
+        found = _mm256_or_si256(found, _mm256_cmpeq_epi32(bits, exponent));
+    }
+    int clean = _mm256_testz_si256(found, found);
+    _mm256_zeroupper();
+    return clean && mf_kernels_finiteScalar(in + k, count - k);
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_combAvx512(float *buffer, const float *delayed, const float *in, float *out, float gain, int count)
+{
+    __m512 g = _mm512_set1_ps(gain);
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        __m512 delayout = _mm512_loadu_ps(delayed + k);
+        _mm512_storeu_ps(buffer + k, _mm512_fmadd_ps(delayout, g, _mm512_loadu_ps(in + k)));
+        _mm512_storeu_ps(out + k, delayout);
+    }
+    _mm256_zeroupper();
+    mf_kernels_combScalar(buffer + k, delayed + k, in + k, out + k, gain, count - k);
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_allpassAvx512(float *buffer, const float *delayed, const float *in, float *out, float gain, int count)
+{
+    __m512 g = _mm512_set1_ps(gain);
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        __m512 input = _mm512_loadu_ps(in + k);
+        __m512 delayout = _mm512_loadu_ps(delayed + k);
+        _mm512_storeu_ps(buffer + k, _mm512_fmadd_ps(delayout, g, input));
+        _mm512_storeu_ps(out + k, _mm512_fnmadd_ps(g, input, delayout));
+    }
+    _mm256_zeroupper();
+    mf_kernels_allpassScalar(buffer + k, delayed + k, in + k, out + k, gain, count - k);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 mf_kernels_interpolateAvx512(const float *r, __m512 f, __mmask16 m, bool flat)
+{
+    __m512 a = _mm512_maskz_loadu_ps(m, r);
+    __m512 b = _mm512_maskz_loadu_ps(m, r + 1);
+    if (!flat)
+    {
+        __m512 one = _mm512_set1_ps(1);
+        __mmask16 up = _mm512_mask_cmp_ps_mask(m, f, one, _CMP_GE_OQ);
+        __mmask16 down = _mm512_mask_cmp_ps_mask(m, f, _mm512_setzero_ps(), _CMP_LT_OQ);
+        if (up | down)
+        {
+            __m512 lo = _mm512_mask_loadu_ps(a, up, r + 1);
+            __m512 hi = _mm512_mask_loadu_ps(b, up, r + 2);
+            a = _mm512_mask_loadu_ps(lo, down, r - 1);
+            b = _mm512_mask_blend_ps(down, hi, lo);
+            f = _mm512_mask_add_ps(_mm512_mask_sub_ps(f, up, f, one), down, f, one);
+        }
+    }
+    return _mm512_fmadd_ps(f, _mm512_sub_ps(b, a), a);
+}
+
+/* b holds the samples one behind a, taken from a and the vector after it instead of loaded again */
+__attribute__((target("avx512f")))
+static inline __m512 mf_kernels_interpolateNextAvx512(__m512 a, __m512 next, __m512 f)
+{
+    __m512 b = _mm512_castsi512_ps(_mm512_alignr_epi32(_mm512_castps_si512(next), _mm512_castps_si512(a), 1));
+    return _mm512_fmadd_ps(f, _mm512_sub_ps(b, a), a);
+}
+
+__attribute__((target("avx512f")))
+static inline __m512 mf_kernels_interpolateHalfAvx512(const uint16_t *r, __m512 f, bool flat)
+{
+    __m512 a = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)r));
+    __m512 b = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(r + 1)));
+    if (!flat)
+    {
+        __m512 one = _mm512_set1_ps(1);
+        __mmask16 up = _mm512_cmp_ps_mask(f, one, _CMP_GE_OQ);
+        __mmask16 down = _mm512_cmp_ps_mask(f, _mm512_setzero_ps(), _CMP_LT_OQ);
+        if (up | down)
+        {
+            __m512 lo = _mm512_mask_blend_ps(up, a, b);
+            __m512 hi = _mm512_mask_blend_ps(up, b, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(r + 2))));
+            a = _mm512_mask_blend_ps(down, lo, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(r - 1))));
+            b = _mm512_mask_blend_ps(down, hi, lo);
+            f = _mm512_mask_add_ps(_mm512_mask_sub_ps(f, up, f, one), down, f, one);
+        }
+    }
+    return _mm512_fmadd_ps(f, _mm512_sub_ps(b, a), a);
+}
+
+/* a modulated span whose fraction does not cross an integer, every sample is read once */
+__attribute__((target("avx512f")))
+static inline void mf_kernels_combFlatAvx512(float *buffer, const float *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    __m512 g = _mm512_set1_ps(gain);
+    __m512 f = _mm512_fmadd_ps(_mm512_set_ps(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), _mm512_set1_ps(step), _mm512_set1_ps(frac));
+    __m512 advance = _mm512_set1_ps(16 * step);
+    int k = 0;
+    if (count >= 16)
+    {
+        __m512 a = _mm512_loadu_ps(read);
+        for (; k + 32 <= count; k += 16)
+        {
+            __m512 input = _mm512_loadu_ps(in + k);
+            __m512 next = _mm512_loadu_ps(read + k + 16);
+            __m512 delayout = mf_kernels_interpolateNextAvx512(a, next, f);
+            _mm512_storeu_ps(buffer + k, _mm512_fmadd_ps(delayout, g, input));
+            _mm512_storeu_ps(out + k, delayout);
+            f = _mm512_add_ps(f, advance);
+            a = next;
+        }
+        __m512 input = _mm512_loadu_ps(in + k);
+        __m512 delayout = _mm512_fmadd_ps(f, _mm512_sub_ps(_mm512_loadu_ps(read + k + 1), a), a);
+        _mm512_storeu_ps(buffer + k, _mm512_fmadd_ps(delayout, g, input));
+        _mm512_storeu_ps(out + k, delayout);
+        f = _mm512_add_ps(f, advance);
+        k += 16;
+    }
+    if (k < count)
+    {
+        __mmask16 m = (__mmask16)((1u << (count - k)) - 1);
+        __m512 input = _mm512_maskz_loadu_ps(m, in + k);
+        __m512 a = _mm512_maskz_loadu_ps(m, read + k);
+        __m512 delayout = _mm512_fmadd_ps(f, _mm512_sub_ps(_mm512_maskz_loadu_ps(m, read + k + 1), a), a);
+        _mm512_mask_storeu_ps(buffer + k, m, _mm512_fmadd_ps(delayout, g, input));
+        _mm512_mask_storeu_ps(out + k, m, delayout);
+    }
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_combModulatedAvx512(float *buffer, const float *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    /* most spans lie between two integer crossings of the fraction or cross one, and are cut there */
+    int cut = mf_kernels_crossing(frac, step, count);
+    if (cut == count)
+    {
+        mf_kernels_combFlatAvx512(buffer, read, in, out, gain, frac, step, count);
+        return;
+    }
+    if (cut >= 0)
+    {
+        int shift = step > 0 ? 1 : -1;
+        mf_kernels_combFlatAvx512(buffer, read, in, out, gain, frac, step, cut);
+        mf_kernels_combFlatAvx512(buffer + cut, read + cut + shift, in + cut, out + cut, gain, frac + cut * step - shift, step, count - cut);
+        return;
+    }
+    if (fabsf(step) * 16 >= 1)
+    {
+        mf_kernels_combModulatedScalar(buffer, read, in, out, gain, frac, step, count);
+        return;
+    }
+    __m512 g = _mm512_set1_ps(gain);
+    __m512 f = _mm512_fmadd_ps(_mm512_set_ps(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), _mm512_set1_ps(step), _mm512_set1_ps(frac));
+    __m512 advance = _mm512_set1_ps(16 * step);
+    const float *r = read;
+    int k = 0;
+    while (k + 16 <= count)
+    {
+        /* the vectors before the next integer crossing of the fraction skip its test */
+        int end = k + mf_kernels_flat(_mm512_cvtss_f32(f), step, 16, count - k);
+        __m512 a = _mm512_loadu_ps(r + k);
+        for (; k + 16 < end; k += 16)
+        {
+            __m512 next = _mm512_loadu_ps(r + k + 16);
+            __m512 delayout = mf_kernels_interpolateNextAvx512(a, next, f);
+            _mm512_storeu_ps(buffer + k, _mm512_fmadd_ps(delayout, g, _mm512_loadu_ps(in + k)));
+            _mm512_storeu_ps(out + k, delayout);
+            f = _mm512_add_ps(f, advance);
+            a = next;
+        }
+        for (; k + 16 <= end; k += 16)
+        {
+            __m512 delayout = mf_kernels_interpolateAvx512(r + k, f, 0xffff, true);
+            _mm512_storeu_ps(buffer + k, _mm512_fmadd_ps(delayout, g, _mm512_loadu_ps(in + k)));
+            _mm512_storeu_ps(out + k, delayout);
+            f = _mm512_add_ps(f, advance);
+        }
+        if (k + 16 <= count)
+        {
+            __m512 delayout = mf_kernels_interpolateAvx512(r + k, f, 0xffff, false);
+            _mm512_storeu_ps(buffer + k, _mm512_fmadd_ps(delayout, g, _mm512_loadu_ps(in + k)));
+            _mm512_storeu_ps(out + k, delayout);
+            f = _mm512_add_ps(f, advance);
+            MF_KERNELS_REBASE(_mm512_cvtss_f32(f), r, f = _mm512_sub_ps(f, _mm512_set1_ps(1)), f = _mm512_add_ps(f, _mm512_set1_ps(1)));
+            k += 16;
+        }
+    }
+    if (k < count)
+    {
+        __mmask16 m = (__mmask16)((1u << (count - k)) - 1);
+        __m512 delayout = mf_kernels_interpolateAvx512(r + k, f, m, false);
+        _mm512_mask_storeu_ps(buffer + k, m, _mm512_fmadd_ps(delayout, g, _mm512_maskz_loadu_ps(m, in + k)));
+        _mm512_mask_storeu_ps(out + k, m, delayout);
+    }
+    _mm256_zeroupper();
+}
+
+/* a modulated span whose fraction does not cross an integer, every sample is read once */
+__attribute__((target("avx512f")))
+static inline void mf_kernels_allpassFlatAvx512(float *buffer, const float *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    __m512 g = _mm512_set1_ps(gain);
+    __m512 f = _mm512_fmadd_ps(_mm512_set_ps(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), _mm512_set1_ps(step), _mm512_set1_ps(frac));
+    __m512 advance = _mm512_set1_ps(16 * step);
+    int k = 0;
+    if (count >= 16)
+    {
+        __m512 a = _mm512_loadu_ps(read);
+        for (; k + 32 <= count; k += 16)
+        {
+            __m512 input = _mm512_loadu_ps(in + k);
+            __m512 next = _mm512_loadu_ps(read + k + 16);
+            __m512 delayout = mf_kernels_interpolateNextAvx512(a, next, f);
+            _mm512_storeu_ps(buffer + k, _mm512_fmadd_ps(delayout, g, input));
+            _mm512_storeu_ps(out + k, _mm512_fnmadd_ps(g, input, delayout));
+            f = _mm512_add_ps(f, advance);
+            a = next;
+        }
+        __m512 input = _mm512_loadu_ps(in + k);
+        __m512 delayout = _mm512_fmadd_ps(f, _mm512_sub_ps(_mm512_loadu_ps(read + k + 1), a), a);
+        _mm512_storeu_ps(buffer + k, _mm512_fmadd_ps(delayout, g, input));
+        _mm512_storeu_ps(out + k, _mm512_fnmadd_ps(g, input, delayout));
+        f = _mm512_add_ps(f, advance);
+        k += 16;
+    }
+    if (k < count)
+    {
+        __mmask16 m = (__mmask16)((1u << (count - k)) - 1);
+        __m512 input = _mm512_maskz_loadu_ps(m, in + k);
+        __m512 a = _mm512_maskz_loadu_ps(m, read + k);
+        __m512 delayout = _mm512_fmadd_ps(f, _mm512_sub_ps(_mm512_maskz_loadu_ps(m, read + k + 1), a), a);
+        _mm512_mask_storeu_ps(buffer + k, m, _mm512_fmadd_ps(delayout, g, input));
+        _mm512_mask_storeu_ps(out + k, m, _mm512_fnmadd_ps(g, input, delayout));
+    }
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_allpassModulatedAvx512(float *buffer, const float *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    /* most spans lie between two integer crossings of the fraction or cross one, and are cut there */
+    int cut = mf_kernels_crossing(frac, step, count);
+    if (cut == count)
+    {
+        mf_kernels_allpassFlatAvx512(buffer, read, in, out, gain, frac, step, count);
+        return;
+    }
+    if (cut >= 0)
+    {
+        int shift = step > 0 ? 1 : -1;
+        mf_kernels_allpassFlatAvx512(buffer, read, in, out, gain, frac, step, cut);
+        mf_kernels_allpassFlatAvx512(buffer + cut, read + cut + shift, in + cut, out + cut, gain, frac + cut * step - shift, step, count - cut);
+        return;
+    }
+    if (fabsf(step) * 16 >= 1)
+    {
+        mf_kernels_allpassModulatedScalar(buffer, read, in, out, gain, frac, step, count);
+        return;
+    }
+    __m512 g = _mm512_set1_ps(gain);
+    __m512 f = _mm512_fmadd_ps(_mm512_set_ps(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), _mm512_set1_ps(step), _mm512_set1_ps(frac));
+    __m512 advance = _mm512_set1_ps(16 * step);
+    const float *r = read;
+    int k = 0;
+    while (k + 16 <= count)
+    {
+        /* the vectors before the next integer crossing of the fraction skip its test */
+        int end = k + mf_kernels_flat(_mm512_cvtss_f32(f), step, 16, count - k);
+        __m512 a = _mm512_loadu_ps(r + k);
+        for (; k + 16 < end; k += 16)
+        {
+            __m512 input = _mm512_loadu_ps(in + k);
+            __m512 next = _mm512_loadu_ps(r + k + 16);
+            __m512 delayout = mf_kernels_interpolateNextAvx512(a, next, f);
+            _mm512_storeu_ps(buffer + k, _mm512_fmadd_ps(delayout, g, input));
+            _mm512_storeu_ps(out + k, _mm512_fnmadd_ps(g, input, delayout));
+            f = _mm512_add_ps(f, advance);
+            a = next;
+        }
+        for (; k + 16 <= end; k += 16)
+        {
+            __m512 input = _mm512_loadu_ps(in + k);
+            __m512 delayout = mf_kernels_interpolateAvx512(r + k, f, 0xffff, true);
+            _mm512_storeu_ps(buffer + k, _mm512_fmadd_ps(delayout, g, input));
+            _mm512_storeu_ps(out + k, _mm512_fnmadd_ps(g, input, delayout));
+            f = _mm512_add_ps(f, advance);
+        }
+        if (k + 16 <= count)
+        {
+            __m512 input = _mm512_loadu_ps(in + k);
+            __m512 delayout = mf_kernels_interpolateAvx512(r + k, f, 0xffff, false);
+            _mm512_storeu_ps(buffer + k, _mm512_fmadd_ps(delayout, g, input));
+            _mm512_storeu_ps(out + k, _mm512_fnmadd_ps(g, input, delayout));
+            f = _mm512_add_ps(f, advance);
+            MF_KERNELS_REBASE(_mm512_cvtss_f32(f), r, f = _mm512_sub_ps(f, _mm512_set1_ps(1)), f = _mm512_add_ps(f, _mm512_set1_ps(1)));
+            k += 16;
+        }
+    }
+    if (k < count)
+    {
+        __mmask16 m = (__mmask16)((1u << (count - k)) - 1);
+        __m512 input = _mm512_maskz_loadu_ps(m, in + k);
+        __m512 delayout = mf_kernels_interpolateAvx512(r + k, f, m, false);
+        _mm512_mask_storeu_ps(buffer + k, m, _mm512_fmadd_ps(delayout, g, input));
+        _mm512_mask_storeu_ps(out + k, m, _mm512_fnmadd_ps(g, input, delayout));
+    }
+    _mm256_zeroupper();
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_tapsAvx512(const float *buffer, const int *start, const float *gain, int taps, float *out, int count)
+{
+    int k = 0;
+
+    /* four independent sums per tap hide the latency of the accumulation */
+    for (; k + 64 <= count; k += 64)
+    {
+        __m512 sum0 = _mm512_loadu_ps(out + k);
+        __m512 sum1 = _mm512_loadu_ps(out + k + 16);
+        __m512 sum2 = _mm512_loadu_ps(out + k + 32);
+        __m512 sum3 = _mm512_loadu_ps(out + k + 48);
+        for (int t = 0; t < taps; t++)
+        {
+            __m512 g = _mm512_set1_ps(gain[t]);
+            const float *read = buffer + start[t] + k;
+            sum0 = _mm512_fmadd_ps(g, _mm512_loadu_ps(read), sum0);
+            sum1 = _mm512_fmadd_ps(g, _mm512_loadu_ps(read + 16), sum1);
+            sum2 = _mm512_fmadd_ps(g, _mm512_loadu_ps(read + 32), sum2);
+            sum3 = _mm512_fmadd_ps(g, _mm512_loadu_ps(read + 48), sum3);
+        }
+        _mm512_storeu_ps(out + k, sum0);
+        _mm512_storeu_ps(out + k + 16, sum1);
+        _mm512_storeu_ps(out + k + 32, sum2);
+        _mm512_storeu_ps(out + k + 48, sum3);
+    }
+    for (; k + 16 <= count; k += 16)
+    {
+        __m512 sum = _mm512_loadu_ps(out + k);
+        for (int t = 0; t < taps; t++)
+        {
+            sum = _mm512_fmadd_ps(_mm512_set1_ps(gain[t]), _mm512_loadu_ps(buffer + start[t] + k), sum);
+        }
+        _mm512_storeu_ps(out + k, sum);
+    }
+    _mm256_zeroupper();
+    mf_kernels_tapsScalar(buffer + k, start, gain, taps, out + k, count - k);
+}
+
+__attribute__((target("avx512f")))
+static inline void mf_kernels_meterAvx512(__m512 *acc, __m512 wetl, __m512 wetr, __m512 outl, __m512 outr)
+{
+    const __m512 value[4] = {wetl, wetr, outl, outr};
+    for (int m = 0; m < 4; m++)
+    {
+        acc[m] = _mm512_max_ps(acc[m], _mm512_abs_ps(value[m]));
+        acc[4 + m] = _mm512_fmadd_ps(value[m], value[m], acc[4 + m]);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_meterStoreAvx512(float *meter, const __m512 *acc)
+{
+    float lanes[MF_KERNELS_METER];
+    for (int m = 0; m < 4; m++)
+    {
+        lanes[m] = _mm512_reduce_max_ps(acc[m]);
+        lanes[4 + m] = _mm512_reduce_add_ps(acc[4 + m]);
+    }
+    mf_kernels_meterMerge(meter, lanes, 1);
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_mixAvx512(const float *in, const float *left, const float *right, float *outl, float *outr, float level, float levelStep, float wet, float wetStep, int count, float *meter)
+{
+    __m512 index = _mm512_set_ps(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0);
+    __m512 l = _mm512_fmadd_ps(index, _mm512_set1_ps(levelStep), _mm512_set1_ps(level));
+    __m512 w = _mm512_fmadd_ps(index, _mm512_set1_ps(wetStep), _mm512_set1_ps(wet));
+    __m512 levelAdvance = _mm512_set1_ps(16 * levelStep);
+    __m512 wetAdvance = _mm512_set1_ps(16 * wetStep);
+    __m512 acc[MF_KERNELS_METER];
+    for (int m = 0; m < MF_KERNELS_METER; m++)
+        acc[m] = _mm512_setzero_ps();
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        __m512 dry = _mm512_loadu_ps(in + k);
+        __m512 left16 = _mm512_loadu_ps(left + k);
+        __m512 right16 = _mm512_loadu_ps(right + k);
+        __m512 ol = _mm512_mul_ps(l, _mm512_fmadd_ps(w, left16, dry));
+        __m512 or = _mm512_mul_ps(l, _mm512_fmadd_ps(w, right16, dry));
+        _mm512_storeu_ps(outl + k, ol);
+        _mm512_storeu_ps(outr + k, or);
+        if (meter)
+            mf_kernels_meterAvx512(acc, _mm512_mul_ps(w, left16), _mm512_mul_ps(w, right16), ol, or);
+        l = _mm512_add_ps(l, levelAdvance);
+        w = _mm512_add_ps(w, wetAdvance);
+    }
+    if (meter && k > 0)
+        mf_kernels_meterStoreAvx512(meter, acc);
+    _mm256_zeroupper();
+    mf_kernels_mixScalar(in + k, left + k, right + k, outl + k, outr + k, level + k * levelStep, levelStep, wet + k * wetStep, wetStep, count - k, meter);
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_mixSignalAvx512(const float *in, const float *left, const float *right, float *outl, float *outr, const float *level, const float *wet, int count, float *meter)
+{
+    __m512 acc[MF_KERNELS_METER];
+    for (int m = 0; m < MF_KERNELS_METER; m++)
+        acc[m] = _mm512_setzero_ps();
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        __m512 dry = _mm512_loadu_ps(in + k);
+        __m512 l = _mm512_loadu_ps(level + k);
+        __m512 w = _mm512_loadu_ps(wet + k);
+        __m512 left16 = _mm512_loadu_ps(left + k);
+        __m512 right16 = _mm512_loadu_ps(right + k);
+        __m512 ol = _mm512_mul_ps(l, _mm512_fmadd_ps(w, left16, dry));
+        __m512 or = _mm512_mul_ps(l, _mm512_fmadd_ps(w, right16, dry));
+        _mm512_storeu_ps(outl + k, ol);
+        _mm512_storeu_ps(outr + k, or);
+        if (meter)
+            mf_kernels_meterAvx512(acc, _mm512_mul_ps(w, left16), _mm512_mul_ps(w, right16), ol, or);
+    }
+    if (meter && k > 0)
+        mf_kernels_meterStoreAvx512(meter, acc);
+    _mm256_zeroupper();
+    mf_kernels_mixSignalScalar(in + k, left + k, right + k, outl + k, outr + k, level + k, wet + k, count - k, meter);
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_graphAvx512(float *const *line, const float *gain, const int *delay, int *counter, int stages, const float *in, float *left, float *right, int count)
+{
+    mf_kernels_graphBody(line, gain, delay, counter, stages, in, left, right, count);
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_combHalfAvx512(uint16_t *buffer, const float *in, float *out, float gain, int count)
+{
+    __m512 g = _mm512_set1_ps(gain);
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        __m512 delayout = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(buffer + k)));
+        _mm256_storeu_si256((__m256i *)(buffer + k), _mm512_cvtps_ph(_mm512_fmadd_ps(delayout, g, _mm512_loadu_ps(in + k)), _MM_FROUND_TO_NEAREST_INT));
+        _mm512_storeu_ps(out + k, delayout);
+    }
+    _mm256_zeroupper();
+    mf_kernels_combHalfScalar(buffer + k, in + k, out + k, gain, count - k);
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_allpassHalfAvx512(uint16_t *buffer, const float *in, float *out, float gain, int count)
+{
+    __m512 g = _mm512_set1_ps(gain);
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        __m512 input = _mm512_loadu_ps(in + k);
+        __m512 delayout = _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(buffer + k)));
+        _mm256_storeu_si256((__m256i *)(buffer + k), _mm512_cvtps_ph(_mm512_fmadd_ps(delayout, g, input), _MM_FROUND_TO_NEAREST_INT));
+        _mm512_storeu_ps(out + k, _mm512_fnmadd_ps(g, input, delayout));
+    }
+    _mm256_zeroupper();
+    mf_kernels_allpassHalfScalar(buffer + k, in + k, out + k, gain, count - k);
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_combModulatedHalfAvx512(uint16_t *buffer, const uint16_t *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    if (fabsf(step) * 16 >= 1)
+    {
+        mf_kernels_combModulatedHalfScalar(buffer, read, in, out, gain, frac, step, count);
+        return;
+    }
+    __m512 g = _mm512_set1_ps(gain);
+    __m512 f = _mm512_fmadd_ps(_mm512_set_ps(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), _mm512_set1_ps(step), _mm512_set1_ps(frac));
+    __m512 advance = _mm512_set1_ps(16 * step);
+    const uint16_t *r = read;
+    int k = 0;
+    while (k + 16 <= count)
+    {
+        /* the vectors before the next integer crossing of the fraction skip its test */
+        int end = k + mf_kernels_flat(_mm512_cvtss_f32(f), step, 16, count - k);
+        for (; k + 16 <= end; k += 16)
+        {
+            __m512 delayout = mf_kernels_interpolateHalfAvx512(r + k, f, true);
+            _mm256_storeu_si256((__m256i *)(buffer + k), _mm512_cvtps_ph(_mm512_fmadd_ps(delayout, g, _mm512_loadu_ps(in + k)), _MM_FROUND_TO_NEAREST_INT));
+            _mm512_storeu_ps(out + k, delayout);
+            f = _mm512_add_ps(f, advance);
+        }
+        if (k + 16 <= count)
+        {
+            __m512 delayout = mf_kernels_interpolateHalfAvx512(r + k, f, false);
+            _mm256_storeu_si256((__m256i *)(buffer + k), _mm512_cvtps_ph(_mm512_fmadd_ps(delayout, g, _mm512_loadu_ps(in + k)), _MM_FROUND_TO_NEAREST_INT));
+            _mm512_storeu_ps(out + k, delayout);
+            f = _mm512_add_ps(f, advance);
+            MF_KERNELS_REBASE(_mm512_cvtss_f32(f), r, f = _mm512_sub_ps(f, _mm512_set1_ps(1)), f = _mm512_add_ps(f, _mm512_set1_ps(1)));
+            k += 16;
+        }
+    }
+    float rest = _mm512_cvtss_f32(f);
+    _mm256_zeroupper();
+    mf_kernels_combModulatedHalfScalar(buffer + k, r + k, in + k, out + k, gain, rest, step, count - k);
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_allpassModulatedHalfAvx512(uint16_t *buffer, const uint16_t *read, const float *in, float *out, float gain, float frac, float step, int count)
+{
+    if (fabsf(step) * 16 >= 1)
+    {
+        mf_kernels_allpassModulatedHalfScalar(buffer, read, in, out, gain, frac, step, count);
+        return;
+    }
+    __m512 g = _mm512_set1_ps(gain);
+    __m512 f = _mm512_fmadd_ps(_mm512_set_ps(15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0), _mm512_set1_ps(step), _mm512_set1_ps(frac));
+    __m512 advance = _mm512_set1_ps(16 * step);
+    const uint16_t *r = read;
+    int k = 0;
+    while (k + 16 <= count)
+    {
+        /* the vectors before the next integer crossing of the fraction skip its test */
+        int end = k + mf_kernels_flat(_mm512_cvtss_f32(f), step, 16, count - k);
+        for (; k + 16 <= end; k += 16)
+        {
+            __m512 input = _mm512_loadu_ps(in + k);
+            __m512 delayout = mf_kernels_interpolateHalfAvx512(r + k, f, true);
+            _mm256_storeu_si256((__m256i *)(buffer + k), _mm512_cvtps_ph(_mm512_fmadd_ps(delayout, g, input), _MM_FROUND_TO_NEAREST_INT));
+            _mm512_storeu_ps(out + k, _mm512_fnmadd_ps(g, input, delayout));
+            f = _mm512_add_ps(f, advance);
+        }
+        if (k + 16 <= count)
+        {
+            __m512 input = _mm512_loadu_ps(in + k);
+            __m512 delayout = mf_kernels_interpolateHalfAvx512(r + k, f, false);
+            _mm256_storeu_si256((__m256i *)(buffer + k), _mm512_cvtps_ph(_mm512_fmadd_ps(delayout, g, input), _MM_FROUND_TO_NEAREST_INT));
+            _mm512_storeu_ps(out + k, _mm512_fnmadd_ps(g, input, delayout));
+            f = _mm512_add_ps(f, advance);
+            MF_KERNELS_REBASE(_mm512_cvtss_f32(f), r, f = _mm512_sub_ps(f, _mm512_set1_ps(1)), f = _mm512_add_ps(f, _mm512_set1_ps(1)));
+            k += 16;
+        }
+    }
+    float rest = _mm512_cvtss_f32(f);
+    _mm256_zeroupper();
+    mf_kernels_allpassModulatedHalfScalar(buffer + k, r + k, in + k, out + k, gain, rest, step, count - k);
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_toFloatAvx512(const uint16_t *in, float *out, int count)
+{
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        _mm512_storeu_ps(out + k, _mm512_cvtph_ps(_mm256_loadu_si256((const __m256i *)(in + k))));
+    }
+    _mm256_zeroupper();
+    mf_kernels_toFloatScalar(in + k, out + k, count - k);
+}
+
+__attribute__((target("avx512f")))
+static void mf_kernels_toHalfAvx512(const float *in, uint16_t *out, int count)
+{
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        _mm256_storeu_si256((__m256i *)(out + k), _mm512_cvtps_ph(_mm512_loadu_ps(in + k), _MM_FROUND_TO_NEAREST_INT));
+    }
+    _mm256_zeroupper();
+    mf_kernels_toHalfScalar(in + k, out + k, count - k);
+}
+
+__attribute__((target("avx512f")))
+static int mf_kernels_finiteAvx512(const float *in, int count)
+{
+    __m512i exponent = _mm512_set1_epi32(0x7f800000);
+    __mmask16 found = 0;
+    int k = 0;
+    for (; k + 16 <= count; k += 16)
+    {
+        __m512i bits = _mm512_and_si512(_mm512_castps_si512(_mm512_loadu_ps(in + k)), exponent);
+        found |= _mm512_cmpeq_epi32_mask(bits, exponent);
+    }
+    _mm256_zeroupper();
+    return found == 0 && mf_kernels_finiteScalar(in + k, count - k);
+}
+
+#endif /* MF_KERNELS_X86 */
+
+/* ordered from the best to the most portable version */
+static const mf_kernels mf_kernels_table[] =
+{
+#ifdef MF_KERNELS_X86
+    {"avx512", mf_kernels_combAvx512, mf_kernels_allpassAvx512, mf_kernels_combModulatedAvx512, mf_kernels_allpassModulatedAvx512, mf_kernels_tapsAvx512, mf_kernels_mixAvx512, mf_kernels_mixSignalAvx512, mf_kernels_graphAvx512,
+     mf_kernels_combHalfAvx512, mf_kernels_allpassHalfAvx512, mf_kernels_combModulatedHalfAvx512, mf_kernels_allpassModulatedHalfAvx512, mf_kernels_toFloatAvx512, mf_kernels_toHalfAvx512, mf_kernels_finiteAvx512},
+    {"avx2", mf_kernels_combAvx2, mf_kernels_allpassAvx2, mf_kernels_combModulatedAvx2, mf_kernels_allpassModulatedAvx2, mf_kernels_tapsAvx2, mf_kernels_mixAvx2, mf_kernels_mixSignalAvx2, mf_kernels_graphAvx2,
+     mf_kernels_combHalfAvx2, mf_kernels_allpassHalfAvx2, mf_kernels_combModulatedHalfAvx2, mf_kernels_allpassModulatedHalfAvx2, mf_kernels_toFloatAvx2, mf_kernels_toHalfAvx2, mf_kernels_finiteAvx2},
+    {"sse2", mf_kernels_combSse2, mf_kernels_allpassSse2, mf_kernels_combModulatedSse2, mf_kernels_allpassModulatedSse2, mf_kernels_tapsSse2, mf_kernels_mixSse2, mf_kernels_mixSignalSse2, mf_kernels_graphScalar,
+     mf_kernels_combHalfScalar, mf_kernels_allpassHalfScalar, mf_kernels_combModulatedHalfScalar, mf_kernels_allpassModulatedHalfScalar, mf_kernels_toFloatScalar, mf_kernels_toHalfScalar, mf_kernels_finiteSse2},
+#endif
+    {"scalar", mf_kernels_combScalar, mf_kernels_allpassScalar, mf_kernels_combModulatedScalar, mf_kernels_allpassModulatedScalar, mf_kernels_tapsScalar, mf_kernels_mixScalar, mf_kernels_mixSignalScalar, mf_kernels_graphScalar,
+     mf_kernels_combHalfScalar, mf_kernels_allpassHalfScalar, mf_kernels_combModulatedHalfScalar, mf_kernels_allpassModulatedHalfScalar, mf_kernels_toFloatScalar, mf_kernels_toHalfScalar, mf_kernels_finiteScalar},
+};
+
+mf_kernels mf_kernels_current = {"scalar", mf_kernels_combScalar, mf_kernels_allpassScalar, mf_kernels_combModulatedScalar, mf_kernels_allpassModulatedScalar, mf_kernels_tapsScalar, mf_kernels_mixScalar, mf_kernels_mixSignalScalar, mf_kernels_graphScalar,
+    mf_kernels_combHalfScalar, mf_kernels_allpassHalfScalar, mf_kernels_combModulatedHalfScalar, mf_kernels_allpassModulatedHalfScalar, mf_kernels_toFloatScalar, mf_kernels_toHalfScalar, mf_kernels_finiteScalar};
+
+static int mf_kernels_supported(const char *name)
+{
+#ifdef MF_KERNELS_X86
+    __builtin_cpu_init();
+    if (!strcmp(name, "avx512"))
+        return __builtin_cpu_supports("avx512f");
+    if (!strcmp(name, "avx2"))
+        return __builtin_cpu_supports("avx2") && __builtin_cpu_supports("fma") && __builtin_cpu_supports("f16c");
+    if (!strcmp(name, "sse2"))
+        return __builtin_cpu_supports("sse2");
+#endif
+    return !strcmp(name, "scalar");
+}
+
+/* takes the named version, or the best supported one for NULL */
+static int mf_kernels_pick(const char *name)
+{
+    int count = sizeof(mf_kernels_table) / sizeof(mf_kernels_table[0]);
+
+    for (int i = 0; i < count; i++)
+    {
+        const mf_kernels *k = &mf_kernels_table[i];
+        if ((!name || !strcmp(name, k->name)) && mf_kernels_supported(k->name))
+        {
+            mf_kernels_current = *k;
+            return 0;
+        }
+    }
+    return -1;
+}
+
+int mf_kernels_select(const char *name)
+{
+    if (name)
+        return mf_kernels_pick(name);
+
+    /* an unusable override still leaves the best version selected */
+    name = getenv("MF_REVERB_ISA");
+    if (name && !mf_kernels_pick(name))
+        return 0;
+    mf_kernels_pick(NULL);
+    return name ? -1 : 0;
+}
+
+#define MF_KERNELS_WINDOW 256 /**< samples of the window that holds the reads around the end of a delay line */
+
+/* copies count samples of size bytes from a circular line, starting at from, which may lie outside of it */
+static void mf_kernels_window(const void *buffer, size_t size, int length, int from, int count, void *window)
+{
+    from %= length;
+    if (from < 0)
+        from += length;
+    while (count > 0)
+    {
+        int n = length - from < count ? length - from : count;
+        memcpy(window, (const char *)buffer + from * size, n * size);
+        window = (char *)window + n * size;
+        count -= n;
+        from = 0;
+    }
+}
+
+/* the samples a span of count samples reads lie within spread samples before and count + spread samples after
+   the integer part of its first read position; this covers the kernels reading one sample beyond either end */
+static inline int mf_kernels_spread(float step, int count)
+{
+    return (int)(fabsf(step) * count) + 4;
+}
+
+/* reads that wrap around the end of the line go through a window, in pieces that fit into it */
+static void mf_kernels_runWrapped(mf_kernels_modulated kernel, float *buffer, int length, int start, float offset, float step,
+                                  const float *in, float *out, float gain, int count)
+{
+    float window[MF_KERNELS_WINDOW];
+    int most = (int)((MF_KERNELS_WINDOW - 8) / (1 + 2 * fabsf(step)));
+    if (most < 1)
+        most = 1;
+
+    for (int k = 0; k < count; )
+    {
+        int n = count - k < most ? count - k : most;
+        float position = offset + k * step;
+        int whole = (int)position;
+        int spread = mf_kernels_spread(step, n);
+        mf_kernels_window(buffer, sizeof(float), length, start + k + whole - spread, n + 2 * spread, window);
+        kernel(buffer + start + k, window + spread, in + k, out + k, gain, position - whole, step, n);
+        k += n;
+    }
+}
+
+static void mf_kernels_runWrappedHalf(mf_kernels_modulatedHalf kernel, uint16_t *buffer, int length, int start, float offset, float step,
+                                      const float *in, float *out, float gain, int count)
+{
+    uint16_t window[MF_KERNELS_WINDOW];
+    int most = (int)((MF_KERNELS_WINDOW - 8) / (1 + 2 * fabsf(step)));
+    if (most < 1)
+        most = 1;
+
+    for (int k = 0; k < count; )
+    {
+        int n = count - k < most ? count - k : most;
+        float position = offset + k * step;
+        int whole = (int)position;
+        int spread = mf_kernels_spread(step, n);
+        mf_kernels_window(buffer, sizeof(uint16_t), length, start + k + whole - spread, n + 2 * spread, window);
+        kernel(buffer + start + k, window + spread, in + k, out + k, gain, position - whole, step, n);
+        k += n;
+    }
+}
+
+/* the samples a piece reads lie within drift samples of its first read position and the count samples after it */
+static inline int mf_kernels_drift(float step, int count)
+{
+    return (int)(fabsf(step) * count) + 1;
+}
+
+/* a piece that comes close to either end of the line runs until its reads have passed the wrap by drift samples */
+static inline int mf_kernels_around(int length, int base, int drift, int left)
+{
+    int n = (base <= drift ? drift + 1 - base : length - base + drift + 1) + drift;
+    return n < left ? n : left;
+}
+
+/* pieces run straight through the kernel up to where their reads would come around the end of the line, only the
+   few samples whose reads straddle it go through a window */
+void mf_kernels_runModulated(mf_kernels_modulated kernel, float *buffer, int length, int start, float offset, float step,
+                             const float *in, float *out, float gain, int count)
+{
+    int drift = mf_kernels_drift(step, count);
+
+    for (int k = 0; k < count; )
+    {
+        float position = offset + k * step;
+        int whole = (int)position;
+        int base = start + k + whole;
+        if (base >= length)
+            base -= length;
+
+        int n = length - 2 - drift - base;
+        if (base > drift && n > 0)
+        {
+            if (n > count - k)
+                n = count - k;
+            kernel(buffer + start + k, buffer + base, in + k, out + k, gain, position - whole, step, n);
+        }
+        else
+        {
+            n = mf_kernels_around(length, base, drift, count - k);
+            mf_kernels_runWrapped(kernel, buffer, length, start + k, position, step, in + k, out + k, gain, n);
+        }
+        k += n;
+    }
+}
+
+void mf_kernels_runModulatedHalf(mf_kernels_modulatedHalf kernel, uint16_t *buffer, int length, int start, float offset, float step,
+                                 const float *in, float *out, float gain, int count)
+{
+    int drift = mf_kernels_drift(step, count);
+
+    for (int k = 0; k < count; )
+    {
+        float position = offset + k * step;
+        int whole = (int)position;
+        int base = start + k + whole;
+        if (base >= length)
+            base -= length;
+
+        int n = length - 2 - drift - base;
+        if (base > drift && n > 0)
+        {
+            if (n > count - k)
+                n = count - k;
+            kernel(buffer + start + k, buffer + base, in + k, out + k, gain, position - whole, step, n);
+        }
+        else
+        {
+            n = mf_kernels_around(length, base, drift, count - k);
+            mf_kernels_runWrappedHalf(kernel, buffer, length, start + k, position, step, in + k, out + k, gain, n);
+        }
+        k += n;
+    }
+}
+
+void mf_kernels_runTaps(float *buffer, int length, int chunk, int *counter, const int *position, const float *gain, int taps,
+                        const float *in, float *out, int count, bool dry)
+{
+    const int mask = length - 1;
+    int start[MF_KERNELS_TAPS];
+
+    for (int done = 0; done < count; done += chunk)
+    {
+        int n = count - done < chunk ? count - done : chunk;
+        int first = length - *counter < n ? length - *counter : n;
+
+        /* the chunk goes into the delay line first, the taps only read the line afterwards */
+        memcpy(buffer + *counter, in + done, first * sizeof(float));
+        memcpy(buffer, in + done + first, (n - first) * sizeof(float));
+        if (first < n || *counter < chunk)
+            memcpy(buffer + length, buffer, chunk * sizeof(float));
+        if (!dry)
+            memset(out + done, 0, n * sizeof(float));
+        else if (out != in)
+            memcpy(out + done, in + done, n * sizeof(float));
+
+        for (int t = 0; t < taps; t++)
+        {
+            start[t] = (*counter - position[t]) & mask;
+        }
+        mf_kernels_current.taps(buffer, start, gain, taps, out + done, n);
+
+        *counter = (*counter + n) & mask;
+    }
+}
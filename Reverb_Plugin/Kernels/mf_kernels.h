@@ -0,0 +1,155 @@
+/**
+ * @file mf_kernels.h
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Vectorized inner loops with runtime CPU dispatch <br>
+ * <br>
+ * @brief Scalar, SSE2, AVX2 and AVX-512 versions of the comb, allpass, tap, mix and graph loops <br>
+ * and of the half-precision delay lines, and a check for non-finite samples <br>
+ * <br>
+ * The comb and allpass kernels process a contiguous span of a delay line <br>
+ * that does not wrap. As long as the span is not longer than the delay, every <br>
+ * sample of the span is read and written exactly once, so the samples are <br>
+ * independent and can be processed side by side. mf_kernels_select picks the <br>
+ * best version the CPU supports; the environment variable MF_REVERB_ISA or an <br>
+ * explicit name forces a version, e.g. for tests and benchmarks. Without a <br>
+ * selection, and on other architectures than x86, the scalar version is used. <br>
+ * The half-precision kernels store IEEE binary16 samples and compute in float. <br>
+ * AVX2 and AVX-512 convert with F16C, the other versions in software with the <br>
+ * same rounding to nearest even, so all versions store the same samples. <br>
+ * <br>
+ */
+
+#ifndef mf_kernels_h
+#define mf_kernels_h
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+/**
+ * @struct mf_kernels
+ * @brief A table of kernel versions for one instruction set <br>
+ * @var mf_kernels::name The name of the instruction set: scalar, sse2, avx2 or avx512 <br>
+ * @var mf_kernels::comb Comb filter span: out = delayed, buffer = in + gain * delayed <br>
+ * @var mf_kernels::allpass Allpass filter span: buffer = in + gain * delayed, out = delayed - gain * in, in may be out <br>
+ * For static delays delayed is the buffer itself <br>
+ * @var mf_kernels::combModulated The comb span of a modulated delay, delayed is interpolated from read <br>
+ * with a ramped fraction in the same pass: delayed[k] = read[k + i] + (p - i) * (read[k + i + 1] - read[k + i]) <br>
+ * for the position p = frac + k * step and its integer part i, which changes where the fraction crosses an integer <br>
+ * @var mf_kernels::allpassModulated The allpass span of a modulated delay, read like combModulated <br>
+ * @var mf_kernels::taps Sparse taps on a delay line that does not wrap, the sum stays in a register: <br>
+ * out[k] += gain[0] * buffer[start[0] + k] + ... + gain[taps - 1] * buffer[start[taps - 1] + k] <br>
+ * @var mf_kernels::mix Dry/wet mix of both outputs with level and wet ramped linearly by their steps <br>
+ * per sample: outl[k] = (level + k * levelStep) * (in[k] + (wet + k * wetStep) * left[k]), in may be one of the outputs <br>
+ * A meter that is not NULL collects the wet signals w * left and w * right and both outputs: <br>
+ * their peak magnitudes are raised and their squares are added, in the layout of MF_KERNELS_METER <br>
+ * @var mf_kernels::mixSignal The same mix with level and wet given per sample <br>
+ * @var mf_kernels::graph The static comb bank and both allpass chains in one call for small blocks: <br>
+ * line, gain, delay and counter hold MF_KERNELS_COMBS combs followed by the left and right filter of <br>
+ * every stage. The average of the combs runs through the even filters to left and the odd ones to right. <br>
+ * A few samples pass the whole graph one after another, longer blocks run filter by filter in spans <br>
+ * like the comb and allpass kernels. in must not be one of the outputs <br>
+ * @var mf_kernels::combHalf The comb span of a static delay on a half-precision buffer <br>
+ * @var mf_kernels::allpassHalf The allpass span of a static delay on a half-precision buffer, in may be out <br>
+ * @var mf_kernels::combModulatedHalf The comb span of a modulated delay on a half-precision buffer <br>
+ * @var mf_kernels::allpassModulatedHalf The allpass span of a modulated delay on a half-precision buffer <br>
+ * @var mf_kernels::toFloat Converts half-precision samples to float <br>
+ * @var mf_kernels::toHalf Converts float samples to half precision, values beyond 65504 become infinite <br>
+ * @var mf_kernels::finite 1 if no sample is infinite or NaN, 0 otherwise <br>
+ */
+
+#define MF_KERNELS_COMBS 4 /**< comb filters of the graph kernel */
+#define MF_KERNELS_WIDTH 16 /**< samples in the widest vector of the kernels */
+#define MF_KERNELS_TAPS 64  /**< taps of mf_kernels_runTaps */
+#define MF_KERNELS_METER 8 /**< meter values of the mix kernels: peaks of wet left, wet right, out left, out right, then their sums of squares */
+
+typedef void (*mf_kernels_modulated)(float *buffer, const float *read, const float *in, float *out, float gain, float frac, float step, int count);
+typedef void (*mf_kernels_modulatedHalf)(uint16_t *buffer, const uint16_t *read, const float *in, float *out, float gain, float frac, float step, int count);
+
+typedef struct mf_kernels
+{
+    const char *name;
+    void (*comb)(float *buffer, const float *delayed, const float *in, float *out, float gain, int count);
+    void (*allpass)(float *buffer, const float *delayed, const float *in, float *out, float gain, int count);
+    mf_kernels_modulated combModulated;
+    mf_kernels_modulated allpassModulated;
+    void (*taps)(const float *buffer, const int *start, const float *gain, int taps, float *out, int count);
+    void (*mix)(const float *in, const float *left, const float *right, float *outl, float *outr, float level, float levelStep, float wet, float wetStep, int count, float *meter);
+    void (*mixSignal)(const float *in, const float *left, const float *right, float *outl, float *outr, const float *level, const float *wet, int count, float *meter);
+    void (*graph)(float *const *line, const float *gain, const int *delay, int *counter, int stages, const float *in, float *left, float *right, int count);
+    void (*combHalf)(uint16_t *buffer, const float *in, float *out, float gain, int count);
+    void (*allpassHalf)(uint16_t *buffer, const float *in, float *out, float gain, int count);
+    mf_kernels_modulatedHalf combModulatedHalf;
+    mf_kernels_modulatedHalf allpassModulatedHalf;
+    void (*toFloat)(const uint16_t *in, float *out, int count);
+    void (*toHalf)(const float *in, uint16_t *out, int count);
+    int (*finite)(const float *in, int count);
+} mf_kernels;
+
+/** The kernels in use */
+extern mf_kernels mf_kernels_current;
+
+/**
+ * @related mf_kernels
+ * @brief Selects the kernels <br>
+ * @param name The instruction set to force, or NULL for the value of <br>
+ * MF_REVERB_ISA or, if that is not set, the best supported one <br>
+ * @return 0 on success, -1 if the instruction set is unknown or not supported. <br>
+ * A forced name then leaves the selection unchanged, an unusable MF_REVERB_ISA <br>
+ * falls back to the best supported version <br>
+ */
+
+int mf_kernels_select(const char *name);
+
+/**
+ * @brief Runs a span of a circular delay line with a modulated read position through a kernel <br>
+ * @param kernel combModulated or allpassModulated of mf_kernels_current <br>
+ * @param buffer The delay line <br>
+ * @param length The length of the delay line <br>
+ * @param start The index of the first sample written, and of the read position for offset 0 <br>
+ * @param offset The fractional offset of the first read position, ramped by step per sample <br>
+ * @param step The increment of the offset per sample <br>
+ * @param in The input vector <br>
+ * @param out The output vector <br>
+ * @param gain The gain of the filter <br>
+ * @param count The number of samples, the writes must not wrap, and all reads must be <br>
+ * older than the writes, which holds while count + offset stays 2 samples short of length <br>
+ * The kernel ramps the fraction across integer crossings, so the span is only cut where <br>
+ * its reads come around the end of the line, and the few samples whose reads straddle <br>
+ * it are interpolated from a window that holds both ends <br>
+ */
+
+void mf_kernels_runModulated(mf_kernels_modulated kernel, float *buffer, int length, int start, float offset, float step,
+                             const float *in, float *out, float gain, int count);
+
+/**
+ * @brief The same for a half-precision delay line <br>
+ * @param kernel combModulatedHalf or allpassModulatedHalf of mf_kernels_current <br>
+ * See mf_kernels_runModulated for the other parameters <br>
+ */
+
+void mf_kernels_runModulatedHalf(mf_kernels_modulatedHalf kernel, uint16_t *buffer, int length, int start, float offset, float step,
+                                 const float *in, float *out, float gain, int count);
+
+/**
+ * @brief Writes a block to a mirrored tap delay line and adds its taps to the output <br>
+ * @param buffer The delay line of length samples, followed by a mirror of its first chunk samples <br>
+ * @param length The length of the delay line, a power of two <br>
+ * @param chunk The length of the mirror, longer blocks are processed in chunks of this size <br>
+ * @param counter The index of the next sample written, advanced by the block <br>
+ * @param position The delays of the taps in samples, at most length - chunk <br>
+ * @param gain The gains of the taps <br>
+ * @param taps The number of taps, at most MF_KERNELS_TAPS <br>
+ * @param in The input vector <br>
+ * @param out The output vector, may be the input vector <br>
+ * @param count The number of samples <br>
+ * @param dry True to add the taps to the input, false to output the taps alone <br>
+ * Each chunk is written to the delay line before the taps read it, so a tap at <br>
+ * position 0 reads the input, and all taps of a chunk go to one call of the taps kernel <br>
+ */
+
+void mf_kernels_runTaps(float *buffer, int length, int chunk, int *counter, const int *position, const float *gain, int taps,
+                        const float *in, float *out, int count, bool dry);
+
+#endif /* mf_kernels_h */
@@ -0,0 +1,1030 @@
+#include "mf_reverb.h"
+#include "math.h"
+#include "mf_kernels.h"
+#include "mf_trace.h"
+#include <float.h>
+#include <stddef.h>
+#include <string.h>
+#include <time.h>
+
+static const int dly_allpass[40] = {262,171,355,290,244,327,487,251,162,592,313,432,502,616,340,85,291,119,450,52,336,350,326,159,350,482,485,380,468,222,74,309,403,399,163,183,330,321,73,226};
+
+/* hands the counters back to the filters before anything else uses them */
+static void mf_reverb_leaveSmall(mf_reverb *x)
+{
+    mf_reverb_compact *c = &x->compact;
+    if (!c->active)
+        return;
+
+    for (int f = 0; f < 4 + 2 * c->stages; f++)
+    {
+        if (f < 4)
+            x->comb[f]->counter = c->counter[f];
+        else
+            x->allpass[f - 4]->counter = c->counter[f];
+    }
+    c->active = false;
+}
+
+mf_reverb *mf_reverb_new(float t60, float fs)
+{
+    mf_reverb *x = (mf_reverb *)malloc(sizeof(mf_reverb));
+    x->level = 1;
+    x->wetLevel = 0;
+    x->levelTarget = 1;
+    x->wetTarget = 0;
+    x->modDepth = 0;
+    x->modRate = 0;
+    x->fixedPoint = false;
+    x->budget = 0;
+    x->load = 0;
+    x->stages = MF_REVERB_STAGES;
+    x->fade = 1;
+    x->fadeTarget = 1;
+    x->hold = 0;
+    x->calm = 0;
+    x->velvet = false;
+    x->half = false;
+    x->decorrelator[0] = x->decorrelator[1] = NULL;
+    x->compact.active = false;
+    x->smoothSize = 0;
+    x->recoveries = 0;
+    x->clearedLines = 0;
+    x->diagnostics = false;
+    x->diag = NULL;
+    x->blocks = 0;
+    x->metering = false;
+    memset(x->meter, 0, sizeof(x->meter));
+    x->meterSamples = 0;
+    x->frozen = false;
+
+    for (int i = 0; i < 4; i++)
+    {
+        x->comb[i] = mf_comb_new();
+    }
+
+    for (int i = 0; i < 40; i++)
+    {
+        x->allpass[i] = mf_allpass_new();
+    }
+
+    x->early = mf_early_new();
+
+    for (int i = 0; i < 4; i++)
+    {
+        x->fixedComb[i] = NULL;
+    }
+
+    for (int i = 0; i < 20; i++)
+    {
+        x->fixedAllpass[i] = NULL;
+    }
+
+    mf_reverb_configure(x, t60, fs);
+    return x;
+}
+
+void mf_reverb_free(mf_reverb *x)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        mf_comb_free(x->comb[i]);
+    }
+
+    for (int i = 0; i < 40; i++)
+    {
+        mf_allpass_free(x->allpass[i]);
+    }
+
+    mf_early_free(x->early);
+
+    for (int i = 0; i < 4; i++)
+    {
+        free(x->fixedComb[i]);
+    }
+
+    for (int i = 0; i < 20; i++)
+    {
+        free(x->fixedAllpass[i]);
+    }
+
+    for (int c = 0; c < 2; c++)
+    {
+        if (x->decorrelator[c])
+            mf_velvet_free(x->decorrelator[c]);
+    }
+
+    if (x->diag)
+        mf_diag_free(x->diag);
+
+    free(x);
+}
+
+void mf_reverb_configure(mf_reverb *x, float t60, float fs)
+{
+    MF_TRACE_INSTANT("configure");
+    mf_reverb_leaveSmall(x);
+    x->t60 = t60;
+    x->fs = fs;
+    x->smoothSize = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        mf_comb_setDelay(x->comb[i], floor((.03 + i*.005) * fs));
+        mf_comb_setGain(x->comb[i], t60, fs);
+        x->comb[i]->counter = 1;
+    }
+
+    for (int i = 0; i < 40; i++)
+    {
+        mf_allpass_setDelay(x->allpass[i], dly_allpass[i]);
+        x->allpass[i]->counter = 1;
+    }
+
+    mf_early_setSampleRate(x->early, fs);
+    mf_reverb_setModulation(x, x->modDepth, x->modRate);
+    mf_reverb_clear(x);
+    mf_reverb_setFixedPoint(x, x->fixedPoint);
+    mf_reverb_setVelvet(x, x->velvet);
+}
+
+void mf_reverb_clear(mf_reverb *x)
+{
+    for (int i = 0; i < 4; i++)
+    {
+        mf_comb_clearBuffer(x->comb[i]);
+    }
+
+    for (int i = 0; i < 40; i++)
+    {
+        mf_allpass_clearBuffer(x->allpass[i]);
+    }
+
+    mf_early_clearBuffer(x->early);
+}
+
+void mf_reverb_setWet(mf_reverb *x, float wet)
+{
+    x->wetTarget = wet/200;
+}
+
+void mf_reverb_setLevel(mf_reverb *x, float level)
+{
+    x->levelTarget = level;
+}
+
+void mf_reverb_settle(mf_reverb *x)
+{
+    x->level = x->levelTarget;
+    x->wetLevel = x->wetTarget;
+}
+
+void mf_reverb_setModulation(mf_reverb *x, float depth, float rate)
+{
+    float depthSamples = depth * x->fs / 1000;
+    MF_TRACE_INSTANT("modulation");
+    x->modDepth = depth;
+    x->modRate = rate;
+
+    for (int i = 0; i < 4; i++)
+    {
+        mf_comb_setModulation(x->comb[i], depthSamples, rate * (1 + .13 * i), i / 4.f, x->fs);
+    }
+
+    for (int i = 0; i < 40; i++)
+    {
+        mf_allpass_setModulation(x->allpass[i], depthSamples, rate * (1 + .07 * i), i / 40.f, x->fs);
+    }
+}
+
+void mf_reverb_setTaps(mf_reverb *x, const float *time, const float *gain, int taps)
+{
+    float seconds[MF_EARLY_TAPS];
+    if (taps > MF_EARLY_TAPS) taps = MF_EARLY_TAPS;
+    MF_TRACE_INSTANT("taps");
+
+    for (int t = 0; t < taps; t++)
+    {
+        seconds[t] = time[t] / 1000;
+    }
+
+    mf_early_setTaps(x->early, seconds, gain, taps, x->fs);
+}
+
+void mf_reverb_setRoom(mf_reverb *x, float width, float depth, float height, float reflection)
+{
+    MF_TRACE_INSTANT("room");
+    mf_early_setRoom(x->early, width, depth, height, reflection, x->fs);
+}
+
+void mf_reverb_setFixedPoint(mf_reverb *x, bool on)
+{
+    MF_TRACE_INSTANT("fixed point");
+    mf_reverb_leaveSmall(x);
+    x->fixedPoint = on;
+    if (!on)
+        return;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (!x->fixedComb[i])
+            x->fixedComb[i] = (mf_fixed_comb *)malloc(sizeof(mf_fixed_comb));
+        mf_fixed_comb_configure(x->fixedComb[i], x->comb[i]);
+    }
+
+    for (int i = 0; i < 20; i++)
+    {
+        if (!x->fixedAllpass[i])
+            x->fixedAllpass[i] = (mf_fixed_allpass *)malloc(sizeof(mf_fixed_allpass));
+        mf_fixed_allpass_configure(x->fixedAllpass[i], x->allpass[i]);
+    }
+}
+
+void mf_reverb_setVelvet(mf_reverb *x, bool on)
+{
+    MF_TRACE_INSTANT("velvet");
+    x->velvet = on;
+    if (!on)
+        return;
+
+    /* different seeds decorrelate the channels */
+    for (int c = 0; c < 2; c++)
+    {
+        if (!x->decorrelator[c])
+            x->decorrelator[c] = mf_velvet_new();
+        mf_velvet_setSequence(x->decorrelator[c], MF_REVERB_VELVET_LENGTH, MF_REVERB_VELVET_TAPS, c + 1, x->fs);
+        mf_velvet_clearBuffer(x->decorrelator[c]);
+    }
+}
+
+void mf_reverb_setBudget(mf_reverb *x, float budget)
+{
+    x->budget = budget > 0 ? budget : 0;
+    x->calm = 0;
+}
+
+void mf_reverb_setHalf(mf_reverb *x, bool on)
+{
+    MF_TRACE_INSTANT("half");
+    mf_reverb_leaveSmall(x);
+    x->half = on;
+
+    for (int i = 0; i < 4; i++)
+    {
+        mf_comb_setHalf(x->comb[i], on);
+    }
+
+    for (int i = 0; i < 40; i++)
+    {
+        mf_allpass_setHalf(x->allpass[i], on);
+    }
+}
+
+void mf_reverb_setDiagnostics(mf_reverb *x, bool on)
+{
+    if (on && !x->diag)
+        x->diag = mf_diag_new();
+    x->diagnostics = on;
+}
+
+void mf_reverb_setFreeze(mf_reverb *x, bool on)
+{
+    MF_TRACE_INSTANT("freeze");
+    mf_reverb_leaveSmall(x);
+    if (x->frozen && !on)
+        mf_early_clearBuffer(x->early);
+    x->frozen = on;
+}
+
+void mf_reverb_setMetering(mf_reverb *x, bool on)
+{
+    memset(x->meter, 0, sizeof(x->meter));
+    x->meterSamples = 0;
+    x->metering = on;
+}
+
+long mf_reverb_readMeter(mf_reverb *x, float *peak, float *rms)
+{
+    long samples = x->meterSamples;
+    for (int m = 0; m < 4; m++)
+    {
+        peak[m] = x->meter[m];
+        rms[m] = samples > 0 ? sqrtf(x->meter[4 + m] / samples) : 0;
+    }
+    memset(x->meter, 0, sizeof(x->meter));
+    x->meterSamples = 0;
+    return samples;
+}
+
+/* the samples until a line that is read every delay samples and scaled by gain stays below threshold, -1 for never */
+static long mf_reverb_decay(float peak, float gain, int delay, float threshold)
+{
+    if (peak <= threshold)
+        return 0;
+    if (!isfinite(peak) || fabsf(gain) >= 1)
+        return -1;
+    if (gain == 0)
+        return delay;
+    return (long)ceil(log(threshold / peak) / log(fabsf(gain))) * delay;
+}
+
+/* the largest gain of a tapped delay line, for an input that has the same sign at every tap */
+static float mf_reverb_spread(const float *gain, int taps)
+{
+    float sum = 0;
+    for (int t = 0; t < taps; t++)
+        sum += fabsf(gain[t]);
+    return sum;
+}
+
+/* the largest output a tapped delay line can still give from what it holds, span returns its longest tap */
+static float mf_reverb_tapped(const float *buffer, int mask, int counter, const int *position, const float *gain, int taps, int *span)
+{
+    float peak = 0;
+    *span = 0;
+    for (int t = 0; t < taps; t++)
+    {
+        if (position[t] > *span)
+            *span = position[t];
+    }
+    for (int k = 1; k <= *span; k++)
+        peak = fmaxf(peak, fabsf(buffer[(counter - k) & mask]));
+    return mf_reverb_spread(gain, taps) * peak;
+}
+
+long mf_reverb_expectedTail(float t60, float fs, float dB)
+{
+    float threshold = powf(10, dB / 20);
+    mf_comb comb;
+    long tail = 0;
+
+    if (!(threshold > 0))
+        return -1;
+
+    /* a full-scale line in every comb, with the delays and gains mf_reverb_configure sets */
+    for (int i = 0; i < 4; i++)
+    {
+        mf_comb_setDelay(&comb, floor((.03 + i*.005) * fs));
+        mf_comb_setGain(&comb, t60, fs);
+        long samples = mf_reverb_decay(1, comb.gain, comb.delay, threshold);
+        if (samples < 0)
+            return -1;
+        tail = samples > tail ? samples : tail;
+    }
+    if (tail == 0)
+        return 0;
+
+    /* the last of it still runs once through the longer allpass chain */
+    long pass[2] = {0, 0};
+    for (int i = 0; i < 2 * MF_REVERB_STAGES; i++)
+        pass[i % 2] += dly_allpass[i];
+    return tail + (pass[0] > pass[1] ? pass[0] : pass[1]);
+}
+
+long mf_reverb_remainingTail(mf_reverb *x, float dB)
+{
+    float level = fmaxf(fabsf(x->level), fabsf(x->levelTarget));
+    float wet = fmaxf(fabsf(x->wetLevel), fabsf(x->wetTarget));
+    float threshold = powf(10, dB / 20) / (level * wet);
+
+    if (x->frozen || !(threshold > 0))
+        return -1;
+
+    /* input still in the early reflections reaches the combs within the longest tap */
+    int span = 0;
+    float early = 0;
+    if (x->early->taps)
+        early = mf_reverb_tapped(x->early->buffer, MF_EARLY_LENGTH - 1, x->early->counter, x->early->position, x->early->gain, x->early->taps, &span);
+
+    /* the velvet sequences may amplify the comb output by the sum of their pulses */
+    bool velvet = x->velvet && !x->fixedPoint;
+    float spread = 1;
+    for (int c = 0; velvet && c < 2; c++)
+        spread = fmaxf(spread, mf_reverb_spread(x->decorrelator[c]->gain, x->decorrelator[c]->taps));
+
+    long tail = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        float peak = x->fixedPoint ? mf_fixed_comb_peak(x->fixedComb[i]) : mf_comb_peak(x->comb[i]);
+        float gain = x->fixedPoint ? x->fixedComb[i]->gain / 2147483648.f : x->comb[i]->gain;
+        int delay = x->comb[i]->delay;
+        long samples = mf_reverb_decay(peak + early * (span / delay + 1), gain, delay, threshold / spread);
+        /* the rounding of the fixed-point feedback keeps what is left below 2^-16 / (1 - g) */
+        if (samples < 0 || (samples > 0 && x->fixedPoint && 1 / (65536 * (1 - gain)) > threshold))
+            return -1;
+        if (samples > 0 && early > 0)
+            samples += span;
+        tail = samples > tail ? samples : tail;
+    }
+
+    /* after that the velvet lines hold the comb output for their longest pulse */
+    if (velvet)
+    {
+        long longest = 0;
+        for (int c = 0; c < 2; c++)
+        {
+            mf_velvet *v = x->decorrelator[c];
+            float peak = mf_reverb_tapped(v->buffer, MF_VELVET_LENGTH - 1, v->counter, v->position, v->gain, v->taps, &span);
+            if (tail > 0 || peak > threshold)
+                longest = tail + span > longest ? tail + span : longest;
+        }
+        return longest;
+    }
+
+    /* every stage passes on what comes in one delay later and rings down what it holds on its own */
+    int stages = x->fixedPoint ? MF_REVERB_STAGES : x->stages;
+    long longest = 0;
+    for (int c = 0; c < 2; c++)
+    {
+        long chain = tail;
+        for (int i = 0; i < stages; i++)
+        {
+            int f = 2 * i + c;
+            float peak = x->fixedPoint ? mf_fixed_allpass_peak(x->fixedAllpass[f]) : mf_allpass_peak(x->allpass[f]);
+            float gain = x->fixedPoint ? x->fixedAllpass[f]->gain / 32768.f : x->allpass[f]->gain;
+            long ring = mf_reverb_decay(peak, gain, x->allpass[f]->delay, threshold);
+            if (ring < 0)
+                return -1;
+            chain = chain > 0 ? chain + x->allpass[f]->delay : 0;
+            chain = ring > chain ? ring : chain;
+        }
+        longest = chain > longest ? chain : longest;
+    }
+    return longest;
+}
+
+/* events are only pushed from the audio thread */
+static void mf_reverb_report(mf_reverb *x, mf_diag_type type, float value)
+{
+    if (x->diagnostics)
+        mf_diag_push(x->diag, type, x->blocks, value);
+}
+
+mf_reverb_snapshot *mf_reverb_snapshot_new(void)
+{
+    mf_reverb_snapshot *s = (mf_reverb_snapshot *)malloc(sizeof(mf_reverb_snapshot));
+    s->capacity = sizeof(mf_reverb) + 4 * sizeof(mf_comb) + 40 * sizeof(mf_allpass) + sizeof(mf_early)
+        + 4 * sizeof(mf_fixed_comb) + 20 * sizeof(mf_fixed_allpass) + 2 * sizeof(mf_velvet);
+    s->size = 0;
+    s->data = (char *)malloc(s->capacity);
+    return s;
+}
+
+void mf_reverb_snapshot_free(mf_reverb_snapshot *s)
+{
+    free(s->data);
+    free(s);
+}
+
+/* copies to or from the slot and moves on, so save and restore walk the same layout */
+static void mf_reverb_put(char **slot, const void *data, size_t size)
+{
+    memcpy(*slot, data, size);
+    *slot += size;
+}
+
+static void mf_reverb_get(const char **slot, void *data, size_t size)
+{
+    memcpy(data, *slot, size);
+    *slot += size;
+}
+
+/* the header of a filter and the part of its delay line that is in use, with the mirror behind it */
+#define MF_REVERB_FILTER_SIZE(type, filter, sample, guard) \
+    (offsetof(type, buffer) + sizeof(sample) * ((filter)->delay < 0 ? 0 : \
+    (size_t)(filter)->delay + (guard) < sizeof((filter)->buffer) / sizeof(sample) ? (size_t)(filter)->delay + (guard) : sizeof((filter)->buffer) / sizeof(sample)))
+
+void mf_reverb_save(mf_reverb *x, mf_reverb_snapshot *s)
+{
+    char *slot = s->data;
+    mf_reverb_leaveSmall(x);
+
+    mf_reverb_put(&slot, &x->fs, sizeof(x->fs));
+    mf_reverb_put(&slot, &x->t60, sizeof(x->t60));
+    mf_reverb_put(&slot, &x->level, sizeof(x->level));
+    mf_reverb_put(&slot, &x->wetLevel, sizeof(x->wetLevel));
+    mf_reverb_put(&slot, &x->levelTarget, sizeof(x->levelTarget));
+    mf_reverb_put(&slot, &x->wetTarget, sizeof(x->wetTarget));
+    mf_reverb_put(&slot, &x->modDepth, sizeof(x->modDepth));
+    mf_reverb_put(&slot, &x->modRate, sizeof(x->modRate));
+    mf_reverb_put(&slot, &x->fixedPoint, sizeof(x->fixedPoint));
+    mf_reverb_put(&slot, &x->velvet, sizeof(x->velvet));
+    mf_reverb_put(&slot, &x->half, sizeof(x->half));
+    mf_reverb_put(&slot, &x->frozen, sizeof(x->frozen));
+    mf_reverb_put(&slot, &x->stages, sizeof(x->stages));
+    mf_reverb_put(&slot, &x->fade, sizeof(x->fade));
+    mf_reverb_put(&slot, &x->fadeTarget, sizeof(x->fadeTarget));
+    mf_reverb_put(&slot, &x->hold, sizeof(x->hold));
+    mf_reverb_put(&slot, &x->calm, sizeof(x->calm));
+
+    for (int i = 0; i < 4; i++)
+    {
+        mf_reverb_put(&slot, x->comb[i], MF_REVERB_FILTER_SIZE(mf_comb, x->comb[i], float, MF_COMB_GUARD));
+    }
+
+    for (int i = 0; i < 40; i++)
+    {
+        mf_reverb_put(&slot, x->allpass[i], MF_REVERB_FILTER_SIZE(mf_allpass, x->allpass[i], float, MF_ALLPASS_GUARD));
+    }
+
+    /* the delay line of the early reflections is only in use with taps */
+    mf_reverb_put(&slot, x->early, x->early->taps ? sizeof(mf_early) : offsetof(mf_early, buffer));
+
+    if (x->fixedPoint)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            mf_reverb_put(&slot, x->fixedComb[i], MF_REVERB_FILTER_SIZE(mf_fixed_comb, x->fixedComb[i], int16_t, 0));
+        }
+
+        for (int i = 0; i < 20; i++)
+        {
+            mf_reverb_put(&slot, x->fixedAllpass[i], MF_REVERB_FILTER_SIZE(mf_fixed_allpass, x->fixedAllpass[i], int16_t, 0));
+        }
+    }
+
+    if (x->velvet)
+    {
+        mf_reverb_put(&slot, x->decorrelator[0], sizeof(mf_velvet));
+        mf_reverb_put(&slot, x->decorrelator[1], sizeof(mf_velvet));
+    }
+
+    s->size = slot - s->data;
+}
+
+int mf_reverb_restore(mf_reverb *x, const mf_reverb_snapshot *s)
+{
+    const char *slot = s->data;
+    float fs;
+
+    if (s->size == 0)
+        return -1;
+
+    /* delays and gains only fit the sample rate they were saved at */
+    mf_reverb_get(&slot, &fs, sizeof(fs));
+    if (fs != x->fs)
+        return -1;
+    MF_TRACE_INSTANT("restore");
+    mf_reverb_leaveSmall(x);
+
+    mf_reverb_get(&slot, &x->t60, sizeof(x->t60));
+    mf_reverb_get(&slot, &x->level, sizeof(x->level));
+    mf_reverb_get(&slot, &x->wetLevel, sizeof(x->wetLevel));
+    mf_reverb_get(&slot, &x->levelTarget, sizeof(x->levelTarget));
+    mf_reverb_get(&slot, &x->wetTarget, sizeof(x->wetTarget));
+    mf_reverb_get(&slot, &x->modDepth, sizeof(x->modDepth));
+    mf_reverb_get(&slot, &x->modRate, sizeof(x->modRate));
+    mf_reverb_get(&slot, &x->fixedPoint, sizeof(x->fixedPoint));
+    mf_reverb_get(&slot, &x->velvet, sizeof(x->velvet));
+    mf_reverb_get(&slot, &x->half, sizeof(x->half));
+    mf_reverb_get(&slot, &x->frozen, sizeof(x->frozen));
+    mf_reverb_get(&slot, &x->stages, sizeof(x->stages));
+    mf_reverb_get(&slot, &x->fade, sizeof(x->fade));
+    mf_reverb_get(&slot, &x->fadeTarget, sizeof(x->fadeTarget));
+    mf_reverb_get(&slot, &x->hold, sizeof(x->hold));
+    mf_reverb_get(&slot, &x->calm, sizeof(x->calm));
+
+    /* the header comes first, its delay tells how much of the delay line follows */
+    for (int i = 0; i < 4; i++)
+    {
+        mf_reverb_get(&slot, x->comb[i], offsetof(mf_comb, buffer));
+        mf_reverb_get(&slot, x->comb[i]->buffer, MF_REVERB_FILTER_SIZE(mf_comb, x->comb[i], float, MF_COMB_GUARD) - offsetof(mf_comb, buffer));
+    }
+
+    for (int i = 0; i < 40; i++)
+    {
+        mf_reverb_get(&slot, x->allpass[i], offsetof(mf_allpass, buffer));
+        mf_reverb_get(&slot, x->allpass[i]->buffer, MF_REVERB_FILTER_SIZE(mf_allpass, x->allpass[i], float, MF_ALLPASS_GUARD) - offsetof(mf_allpass, buffer));
+    }
+
+    mf_reverb_get(&slot, x->early, offsetof(mf_early, buffer));
+    if (x->early->taps)
+        mf_reverb_get(&slot, x->early->buffer, sizeof(x->early->buffer));
+
+    if (x->fixedPoint)
+    {
+        for (int i = 0; i < 4; i++)
+        {
+            if (!x->fixedComb[i])
+                x->fixedComb[i] = (mf_fixed_comb *)malloc(sizeof(mf_fixed_comb));
+            mf_reverb_get(&slot, x->fixedComb[i], offsetof(mf_fixed_comb, buffer));
+            mf_reverb_get(&slot, x->fixedComb[i]->buffer, MF_REVERB_FILTER_SIZE(mf_fixed_comb, x->fixedComb[i], int16_t, 0) - offsetof(mf_fixed_comb, buffer));
+        }
+
+        for (int i = 0; i < 20; i++)
+        {
+            if (!x->fixedAllpass[i])
+                x->fixedAllpass[i] = (mf_fixed_allpass *)malloc(sizeof(mf_fixed_allpass));
+            mf_reverb_get(&slot, x->fixedAllpass[i], offsetof(mf_fixed_allpass, buffer));
+            mf_reverb_get(&slot, x->fixedAllpass[i]->buffer, MF_REVERB_FILTER_SIZE(mf_fixed_allpass, x->fixedAllpass[i], int16_t, 0) - offsetof(mf_fixed_allpass, buffer));
+        }
+    }
+
+    if (x->velvet)
+    {
+        for (int c = 0; c < 2; c++)
+        {
+            if (!x->decorrelator[c])
+                x->decorrelator[c] = mf_velvet_new();
+            mf_reverb_get(&slot, x->decorrelator[c], sizeof(mf_velvet));
+        }
+    }
+
+    return 0;
+}
+
+/* the comb bank and both allpass chains in Q15, only the results are converted back */
+static void mf_reverb_performFixed(mf_reverb *x, float *in, float *buffer1, float *buffer2, int n)
+{
+    int16_t input[n];
+    int16_t comb_out[4][n];
+    int16_t left[n];
+    int16_t right[n];
+
+    MF_TRACE_BEGIN(combs);
+    if (x->frozen)
+    {
+        for (int c = 0; c < 4; c++)
+            mf_fixed_comb_performFrozen(x->fixedComb[c], comb_out[c], n);
+    }
+    else
+    {
+        mf_fixed_fromFloat(in, input, n);
+        for (int c = 0; c < 4; c++)
+            mf_fixed_comb_perform(x->fixedComb[c], input, comb_out[c], n);
+    }
+
+    for (int i = 0; i<n; i++)
+    {
+        left[i] = (comb_out[0][i] + comb_out[1][i] + comb_out[2][i] + comb_out[3][i] + 2) >> 2;
+        right[i] = left[i];
+    }
+    MF_TRACE_END(combs, "comb bank");
+
+    MF_TRACE_BEGIN(allpasses);
+    for( int i = 0; i<20; i++)
+    {
+        if (i % 2 == 0) mf_fixed_allpass_perform(x->fixedAllpass[i], left, left, n);
+        else mf_fixed_allpass_perform(x->fixedAllpass[i], right, right, n);
+    }
+
+    mf_fixed_toFloat(left, buffer1, n);
+    mf_fixed_toFloat(right, buffer2, n);
+    MF_TRACE_END(allpasses, "allpass chains");
+}
+
+/* the first stages of a chain, the last one crossfaded with its input while it is dropped or added */
+static void mf_reverb_performChain(mf_allpass **chain, int stages, float fade, float fadeStep, float *buffer, int n)
+{
+    if (fade == 1 && fadeStep == 0)
+    {
+        mf_allpass_performCascade(chain, stages, buffer, n);
+        return;
+    }
+
+    float processed[n];
+    mf_allpass_performCascade(chain, stages - 1, buffer, n);
+    mf_allpass_perform(chain[stages - 1], buffer, processed, n);
+
+    for (int i = 0; i < n; i++)
+    {
+        buffer[i] += (fade + i * fadeStep) * (processed[i] - buffer[i]);
+    }
+}
+
+/* the float comb bank and both allpass chains */
+static void mf_reverb_performFloat(mf_reverb *x, float *in, float *buffer1, float *buffer2, int n)
+{
+    float comb_out1[n];
+    float comb_out2[n];
+    float comb_out3[n];
+    float comb_out4[n];
+
+    MF_TRACE_BEGIN(combs);
+    if (x->frozen)
+    {
+        mf_comb_performFrozen(x->comb[0], comb_out1, n);
+        mf_comb_performFrozen(x->comb[1], comb_out2, n);
+        mf_comb_performFrozen(x->comb[2], comb_out3, n);
+        mf_comb_performFrozen(x->comb[3], comb_out4, n);
+    }
+    else
+    {
+        mf_comb_perform(x->comb[0], in, comb_out1, n);
+        mf_comb_perform(x->comb[1], in, comb_out2, n);
+        mf_comb_perform(x->comb[2], in, comb_out3, n);
+        mf_comb_perform(x->comb[3], in, comb_out4, n);
+    }
+
+    /* Assigns the values of the summed comb-filtered signals to buffer1 and buffer2 */
+    for (int i = 0; i<n; i++)
+    {
+        buffer1[i] = (comb_out1[i] + comb_out2[i] + comb_out3[i] + comb_out4[i])/4;
+        buffer2[i] = buffer1[i];
+    }
+    MF_TRACE_END(combs, "comb bank");
+
+    if (x->velvet)
+    {
+        MF_TRACE_BEGIN(velvet);
+        mf_velvet_perform(x->decorrelator[0], buffer1, buffer1, n);
+        mf_velvet_perform(x->decorrelator[1], buffer2, buffer2, n);
+        MF_TRACE_END(velvet, "velvet");
+        return;
+    }
+
+    /* separates the allpass-filtered signals to the buffer1 and buffer2, the even stages are the left chain */
+    mf_allpass *left[MF_REVERB_STAGES];
+    mf_allpass *right[MF_REVERB_STAGES];
+    for (int i = 0; i < MF_REVERB_STAGES; i++)
+    {
+        left[i] = x->allpass[2 * i];
+        right[i] = x->allpass[2 * i + 1];
+    }
+
+    /* a stage that is dropped or added fades linearly over MF_REVERB_SMOOTH */
+    float fadeEnd = x->fade;
+    if (x->fade < x->fadeTarget)
+        fadeEnd = fminf(x->fade + n / (MF_REVERB_SMOOTH * x->fs), x->fadeTarget);
+    else if (x->fade > x->fadeTarget)
+        fadeEnd = fmaxf(x->fade - n / (MF_REVERB_SMOOTH * x->fs), x->fadeTarget);
+    float fadeStep = (fadeEnd - x->fade) / n;
+
+    MF_TRACE_BEGIN(leftChain);
+    mf_reverb_performChain(left, x->stages, x->fade, fadeStep, buffer1, n);
+    MF_TRACE_END(leftChain, "allpass left");
+
+    MF_TRACE_BEGIN(rightChain);
+    mf_reverb_performChain(right, x->stages, x->fade, fadeStep, buffer2, n);
+    MF_TRACE_END(rightChain, "allpass right");
+
+    x->fade = fadeEnd;
+    if (x->fade == 0)
+    {
+        x->stages--;
+        x->fade = x->fadeTarget = 1;
+    }
+}
+
+void mf_reverb_perform(mf_reverb *x, float *in, float *outl, float *outr, int vectorSize)
+{
+    mf_reverb_performSend(x, in, NULL, outl, outr, vectorSize);
+}
+
+void mf_reverb_performSend(mf_reverb *x, float *in, float *send, float *outl, float *outr, int vectorSize)
+{
+    mf_reverb_performSignal(x, in, send, NULL, NULL, outl, outr, vectorSize);
+}
+
+/* true if the graph only needs the static float filters, so the small-block loop can run it */
+static bool mf_reverb_isStatic(mf_reverb *x)
+{
+    return !x->fixedPoint && !x->velvet && !x->half && x->modDepth == 0 && x->fade == 1 && x->fadeTarget == 1;
+}
+
+/* the graph kernel on the compact state, which is taken over from the filters on the first small block */
+static void mf_reverb_performSmall(mf_reverb *x, float *in, float *buffer1, float *buffer2, int n)
+{
+    mf_reverb_compact *c = &x->compact;
+
+    if (!c->active)
+    {
+        c->stages = x->stages;
+        for (int f = 0; f < 4 + 2 * c->stages; f++)
+        {
+            if (f < 4)
+            {
+                c->line[f] = x->comb[f]->buffer;
+                c->gain[f] = x->frozen ? 1 : x->comb[f]->gain;
+                c->delay[f] = x->comb[f]->delay;
+                c->counter[f] = x->comb[f]->counter >= x->comb[f]->delay ? 0 : x->comb[f]->counter;
+            }
+            else
+            {
+                c->line[f] = x->allpass[f - 4]->buffer;
+                c->gain[f] = x->allpass[f - 4]->gain;
+                c->delay[f] = x->allpass[f - 4]->delay;
+                c->counter[f] = x->allpass[f - 4]->counter >= x->allpass[f - 4]->delay ? 0 : x->allpass[f - 4]->counter;
+            }
+        }
+        c->active = true;
+    }
+
+    /* frozen combs write back 0 + 1 * delayed, which is the delayed sample itself */
+    if (x->frozen)
+    {
+        float silence[n];
+        memset(silence, 0, sizeof(silence));
+        mf_kernels_current.graph(c->line, c->gain, c->delay, c->counter, c->stages, silence, buffer1, buffer2, n);
+    }
+    else
+        mf_kernels_current.graph(c->line, c->gain, c->delay, c->counter, c->stages, in, buffer1, buffer2, n);
+}
+
+static double mf_reverb_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* judges the load of the last block and starts to drop or add a stage */
+static void mf_reverb_adapt(mf_reverb *x, double seconds, int n)
+{
+    float period = n / x->fs;
+    x->load += (seconds / period - x->load) * (1 - expf(-n / (MF_REVERB_LOAD_TIME * x->fs)));
+    x->hold -= period;
+
+    /* one change at a time */
+    if (x->fade != x->fadeTarget || x->hold > 0)
+        return;
+
+    if (x->budget > 0 && x->load > x->budget)
+    {
+        x->calm = 0;
+        if (x->stages > MF_REVERB_MIN_STAGES)
+        {
+            MF_TRACE_INSTANT("drop stage");
+            mf_reverb_report(x, MF_DIAG_STAGES, x->stages - 1);
+            x->fadeTarget = 0;
+            x->hold = MF_REVERB_HOLD;
+        }
+        return;
+    }
+
+    x->calm = x->budget == 0 || x->load < x->budget * MF_REVERB_HEADROOM ? x->calm + period : 0;
+    if (x->stages < MF_REVERB_STAGES && (x->budget == 0 || x->calm >= MF_REVERB_CALM))
+    {
+        /* the stage starts from silence instead of the tail it had when it was dropped */
+        MF_TRACE_INSTANT("add stage");
+        mf_allpass_clearBuffer(x->allpass[2 * x->stages]);
+        mf_allpass_clearBuffer(x->allpass[2 * x->stages + 1]);
+        x->stages++;
+        mf_reverb_report(x, MF_DIAG_STAGES, x->stages);
+        x->fade = 0;
+        x->fadeTarget = 1;
+        x->calm = 0;
+        x->hold = MF_REVERB_HOLD;
+    }
+}
+
+/* silences a block with a non-finite sample and clears only the delay lines that hold one */
+static void mf_reverb_recover(mf_reverb *x, float *outl, float *outr, int n)
+{
+    long cleared = x->clearedLines;
+    MF_TRACE_INSTANT("recover");
+    x->recoveries++;
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (mf_comb_recover(x->comb[i]))
+            x->clearedLines++;
+    }
+
+    for (int i = 0; i < 2 * MF_REVERB_STAGES; i++)
+    {
+        if (mf_allpass_recover(x->allpass[i]))
+            x->clearedLines++;
+    }
+
+    if (!mf_kernels_current.finite(x->early->buffer, sizeof(x->early->buffer) / sizeof(float)))
+    {
+        mf_early_clearBuffer(x->early);
+        x->clearedLines++;
+    }
+
+    for (int c = 0; c < 2; c++)
+    {
+        if (x->decorrelator[c] && !mf_kernels_current.finite(x->decorrelator[c]->buffer, sizeof(x->decorrelator[c]->buffer) / sizeof(float)))
+        {
+            mf_velvet_clearBuffer(x->decorrelator[c]);
+            x->clearedLines++;
+        }
+    }
+
+    /* the fixed-point delay lines can not hold a non-finite sample */
+    memset(outl, 0, n * sizeof(float));
+    memset(outr, 0, n * sizeof(float));
+    x->level = 0;
+    memset(x->meter, 0, sizeof(x->meter));
+    x->meterSamples = 0;
+    mf_reverb_report(x, MF_DIAG_RECOVERY, x->clearedLines - cleared);
+}
+
+/* reports a block that overran its period, clipped or went denormal */
+static void mf_reverb_diagnose(mf_reverb *x, const float *outl, const float *outr, int n, double seconds)
+{
+    float peak = 0;
+    int denormals = 0;
+
+    for (int i = 0; i < n; i++)
+    {
+        float l = fabsf(outl[i]);
+        float r = fabsf(outr[i]);
+        peak = fmaxf(peak, fmaxf(l, r));
+        denormals += (l > 0 && l < FLT_MIN) + (r > 0 && r < FLT_MIN);
+    }
+
+    if (seconds * x->fs > n)
+        mf_reverb_report(x, MF_DIAG_OVERRUN, seconds * x->fs / n);
+    if (peak > 1)
+        mf_reverb_report(x, MF_DIAG_CLIP, peak);
+    if (denormals >= MF_REVERB_DENORMAL_SHARE * 2 * n)
+        mf_reverb_report(x, MF_DIAG_DENORMAL, denormals / (2.f * n));
+}
+
+/* one step of the smoothing, close enough values snap to the target */
+static float mf_reverb_approach(float current, float target, float decay)
+{
+    float next = target + (current - target) * decay;
+    return fabsf(next - target) < 1e-6f ? target : next;
+}
+
+void mf_reverb_performSignal(mf_reverb *x, float *in, float *send, float *wet, float *level, float *outl, float *outr, int vectorSize)
+{
+    int n = vectorSize;
+    float early[n];
+    float *source = in;
+    double start = x->budget > 0 || x->diagnostics ? mf_reverb_now() : 0;
+    MF_TRACE_BEGIN(block);
+    MF_TRACE_BEGIN(reflections);
+
+    /* the early reflections feed the combs, the dry signal stays untouched; frozen combs take no input */
+    if (send && !x->frozen)
+    {
+        for (int i = 0; i < n; i++)
+            early[i] = in[i] + send[i];
+        mf_early_perform(x->early, early, early, n);
+        source = early;
+    }
+    else if (x->early->taps && !x->frozen)
+    {
+        mf_early_perform(x->early, in, early, n);
+        source = early;
+    }
+    MF_TRACE_END(reflections, "early reflections");
+
+    /* the smoothed values move towards their targets once per block and are ramped in between */
+    if (x->smoothSize != n)
+    {
+        x->smoothDecay = expf(-n / (MF_REVERB_SMOOTH * x->fs));
+        x->smoothSize = n;
+    }
+    float levelEnd = mf_reverb_approach(x->level, x->levelTarget, x->smoothDecay);
+    float wetEnd = mf_reverb_approach(x->wetLevel, x->wetTarget, x->smoothDecay);
+    float levelStep = (levelEnd - x->level) / n;
+    float wetStep = (wetEnd - x->wetLevel) / n;
+
+    float buffer1[n];
+    float buffer2[n];
+
+    if (n <= MF_REVERB_SMALL && mf_reverb_isStatic(x))
+    {
+        MF_TRACE_BEGIN(small);
+        mf_reverb_performSmall(x, source, buffer1, buffer2, n);
+        MF_TRACE_END(small, "small block");
+    }
+    else
+    {
+        mf_reverb_leaveSmall(x);
+        if (x->fixedPoint)
+            mf_reverb_performFixed(x, source, buffer1, buffer2, n);
+        else
+            mf_reverb_performFloat(x, source, buffer1, buffer2, n);
+    }
+
+    /* The original signal is mixed with the processed signal */
+    MF_TRACE_BEGIN(mix);
+    if (wet || level)
+    {
+        float levels[n];
+        float wets[n];
+
+        for (int i = 0; i < n; i++)
+        {
+            levels[i] = (x->level + i * levelStep) * (level ? level[i] : 1);
+            wets[i] = wet ? wet[i] / 200 : x->wetLevel + i * wetStep;
+        }
+        mf_kernels_current.mixSignal(in, buffer1, buffer2, outl, outr, levels, wets, n, x->metering ? x->meter : NULL);
+    }
+    else
+        mf_kernels_current.mix(in, buffer1, buffer2, outl, outr, x->level, levelStep, x->wetLevel, wetStep, n, x->metering ? x->meter : NULL);
+    if (x->metering)
+        x->meterSamples += n;
+    MF_TRACE_END(mix, "mix");
+
+    x->level = levelEnd;
+    x->wetLevel = wetEnd;
+
+    /* a delay line that blew up or a non-finite input shows in the outputs */
+    if (!mf_kernels_current.finite(outl, n) || !mf_kernels_current.finite(outr, n))
+        mf_reverb_recover(x, outl, outr, n);
+
+    double seconds = x->budget > 0 || x->diagnostics ? mf_reverb_now() - start : 0;
+    if (!x->fixedPoint && !x->velvet && (x->budget > 0 || x->stages < MF_REVERB_STAGES))
+        mf_reverb_adapt(x, x->budget > 0 ? seconds : 0, n);
+    if (x->diagnostics)
+        mf_reverb_diagnose(x, outl, outr, n, seconds);
+    x->blocks++;
+    MF_TRACE_END(block, "mf_reverb");
+}
@@ -0,0 +1,495 @@
+/**
+ * @file mf_reverb.h
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * The reverb engine <br>
+ * <br>
+ * @brief Audio Object combining comb and allpass filters to a reverb <br>
+ * <br>
+ * mf_reverb holds the complete filter graph of the reverb: an optional <br>
+ * early reflection stage, four parallel comb filters followed by two chains of ten allpass filters, one for each <br>
+ * channel. It has no dependency on Pd, so it is used by mf_reverb~ as well <br>
+ * as by the offline tools. <br>
+ * <br>
+ */
+
+#ifndef mf_reverb_h
+#define mf_reverb_h
+#include <stdbool.h>
+#include "mf_allpass.h"
+#include "mf_comb.h"
+#include "mf_diag.h"
+#include "mf_early.h"
+#include "mf_fixed.h"
+#include "mf_kernels.h"
+#include "mf_velvet.h"
+
+#define MF_REVERB_SMOOTH .02f /**< time constant of the level and wet smoothing in seconds */
+#define MF_REVERB_STAGES 10    /**< allpass stages per channel */
+#define MF_REVERB_SMALL 16     /**< blocks up to this size run through the whole graph in one kernel call */
+#define MF_REVERB_MIN_STAGES 4 /**< the adaptive mode keeps at least this many stages per channel */
+#define MF_REVERB_LOAD_TIME .1f /**< time constant of the measured load in seconds */
+#define MF_REVERB_HOLD .25f     /**< seconds after dropping a stage before the load is judged again */
+#define MF_REVERB_HEADROOM .7f  /**< a stage comes back when the load stays below this part of the budget */
+#define MF_REVERB_CALM 1.f      /**< for this many seconds */
+#define MF_REVERB_VELVET_LENGTH .03f /**< length of the velvet-noise sequences in seconds */
+#define MF_REVERB_VELVET_TAPS 48     /**< pulses per sequence, 1600 per second */
+#define MF_REVERB_DENORMAL_SHARE .25f /**< share of denormal output samples that makes a block a diagnostics event */
+#define MF_REVERB_MAX_FS 88200 /**< highest standard sample rate whose comb delays fit the comb buffers */
+
+/**
+ * @struct mf_reverb_compact
+ * @brief The static float graph in one place for blocks of up to MF_REVERB_SMALL samples <br>
+ * @var mf_reverb_compact::active True while the counters here are newer than the ones of the filters <br>
+ * @var mf_reverb_compact::stages The number of allpass stages per channel <br>
+ * @var mf_reverb_compact::line The delay lines of the 4 combs followed by the allpass filters <br>
+ * @var mf_reverb_compact::gain The gains in the same order <br>
+ * @var mf_reverb_compact::delay The delays in the same order <br>
+ * @var mf_reverb_compact::counter The indices in the same order <br>
+ * The layout is the one of the graph kernel in mf_kernels.h, so a small block <br>
+ * reads one contiguous structure instead of the headers of 24 filters <br>
+ */
+
+typedef struct mf_reverb_compact
+{
+    bool active;
+    int stages;
+    float *line[4 + 2 * MF_REVERB_STAGES];
+    float gain[4 + 2 * MF_REVERB_STAGES];
+    int delay[4 + 2 * MF_REVERB_STAGES];
+    int counter[4 + 2 * MF_REVERB_STAGES];
+} mf_reverb_compact;
+
+/**
+ * @struct mf_reverb
+ * @brief A structure for the reverb engine <br>
+ * @var mf_reverb::allpass The allpass filters, the even ones feed the left, the odd ones the right channel <br>
+ * @var mf_reverb::comb The parallel comb filters <br>
+ * @var mf_reverb::early The early reflections, they feed the comb filters <br>
+ * @var mf_reverb::t60 The reverberation time in seconds <br>
+ * @var mf_reverb::fs The sample rate <br>
+ * @var mf_reverb::level The output level, used to mute the output <br>
+ * @var mf_reverb::wetLevel The level of the processed signal <br>
+ * @var mf_reverb::levelTarget The output level that level approaches <br>
+ * @var mf_reverb::wetTarget The level of the processed signal that wetLevel approaches <br>
+ * @var mf_reverb::modDepth The modulation depth in milliseconds <br>
+ * @var mf_reverb::modRate The modulation rate in Hz <br>
+ * @var mf_reverb::fixedPoint True if the filters run in fixed-point <br>
+ * @var mf_reverb::fixedComb The fixed-point comb filters, allocated when first used <br>
+ * @var mf_reverb::fixedAllpass The fixed-point allpass filters of both chains <br>
+ * @var mf_reverb::budget The allowed processing time as part of the block period, 0 runs all stages <br>
+ * @var mf_reverb::load The smoothed processing time as part of the block period <br>
+ * @var mf_reverb::stages The number of allpass stages per channel that are processed <br>
+ * @var mf_reverb::fade The gain of the last processed stage, it is crossfaded with its input <br>
+ * @var mf_reverb::fadeTarget The gain fade approaches, 0 while the stage is dropped <br>
+ * @var mf_reverb::hold The seconds until the load is judged again <br>
+ * @var mf_reverb::calm The seconds the load has stayed below the headroom <br>
+ * @var mf_reverb::velvet True if velvet-noise sequences replace the allpass chains <br>
+ * @var mf_reverb::decorrelator The velvet-noise decorrelators of both channels, allocated when first used <br>
+ * @var mf_reverb::compact The filter state of the small-block loop <br>
+ * @var mf_reverb::smoothSize The block size smoothDecay was calculated for, 0 for none <br>
+ * @var mf_reverb::smoothDecay The decay of the level and wet smoothing per block <br>
+ * @var mf_reverb::half True if the float filters store their delay lines in half precision <br>
+ * @var mf_reverb::recoveries The number of blocks with an infinite or NaN output <br>
+ * @var mf_reverb::clearedLines The number of delay lines cleared by these blocks <br>
+ * @var mf_reverb::diagnostics True if the engine reports events to diag <br>
+ * @var mf_reverb::diag The ring of diagnostics events, allocated when first used <br>
+ * @var mf_reverb::blocks The number of blocks processed, the time stamp of the events <br>
+ * @var mf_reverb::metering True if the mix measures the wet and output signals into meter <br>
+ * @var mf_reverb::meter Peaks and sums of squares since the last mf_reverb_readMeter, see MF_KERNELS_METER <br>
+ * @var mf_reverb::meterSamples The number of samples in meter <br>
+ * @var mf_reverb::frozen True if the combs replay their delay lines and ignore the input <br>
+ */
+
+typedef struct mf_reverb
+{
+    mf_allpass *allpass[40];
+    mf_comb *comb[4];
+    mf_early *early;
+    float t60;
+    float fs;
+    float level;
+    float wetLevel;
+    float levelTarget;
+    float wetTarget;
+    float modDepth;
+    float modRate;
+    bool fixedPoint;
+    mf_fixed_comb *fixedComb[4];
+    mf_fixed_allpass *fixedAllpass[20];
+    float budget;
+    float load;
+    int stages;
+    float fade;
+    float fadeTarget;
+    float hold;
+    float calm;
+    bool velvet;
+    mf_velvet *decorrelator[2];
+    mf_reverb_compact compact;
+    int smoothSize;
+    float smoothDecay;
+    bool half;
+    long recoveries;
+    long clearedLines;
+    bool diagnostics;
+    mf_diag *diag;
+    uint32_t blocks;
+    bool metering;
+    float meter[MF_KERNELS_METER];
+    long meterSamples;
+    bool frozen;
+} mf_reverb;
+
+/**
+ * @struct mf_reverb_snapshot
+ * @brief A preallocated slot for the state of a reverb engine <br>
+ * @var mf_reverb_snapshot::capacity The size of data in bytes, enough for any engine <br>
+ * @var mf_reverb_snapshot::size The number of bytes in use, 0 for an empty slot <br>
+ * @var mf_reverb_snapshot::data The parameters of the engine followed by every filter, <br>
+ * each as its header and the part of its delay line that is in use <br>
+ */
+
+typedef struct mf_reverb_snapshot
+{
+    size_t capacity;
+    size_t size;
+    char *data;
+} mf_reverb_snapshot;
+
+/**
+ * @related mf_reverb
+ * @brief Creates a new reverb engine<br>
+ * @param t60 The reverberation time in seconds <br>
+ * @param fs The sample rate <br>
+ * The function allocates all filters and configures them <br>
+ * @return a pointer to the newly created mf_reverb object <br>
+ */
+
+mf_reverb *mf_reverb_new(float t60, float fs);
+
+/**
+ * @related mf_reverb
+ * @brief Frees a reverb engine and all of its filters<br>
+ * @param x My reverb object <br>
+ */
+
+void mf_reverb_free(mf_reverb *x);
+
+/**
+ * @related mf_reverb
+ * @brief Sets reverberation time and sample rate <br>
+ * @param x My reverb object <br>
+ * @param t60 The reverberation time in seconds <br>
+ * @param fs The sample rate <br>
+ * The function recalculates delays and gains of all filters and <br>
+ * clears their buffers, so an engine can be reused for a new signal. <br>
+ * Above MF_REVERB_MAX_FS the longest comb delays are cut to the buffer <br>
+ */
+
+void mf_reverb_configure(mf_reverb *x, float t60, float fs);
+
+/**
+ * @related mf_reverb
+ * @brief Clears the buffers of all filters<br>
+ * @param x My reverb object <br>
+ */
+
+void mf_reverb_clear(mf_reverb *x);
+
+/**
+ * @related mf_reverb
+ * @brief Sets the wet level of the reverb<br>
+ * @param x My reverb object <br>
+ * @param wet The wet level from 0 to 100, as sent to the wet message of mf_reverb~ <br>
+ * The level is smoothed with the time constant MF_REVERB_SMOOTH <br>
+ */
+
+void mf_reverb_setWet(mf_reverb *x, float wet);
+
+/**
+ * @related mf_reverb
+ * @brief Sets the output level of the reverb<br>
+ * @param x My reverb object <br>
+ * @param level The output level, 0 mutes the output <br>
+ * The level is smoothed with the time constant MF_REVERB_SMOOTH <br>
+ */
+
+void mf_reverb_setLevel(mf_reverb *x, float level);
+
+/**
+ * @related mf_reverb
+ * @brief Jumps the smoothed levels to their targets<br>
+ * @param x My reverb object <br>
+ * Used when the engine starts on a new signal, e.g. a new file <br>
+ */
+
+void mf_reverb_settle(mf_reverb *x);
+
+/**
+ * @related mf_reverb
+ * @brief Modulates the delays of the comb and allpass filters<br>
+ * @param x My reverb object <br>
+ * @param depth The modulation depth in milliseconds, 0 turns it off <br>
+ * @param rate The LFO frequency in Hz <br>
+ * Every filter gets a slightly detuned rate and its own start phase, <br>
+ * so the modulation does not move all delays in parallel
+ */
+
+void mf_reverb_setModulation(mf_reverb *x, float depth, float rate);
+
+/**
+ * @related mf_reverb
+ * @brief Sets the taps of the early reflections<br>
+ * @param x My reverb object <br>
+ * @param time The delays in milliseconds <br>
+ * @param gain The gains <br>
+ * @param taps The number of taps, 0 turns the early reflections off <br>
+ */
+
+void mf_reverb_setTaps(mf_reverb *x, const float *time, const float *gain, int taps);
+
+/**
+ * @related mf_reverb
+ * @brief Calculates the early reflections of a shoebox room<br>
+ * @param x My reverb object <br>
+ * @param width The width of the room in metres <br>
+ * @param depth The depth of the room in metres <br>
+ * @param height The height of the room in metres <br>
+ * @param reflection The reflection coefficient of the walls from 0 to 1 <br>
+ * See mf_early_setRoom for the model <br>
+ */
+
+void mf_reverb_setRoom(mf_reverb *x, float width, float depth, float height, float reflection);
+
+/**
+ * @related mf_reverb
+ * @brief Switches the comb and allpass filters to fixed-point<br>
+ * @param x My reverb object <br>
+ * @param on True for the Q15 filters of mf_fixed.h, false for float <br>
+ * The fixed-point filters take over delays and gains of the float filters <br>
+ * and start with cleared delay lines, the modulation is ignored <br>
+ */
+
+void mf_reverb_setFixedPoint(mf_reverb *x, bool on);
+
+/**
+ * @related mf_reverb
+ * @brief Replaces the allpass chains with velvet-noise decorrelators<br>
+ * @param x My reverb object <br>
+ * @param on True for two velvet-noise sequences of MF_REVERB_VELVET_TAPS pulses, <br>
+ * one per channel, false for the allpass chains <br>
+ * The decorrelators start with cleared delay lines. The fixed-point filters <br>
+ * always use their allpass chains <br>
+ */
+
+void mf_reverb_setVelvet(mf_reverb *x, bool on);
+
+/**
+ * @related mf_reverb
+ * @brief Lets the engine trade allpass stages for processing time<br>
+ * @param x My reverb object <br>
+ * @param budget The allowed time per block as part of the block period, e.g. <br>
+ * .05 for 5 %, 0 turns the adaptive mode off and brings back all stages <br>
+ * The engine measures every block. When the smoothed load exceeds the budget, <br>
+ * the last stage of both allpass chains is crossfaded out over MF_REVERB_SMOOTH <br>
+ * and then skipped, down to MF_REVERB_MIN_STAGES. After MF_REVERB_CALM seconds <br>
+ * below MF_REVERB_HEADROOM of the budget, a stage is cleared and faded back in. <br>
+ * The gap between both thresholds is larger than the cost of one stage, so the <br>
+ * engine does not oscillate. Only the float filters adapt, the fixed-point <br>
+ * filters always run all stages <br>
+ */
+
+void mf_reverb_setBudget(mf_reverb *x, float budget);
+
+/**
+ * @related mf_reverb
+ * @brief Stores the delay lines of the float filters in half precision<br>
+ * @param x My reverb object <br>
+ * @param on True for half precision, false for float <br>
+ * The delay lines are converted and keep their tail. The filters read and <br>
+ * write half the memory at the price of a conversion per sample, so this <br>
+ * reduces the memory footprint rather than the time while the delay lines <br>
+ * fit in the caches. The fixed-point filters are not affected <br>
+ */
+
+void mf_reverb_setHalf(mf_reverb *x, bool on);
+
+/**
+ * @related mf_reverb
+ * @brief Reports anomalies of the audio thread to mf_reverb::diag<br>
+ * @param x My reverb object <br>
+ * @param on True to report, false to stop. The ring and the events in it are kept <br>
+ * While on, every block is timed and its outputs are scanned. Blocks that take <br>
+ * longer than their period, clip, or have at least MF_REVERB_DENORMAL_SHARE denormal <br>
+ * samples are pushed as events, as are recoveries from non-finite outputs and changes <br>
+ * of the adaptive allpass stages. Another thread pops them with mf_diag_pop; the <br>
+ * audio thread never waits for it, a full ring drops events <br>
+ */
+
+void mf_reverb_setDiagnostics(mf_reverb *x, bool on);
+
+/**
+ * @related mf_reverb
+ * @brief Freezes the tail<br>
+ * @param x My reverb object <br>
+ * @param on True to freeze, false to go on from the frozen state <br>
+ * While frozen the comb delay lines are replayed as they are, with mf_comb_performFrozen, <br>
+ * so the tail sustains forever without a gain or rounding error piling up. Small blocks <br>
+ * stay in the graph kernel with comb gains of 1 and a silent input, which writes every <br>
+ * sample back unchanged and keeps the cost of the fused loop. The early <br>
+ * reflections and the sends are not processed and the input only reaches the dry <br>
+ * signal. The allpass chains or velvet decorrelators keep running on the comb output. <br>
+ * On release the early reflections start from silence, so the input of the frozen <br>
+ * time does not come back <br>
+ */
+
+void mf_reverb_setFreeze(mf_reverb *x, bool on);
+
+/**
+ * @related mf_reverb
+ * @brief Measures the wet and output signals in the mix<br>
+ * @param x My reverb object <br>
+ * @param on True to measure, false to stop. Either way the meter starts from zero <br>
+ * The mix kernels keep the peaks and sums of squares in their vector registers while <br>
+ * they write the outputs, so the signals are not read a second time <br>
+ */
+
+void mf_reverb_setMetering(mf_reverb *x, bool on);
+
+/**
+ * @related mf_reverb
+ * @brief Reads the meter and starts it again from zero<br>
+ * @param x My reverb object <br>
+ * @param peak The peak magnitudes of wet left, wet right, output left and output right <br>
+ * @param rms The RMS values of the same signals <br>
+ * @return the number of samples measured since the last read, 0 leaves peak and rms at 0 <br>
+ * The meter is written by the audio thread, read it from the same thread or between blocks. <br>
+ * A block recovered from a non-finite sample restarts the meter <br>
+ */
+
+long mf_reverb_readMeter(mf_reverb *x, float *peak, float *rms);
+
+/**
+ * @related mf_reverb
+ * @brief Estimates how long a tail of a given reverberation time lasts<br>
+ * @param t60 The reverberation time in seconds <br>
+ * @param fs The sample rate <br>
+ * @param dB The level the tail has to fall to, relative to full scale, e.g. -96 <br>
+ * @return the number of samples after the input ends, -1 if the tail never falls to dB <br>
+ * The estimate starts from full-scale delay lines in all combs and counts whole round <br>
+ * trips with the gains of mf_comb_setGain, plus one pass through the longer allpass chain. <br>
+ * It does not need an engine, e.g. to reserve the output of a render before it starts <br>
+ */
+
+long mf_reverb_expectedTail(float t60, float fs, float dB);
+
+/**
+ * @related mf_reverb
+ * @brief Estimates how long the output of the engine stays above a level without input<br>
+ * @param x My reverb object <br>
+ * @param dB The output level in dBFS the tail has to fall to, e.g. -96 <br>
+ * @return the number of samples, 0 if the output is already below dB, -1 if it never gets there, <br>
+ * e.g. while frozen or below the level the fixed-point combs keep in their rounding <br>
+ * The peaks of the delay lines that are in use are read and run down with the comb gains <br>
+ * round trip by round trip, input still waiting in the early reflections included. The allpass <br>
+ * stages pass the comb output on one delay later and ring down their own content with their <br>
+ * gains, the velvet sequences add their longest pulse. Output level and wet level scale the <br>
+ * threshold. The estimate reads a few ten kilobytes of delay lines, call it between blocks, <br>
+ * not per sample, and call it again when the time is up: as a peak bound it is usually too long <br>
+ */
+
+long mf_reverb_remainingTail(mf_reverb *x, float dB);
+
+/**
+ * @related mf_reverb_snapshot
+ * @brief Allocates an empty slot large enough for the state of any engine<br>
+ * @return a pointer to the newly created mf_reverb_snapshot object <br>
+ */
+
+mf_reverb_snapshot *mf_reverb_snapshot_new(void);
+
+/**
+ * @related mf_reverb_snapshot
+ * @brief Frees a slot<br>
+ * @param s The slot <br>
+ */
+
+void mf_reverb_snapshot_free(mf_reverb_snapshot *s);
+
+/**
+ * @related mf_reverb
+ * @brief Copies the complete state of the engine to a slot<br>
+ * @param x My reverb object <br>
+ * @param s The slot, its previous content is overwritten <br>
+ * Parameters, the freeze, the adaptive stage count with its fade, delays, <br>
+ * gains, indices and the used part of every delay line are copied one after <br>
+ * the other, so the function does not allocate and <br>
+ * only moves a few ten kilobytes for the default graph <br>
+ */
+
+void mf_reverb_save(mf_reverb *x, mf_reverb_snapshot *s);
+
+/**
+ * @related mf_reverb
+ * @brief Restores the state saved in a slot, including the running tail<br>
+ * @param x My reverb object <br>
+ * @param s The slot <br>
+ * @return 0 on success, -1 if the slot is empty or was saved at another sample rate <br>
+ * A slot with fixed-point or velvet-noise state allocates these filters if the <br>
+ * engine did not use them before, otherwise the function does not allocate <br>
+ */
+
+int mf_reverb_restore(mf_reverb *x, const mf_reverb_snapshot *s);
+
+/**
+ * @related mf_reverb
+ * @brief Processes one block of the reverb <br>
+ * @param x My reverb object <br>
+ * @param in The mono input vector <br>
+ * @param outl The output vector for the left channel <br>
+ * @param outr The output vector for the right channel <br>
+ * @param vectorSize The vectorSize <br>
+ * The input may share its memory with one of the outputs <br>
+ */
+
+void mf_reverb_perform(mf_reverb *x, float *in, float *outl, float *outr, int vectorSize);
+
+/**
+ * @related mf_reverb
+ * @brief Processes one block of the reverb with an additional send input <br>
+ * @param x My reverb object <br>
+ * @param in The mono input vector, processed and mixed in dry <br>
+ * @param send A vector that is only processed, e.g. the sum of a send bus, or NULL <br>
+ * @param outl The output vector for the left channel <br>
+ * @param outr The output vector for the right channel <br>
+ * @param vectorSize The vectorSize <br>
+ */
+
+void mf_reverb_performSend(mf_reverb *x, float *in, float *send, float *outl, float *outr, int vectorSize);
+
+/**
+ * @related mf_reverb
+ * @brief Processes one block of the reverb with wet and level given per sample <br>
+ * @param x My reverb object <br>
+ * @param in The mono input vector, processed and mixed in dry <br>
+ * @param send A vector that is only processed, or NULL <br>
+ * @param wet The wet level from 0 to 100 per sample, or NULL for the smoothed value of mf_reverb_setWet <br>
+ * @param level The output level per sample, or NULL. It is multiplied with the smoothed <br>
+ * value of mf_reverb_setLevel, so muting still works <br>
+ * @param outl The output vector for the left channel <br>
+ * @param outr The output vector for the right channel <br>
+ * @param vectorSize The vectorSize <br>
+ * The inputs may share their memory with the outputs. Blocks of up to <br>
+ * MF_REVERB_SMALL samples without modulation, velvet noise, fixed-point, half <br>
+ * precision or a fading allpass stage run the combs and allpasses in one kernel <br>
+ * call on mf_reverb::compact, which avoids the fixed cost of 24 filter calls in block~ 1 to 16. <br>
+ * Every output block is checked for infinite and NaN samples. A block that has one is <br>
+ * replaced by silence, only the delay lines holding such a sample are cleared and the <br>
+ * output level starts again from 0, so it fades back in over MF_REVERB_SMOOTH. The events <br>
+ * are counted in mf_reverb::recoveries and mf_reverb::clearedLines <br>
+ */
+
+void mf_reverb_performSignal(mf_reverb *x, float *in, float *send, float *wet, float *level, float *outl, float *outr, int vectorSize);
+
+#endif /* mf_reverb_h */
@@ -0,0 +1,562 @@
+/**
+ * @file mf_bench.c
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Benchmark of the filter kernels <br>
+ * <br>
+ * @brief Measures the cost of the comb and allpass kernels outside of Pd <br>
+ * <br>
+ * mf_bench runs the filter graph of mf_reverb~ (4 combs, 2 x 10 allpasses) <br>
+ * on white noise and prints the time per sample for every configuration. <br>
+ * The static graph runs with every kernel version the CPU supports, the <br>
+ * program fails if the modulated graph costs more than MF_BENCH_MODULATED_BOUND <br>
+ * times the static one. <br>
+ * The early reflections of a room are compared against a single comb. <br>
+ * The velvet-noise decorrelators are compared against the allpass chains, <br>
+ * by their cost and by the correlation of the left and right output. <br>
+ * The fixed-point engine is compared against the float engine, the program <br>
+ * fails if the deviation exceeds the bound documented in mf_fixed.h. <br>
+ * Half-precision delay lines are compared against float on MF_BENCH_ENGINES <br>
+ * engines, whose delay lines together do not fit in L2 as float, by their <br>
+ * time, their memory and the noise floor of their output. <br>
+ * The metered engine is compared against the plain one, the program fails if <br>
+ * metering changes a single output sample. The frozen engine is compared <br>
+ * against the running one, the program fails if its tail does not hold. <br>
+ * Usage: mf_bench [blocksize] [seconds] <br>
+ * <br>
+ */
+
+#include "mf_allpass.h"
+#include "mf_comb.h"
+#include "mf_early.h"
+#include "mf_kernels.h"
+#include "mf_reverb.h"
+#include "mf_velvet.h"
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#define MF_BENCH_FS 44100
+#define MF_BENCH_FIXED_BOUND (1.f / 1024) /**< error bound of mf_fixed.h */
+#define MF_BENCH_ENGINES 64                /**< engines of the half-precision comparison */
+#define MF_BENCH_MODULATED_BOUND 1.25f     /**< cost of the modulated graph relative to the static one */
+#define MF_BENCH_ROUNDS 16                 /**< rounds of the static and the modulated graph */
+
+static int dly_allpass[20] = {262,171,355,290,244,327,487,251,162,592,313,432,502,616,340,85,291,119,450,52};
+
+static double mf_bench_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/**
+ * @brief Runs the filter graph for the given number of samples <br>
+ * @param modDepth The modulation depth in samples, 0 for static delays <br>
+ * @param vectorSize The block size <br>
+ * @param samples The number of samples to process <br>
+ * @return the processing time in nanoseconds per sample <br>
+ */
+
+static double mf_bench_graph(float modDepth, int vectorSize, long samples)
+{
+    mf_comb *comb[4];
+    mf_allpass *allpass[20];
+    float in[vectorSize], combOut[vectorSize], left[vectorSize], right[vectorSize];
+
+    for (int i = 0; i < 4; i++)
+    {
+        comb[i] = mf_comb_new();
+        mf_comb_setDelay(comb[i], floor((.03 + i*.005) * MF_BENCH_FS));
+        mf_comb_setGain(comb[i], 3, MF_BENCH_FS);
+        mf_comb_clearBuffer(comb[i]);
+        mf_comb_setModulation(comb[i], modDepth, .5 * (1 + .13 * i), i / 4.f, MF_BENCH_FS);
+    }
+
+    for (int i = 0; i < 20; i++)
+    {
+        allpass[i] = mf_allpass_new();
+        mf_allpass_setDelay(allpass[i], dly_allpass[i]);
+        mf_allpass_clearBuffer(allpass[i]);
+        mf_allpass_setModulation(allpass[i], modDepth, .5 * (1 + .07 * i), i / 20.f, MF_BENCH_FS);
+    }
+
+    srand(1);
+    for (int i = 0; i < vectorSize; i++)
+        in[i] = rand() / (float)RAND_MAX - .5f;
+
+    long blocks = samples / vectorSize;
+    double start = mf_bench_now();
+
+    for (long b = 0; b < blocks; b++)
+    {
+        memset(left, 0, sizeof(left));
+        for (int c = 0; c < 4; c++)
+        {
+            mf_comb_perform(comb[c], in, combOut, vectorSize);
+            for (int i = 0; i < vectorSize; i++)
+                left[i] += combOut[i] * .25f;
+        }
+        memcpy(right, left, sizeof(left));
+
+        mf_allpass_performCascade(allpass, 10, left, vectorSize);
+        mf_allpass_performCascade(allpass + 10, 10, right, vectorSize);
+    }
+
+    double elapsed = mf_bench_now() - start;
+
+    for (int i = 0; i < 4; i++)
+        mf_comb_free(comb[i]);
+    for (int i = 0; i < 20; i++)
+        mf_allpass_free(allpass[i]);
+
+    return elapsed * 1e9 / (blocks * vectorSize);
+}
+
+/**
+ * @brief Runs the early reflections of a room and a single comb filter <br>
+ * @param vectorSize The block size <br>
+ * @param samples The number of samples to process <br>
+ * @param nsComb Returns the time per sample of the comb filter <br>
+ * @param taps Returns the number of taps <br>
+ * @return the time per sample of the early reflections <br>
+ */
+
+static double mf_bench_early(int vectorSize, long samples, double *nsComb, int *taps)
+{
+    mf_early *early = mf_early_new();
+    mf_comb *comb = mf_comb_new();
+    float in[vectorSize], out[vectorSize];
+    long blocks = samples / vectorSize;
+
+    mf_early_setRoom(early, 7, 5, 3, .8f, MF_BENCH_FS);
+    mf_comb_setDelay(comb, floor(.03 * MF_BENCH_FS));
+    mf_comb_setGain(comb, 3, MF_BENCH_FS);
+    mf_comb_clearBuffer(comb);
+    *taps = early->taps;
+
+    srand(3);
+    for (int i = 0; i < vectorSize; i++)
+        in[i] = rand() / (float)RAND_MAX - .5f;
+
+    double start = mf_bench_now();
+    for (long b = 0; b < blocks; b++)
+        mf_early_perform(early, in, out, vectorSize);
+    double middle = mf_bench_now();
+    for (long b = 0; b < blocks; b++)
+        mf_comb_perform(comb, in, out, vectorSize);
+    double end = mf_bench_now();
+
+    *nsComb = (end - middle) * 1e9 / (blocks * vectorSize);
+    mf_early_free(early);
+    mf_comb_free(comb);
+    return (middle - start) * 1e9 / (blocks * vectorSize);
+}
+
+/**
+ * @brief Runs both allpass chains and both velvet-noise decorrelators on the same signal <br>
+ * @param vectorSize The block size <br>
+ * @param samples The number of samples to process <br>
+ * @param nsVelvet Returns the time per sample of the velvet-noise decorrelators <br>
+ * @return the time per sample of the allpass chains <br>
+ */
+
+static double mf_bench_decorrelators(int vectorSize, long samples, double *nsVelvet)
+{
+    mf_allpass *allpass[20];
+    mf_velvet *velvet[2];
+    float in[vectorSize], left[vectorSize], right[vectorSize];
+    long blocks = samples / vectorSize;
+
+    for (int i = 0; i < 20; i++)
+    {
+        allpass[i] = mf_allpass_new();
+        mf_allpass_setDelay(allpass[i], dly_allpass[i]);
+        mf_allpass_clearBuffer(allpass[i]);
+    }
+    for (int c = 0; c < 2; c++)
+    {
+        velvet[c] = mf_velvet_new();
+        mf_velvet_setSequence(velvet[c], MF_REVERB_VELVET_LENGTH, MF_REVERB_VELVET_TAPS, c + 1, MF_BENCH_FS);
+    }
+
+    srand(4);
+    for (int i = 0; i < vectorSize; i++)
+        in[i] = rand() / (float)RAND_MAX - .5f;
+
+    double start = mf_bench_now();
+    for (long b = 0; b < blocks; b++)
+    {
+        memcpy(left, in, sizeof(in));
+        memcpy(right, in, sizeof(in));
+        mf_allpass_performCascade(allpass, 10, left, vectorSize);
+        mf_allpass_performCascade(allpass + 10, 10, right, vectorSize);
+    }
+    double middle = mf_bench_now();
+    for (long b = 0; b < blocks; b++)
+    {
+        mf_velvet_perform(velvet[0], in, left, vectorSize);
+        mf_velvet_perform(velvet[1], in, right, vectorSize);
+    }
+    double end = mf_bench_now();
+
+    for (int i = 0; i < 20; i++)
+        mf_allpass_free(allpass[i]);
+    mf_velvet_free(velvet[0]);
+    mf_velvet_free(velvet[1]);
+
+    *nsVelvet = (end - middle) * 1e9 / (blocks * vectorSize);
+    return (middle - start) * 1e9 / (blocks * vectorSize);
+}
+
+/**
+ * @brief Measures the correlation of the left and right output of the engine <br>
+ * @param velvet True for the velvet-noise decorrelators, false for the allpass chains <br>
+ * @param vectorSize The block size <br>
+ * @param samples The number of samples to process <br>
+ * @return the normalised correlation at lag 0, 1 for identical channels <br>
+ * The noise goes to the send input, so the output holds no dry signal <br>
+ */
+
+static double mf_bench_correlation(bool velvet, int vectorSize, long samples)
+{
+    mf_reverb *x = mf_reverb_new(3, MF_BENCH_FS);
+    float in[vectorSize], send[vectorSize], left[vectorSize], right[vectorSize];
+    double lr = 0, ll = 0, rr = 0;
+
+    mf_reverb_setWet(x, 200);
+    mf_reverb_settle(x);
+    mf_reverb_setVelvet(x, velvet);
+    memset(in, 0, sizeof(in));
+    srand(5);
+
+    long blocks = samples / vectorSize;
+    for (long b = 0; b < blocks; b++)
+    {
+        for (int i = 0; i < vectorSize; i++)
+            send[i] = rand() / (float)RAND_MAX - .5f;
+        mf_reverb_performSend(x, in, send, left, right, vectorSize);
+
+        for (int i = 0; i < vectorSize; i++)
+        {
+            lr += left[i] * right[i];
+            ll += left[i] * left[i];
+            rr += right[i] * right[i];
+        }
+    }
+
+    mf_reverb_free(x);
+    return lr / sqrt(ll * rr + 1e-30);
+}
+
+/**
+ * @brief Runs the float and the fixed-point engine on the same signal <br>
+ * @param vectorSize The block size <br>
+ * @param samples The number of samples to process <br>
+ * @param nsFloat Returns the time per sample of the float engine <br>
+ * @param nsFixed Returns the time per sample of the fixed-point engine <br>
+ * @return the largest deviation of the fixed-point output <br>
+ */
+
+static float mf_bench_fixed(int vectorSize, long samples, double *nsFloat, double *nsFixed)
+{
+    mf_reverb *reference = mf_reverb_new(3, MF_BENCH_FS);
+    mf_reverb *fixed = mf_reverb_new(3, MF_BENCH_FS);
+    float in[vectorSize], l1[vectorSize], r1[vectorSize], l2[vectorSize], r2[vectorSize];
+    float error = 0;
+
+    mf_reverb_setWet(reference, 200);
+    mf_reverb_setWet(fixed, 200);
+    mf_reverb_settle(reference);
+    mf_reverb_settle(fixed);
+    mf_reverb_setFixedPoint(fixed, true);
+    *nsFloat = *nsFixed = 0;
+    srand(2);
+
+    long blocks = samples / vectorSize;
+    for (long b = 0; b < blocks; b++)
+    {
+        /* noise bursts with silence in between, so the tails are compared as well */
+        for (int i = 0; i < vectorSize; i++)
+            in[i] = (b * vectorSize / MF_BENCH_FS) % 2 ? 0 : .1f * (rand() / (float)RAND_MAX - .5f);
+
+        double start = mf_bench_now();
+        mf_reverb_perform(reference, in, l1, r1, vectorSize);
+        double middle = mf_bench_now();
+        mf_reverb_perform(fixed, in, l2, r2, vectorSize);
+        *nsFloat += middle - start;
+        *nsFixed += mf_bench_now() - middle;
+
+        for (int i = 0; i < vectorSize; i++)
+        {
+            if (fabsf(l1[i] - l2[i]) > error) error = fabsf(l1[i] - l2[i]);
+            if (fabsf(r1[i] - r2[i]) > error) error = fabsf(r1[i] - r2[i]);
+        }
+    }
+
+    *nsFloat *= 1e9 / (blocks * vectorSize);
+    *nsFixed *= 1e9 / (blocks * vectorSize);
+    mf_reverb_free(reference);
+    mf_reverb_free(fixed);
+    return error;
+}
+
+/**
+ * @brief Runs the float engine with and without the meter on the same signal <br>
+ * @param vectorSize The block size <br>
+ * @param samples The number of samples to process <br>
+ * @param nsPlain Returns the time per sample without the meter <br>
+ * @param nsMetered Returns the time per sample with the meter <br>
+ * @return true if both engines wrote the same samples <br>
+ */
+
+static bool mf_bench_meter(int vectorSize, long samples, double *nsPlain, double *nsMetered)
+{
+    mf_reverb *plain = mf_reverb_new(3, MF_BENCH_FS);
+    mf_reverb *metered = mf_reverb_new(3, MF_BENCH_FS);
+    float in[vectorSize], l1[vectorSize], r1[vectorSize], l2[vectorSize], r2[vectorSize];
+    float peak[4], rms[4];
+    bool same = true;
+
+    mf_reverb_setWet(plain, 100);
+    mf_reverb_setWet(metered, 100);
+    mf_reverb_settle(plain);
+    mf_reverb_settle(metered);
+    mf_reverb_setMetering(metered, true);
+    *nsPlain = *nsMetered = 0;
+    srand(3);
+
+    long blocks = samples / vectorSize;
+    for (long b = 0; b < blocks; b++)
+    {
+        for (int i = 0; i < vectorSize; i++)
+            in[i] = rand() / (float)RAND_MAX - .5f;
+
+        double start = mf_bench_now();
+        mf_reverb_perform(plain, in, l1, r1, vectorSize);
+        double middle = mf_bench_now();
+        mf_reverb_perform(metered, in, l2, r2, vectorSize);
+        *nsPlain += middle - start;
+        *nsMetered += mf_bench_now() - middle;
+
+        same &= !memcmp(l1, l2, sizeof(l1)) && !memcmp(r1, r2, sizeof(r1));
+        /* read like a meter outlet every 2048 samples, which costs nothing measurable */
+        if ((b + 1) * vectorSize % 2048 < vectorSize)
+            mf_reverb_readMeter(metered, peak, rms);
+    }
+
+    *nsPlain *= 1e9 / (blocks * vectorSize);
+    *nsMetered *= 1e9 / (blocks * vectorSize);
+    mf_reverb_free(plain);
+    mf_reverb_free(metered);
+    return same;
+}
+
+/**
+ * @brief Runs the float engine, then freezes its tail and runs it again <br>
+ * @param vectorSize The block size <br>
+ * @param samples The number of samples to process in either state <br>
+ * @param nsRunning Returns the time per sample before the freeze <br>
+ * @param nsFrozen Returns the time per sample while frozen <br>
+ * @return the level of the last tenth of the frozen output against the first in dB <br>
+ */
+
+static double mf_bench_freeze(int vectorSize, long samples, double *nsRunning, double *nsFrozen)
+{
+    mf_reverb *x = mf_reverb_new(3, MF_BENCH_FS);
+    float in[vectorSize], l[vectorSize], r[vectorSize];
+    double first = 0, last = 0;
+
+    mf_reverb_setWet(x, 200);
+    mf_reverb_settle(x);
+    srand(4);
+
+    long blocks = samples / vectorSize;
+    for (int frozen = 0; frozen < 2; frozen++)
+    {
+        double elapsed = 0;
+        for (long b = 0; b < blocks; b++)
+        {
+            /* the input only reaches the frozen output as the dry signal, which is left out */
+            for (int i = 0; i < vectorSize; i++)
+                in[i] = frozen ? 0 : rand() / (float)RAND_MAX - .5f;
+            double start = mf_bench_now();
+            mf_reverb_perform(x, in, l, r, vectorSize);
+            elapsed += mf_bench_now() - start;
+
+            for (int i = 0; frozen && i < vectorSize; i++)
+            {
+                if (b < blocks / 10)
+                    first += l[i] * l[i];
+                else if (b >= blocks - blocks / 10)
+                    last += l[i] * l[i];
+            }
+        }
+        *(frozen ? nsFrozen : nsRunning) = elapsed * 1e9 / (blocks * vectorSize);
+        mf_reverb_setFreeze(x, true);
+    }
+
+    mf_reverb_free(x);
+    return 10 * log10((last + 1e-30) / (first + 1e-30));
+}
+
+/**
+ * @brief Runs MF_BENCH_ENGINES float and as many half-precision engines on the same signal <br>
+ * @param vectorSize The block size <br>
+ * @param samples The number of samples every engine processes <br>
+ * @param nsFloat Returns the time per sample and engine with float delay lines <br>
+ * @param nsHalf Returns the time per sample and engine with half-precision delay lines <br>
+ * @param bytes Returns the delay-line memory of one float engine in use <br>
+ * @return the difference of the outputs relative to the float output in dB <br>
+ */
+
+static double mf_bench_half(int vectorSize, long samples, double *nsFloat, double *nsHalf, long *bytes)
+{
+    mf_reverb *reference[MF_BENCH_ENGINES], *half[MF_BENCH_ENGINES];
+    float in[vectorSize], l1[vectorSize], r1[vectorSize], l2[vectorSize], r2[vectorSize];
+    double signal = 0, noise = 0;
+
+    for (int e = 0; e < MF_BENCH_ENGINES; e++)
+    {
+        reference[e] = mf_reverb_new(3, MF_BENCH_FS);
+        half[e] = mf_reverb_new(3, MF_BENCH_FS);
+        mf_reverb_setWet(reference[e], 200);
+        mf_reverb_setWet(half[e], 200);
+        mf_reverb_settle(reference[e]);
+        mf_reverb_settle(half[e]);
+        mf_reverb_setHalf(half[e], true);
+    }
+
+    *bytes = 0;
+    for (int i = 0; i < 4; i++)
+        *bytes += reference[0]->comb[i]->delay * sizeof(float);
+    for (int i = 0; i < 2 * MF_REVERB_STAGES; i++)
+        *bytes += reference[0]->allpass[i]->delay * sizeof(float);
+
+    *nsFloat = *nsHalf = 0;
+    srand(5);
+
+    long blocks = samples / vectorSize;
+    for (long b = 0; b < blocks; b++)
+    {
+        for (int i = 0; i < vectorSize; i++)
+            in[i] = (b * vectorSize / MF_BENCH_FS) % 2 ? 0 : .1f * (rand() / (float)RAND_MAX - .5f);
+
+        /* every engine runs once per block, like the objects of a patch */
+        double start = mf_bench_now();
+        for (int e = 0; e < MF_BENCH_ENGINES; e++)
+            mf_reverb_perform(reference[e], in, l1, r1, vectorSize);
+        double middle = mf_bench_now();
+        for (int e = 0; e < MF_BENCH_ENGINES; e++)
+            mf_reverb_perform(half[e], in, l2, r2, vectorSize);
+        *nsFloat += middle - start;
+        *nsHalf += mf_bench_now() - middle;
+
+        for (int i = 0; i < vectorSize; i++)
+        {
+            signal += l1[i] * l1[i] + r1[i] * r1[i];
+            noise += (l1[i] - l2[i]) * (l1[i] - l2[i]) + (r1[i] - r2[i]) * (r1[i] - r2[i]);
+        }
+    }
+
+    *nsFloat *= 1e9 / ((double)blocks * vectorSize * MF_BENCH_ENGINES);
+    *nsHalf *= 1e9 / ((double)blocks * vectorSize * MF_BENCH_ENGINES);
+    for (int e = 0; e < MF_BENCH_ENGINES; e++)
+    {
+        mf_reverb_free(reference[e]);
+        mf_reverb_free(half[e]);
+    }
+    return 10 * log10((noise + 1e-30) / (signal + 1e-30));
+}
+
+int main(int argc, char **argv)
+{
+    int vectorSize = argc > 1 ? atoi(argv[1]) : 64;
+    double seconds = argc > 2 ? atof(argv[2]) : 10;
+    long samples = (long)(seconds * MF_BENCH_FS);
+
+    if (vectorSize < 1)
+    {
+        fprintf(stderr, "usage: mf_bench [blocksize] [seconds]\n");
+        return 1;
+    }
+
+    const char *isas[] = {"scalar", "sse2", "avx2", "avx512"};
+    printf("blocksize %d, %.1f s of audio\n", vectorSize, seconds);
+
+    for (int i = 0; i < 4; i++)
+    {
+        if (mf_kernels_select(isas[i]))
+            continue;
+        printf("static %-5s %8.2f ns/sample\n", isas[i], mf_bench_graph(0, vectorSize, samples));
+    }
+
+    /* the remaining measurements use the kernels picked for this machine or MF_REVERB_ISA */
+    mf_kernels_select(NULL);
+    /* the static and the modulated graph take turns in short rounds and the fastest round of each
+       counts, so load from elsewhere on the machine does not land on one of them alone */
+    double plain = INFINITY, modulated = INFINITY;
+    for (int r = 0; r < MF_BENCH_ROUNDS; r++)
+    {
+        plain = fmin(plain, mf_bench_graph(0, vectorSize, samples / MF_BENCH_ROUNDS));
+        modulated = fmin(modulated, mf_bench_graph(8, vectorSize, samples / MF_BENCH_ROUNDS));
+    }
+    printf("%-12s %8.2f ns/sample (%s)\n", "static", plain, mf_kernels_current.name);
+    printf("%-12s %8.2f ns/sample (%+.1f%%)\n", "modulated", modulated, 100 * (modulated / plain - 1));
+
+    double nsComb;
+    int taps;
+    double nsEarly = mf_bench_early(vectorSize, samples, &nsComb, &taps);
+    printf("%-12s %8.2f ns/sample (%d taps, one comb %.2f ns/sample)\n", "early", nsEarly, taps, nsComb);
+
+    double nsVelvet;
+    double nsAllpass = mf_bench_decorrelators(vectorSize, samples, &nsVelvet);
+    printf("%-12s %8.2f ns/sample (2 x 10 stages, correlation %.3f)\n", "allpass", nsAllpass, mf_bench_correlation(false, vectorSize, samples));
+    printf("%-12s %8.2f ns/sample (2 x %d taps, correlation %.3f)\n", "velvet", nsVelvet, MF_REVERB_VELVET_TAPS, mf_bench_correlation(true, vectorSize, samples));
+
+    double nsFloat, nsFixed;
+    float error = mf_bench_fixed(vectorSize, samples, &nsFloat, &nsFixed);
+    printf("%-12s %8.2f ns/sample\n", "engine", nsFloat);
+    printf("%-12s %8.2f ns/sample, max error %.2e (%.1f dBFS, bound %.1f dBFS)\n", "fixed-point",
+           nsFixed, error, 20 * log10f(error + 1e-30f), 20 * log10f(MF_BENCH_FIXED_BOUND));
+
+    double nsPlain, nsMetered;
+    bool same = mf_bench_meter(vectorSize, samples, &nsPlain, &nsMetered);
+    printf("%-12s %8.2f ns/sample (%+.1f%% against %.2f), %s output\n", "metered",
+           nsMetered, 100 * (nsMetered / nsPlain - 1), nsPlain, same ? "same" : "DIFFERENT");
+
+    double nsRunning, nsFrozen;
+    double drift = mf_bench_freeze(vectorSize, samples, &nsRunning, &nsFrozen);
+    printf("%-12s %8.2f ns/sample (%+.1f%% against %.2f), tail level %+.2f dB after %.1f s\n", "frozen",
+           nsFrozen, 100 * (nsFrozen / nsRunning - 1), nsRunning, drift, seconds);
+
+    double nsHalf;
+    long bytes;
+    double noiseFloor = mf_bench_half(vectorSize, samples / 10, &nsFloat, &nsHalf, &bytes);
+    printf("%-12s %8.2f ns/sample, %d engines, %ld kB of delay lines each\n", "float lines", nsFloat, MF_BENCH_ENGINES, bytes / 1024);
+    printf("%-12s %8.2f ns/sample (%+.1f%%), %ld kB each, noise floor %.1f dB\n", "half lines",
+           nsHalf, 100 * (nsHalf / nsFloat - 1), bytes / 2048, noiseFloor);
+
+    if (modulated > MF_BENCH_MODULATED_BOUND * plain)
+    {
+        fprintf(stderr, "mf_bench: the modulated graph exceeds its bound against the static one\n");
+        return 1;
+    }
+    if (error > MF_BENCH_FIXED_BOUND)
+    {
+        fprintf(stderr, "mf_bench: fixed-point error exceeds the documented bound\n");
+        return 1;
+    }
+    if (fabs(drift) > 1)
+    {
+        fprintf(stderr, "mf_bench: the frozen tail did not hold its level\n");
+        return 1;
+    }
+    if (!same)
+    {
+        fprintf(stderr, "mf_bench: metering changed the output\n");
+        return 1;
+    }
+    return 0;
+}
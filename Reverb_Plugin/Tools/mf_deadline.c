@@ -0,0 +1,223 @@
+/**
+ * @file mf_deadline.c
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Real-time deadline simulation <br>
+ * <br>
+ * @brief Drives the engine from a simulated periodic audio callback <br>
+ * <br>
+ * mf_deadline wakes up once per block period, like the audio callback of a <br>
+ * sound card, and runs all instances of the engine for one block. It records <br>
+ * the time of every callback and counts the callbacks that take longer than <br>
+ * the period, which would be dropouts. The input alternates between noise <br>
+ * bursts and silence, so the decaying tails run into denormal numbers unless <br>
+ * -ftz is given. -params changes parameters every quarter second in the <br>
+ * callback, -noise starts a thread that keeps evicting the caches. The <br>
+ * callback is marked for mf_rtcheck, parameter changes included. <br>
+ * Usage: mf_deadline [-b blocksize] [-n instances] [-s seconds] [-fs rate] <br>
+ * [-noise] [-params] [-ftz] [-rt] <br>
+ * <br>
+ */
+
+#include "mf_kernels.h"
+#include "mf_reverb.h"
+#include "mf_rtcheck.h"
+#include <pthread.h>
+#include <sched.h>
+#include <string.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#endif
+
+#define MF_DEADLINE_NOISE (64 << 20) /**< bytes touched by the noise thread, more than any last level cache */
+
+static volatile int mf_deadline_running = 1;
+
+static double mf_deadline_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void mf_deadline_sleepUntil(double time)
+{
+    struct timespec t;
+    t.tv_sec = (time_t)time;
+    t.tv_nsec = (long)((time - t.tv_sec) * 1e9);
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &t, NULL))
+        ;
+}
+
+/* writes one byte per cache line of a buffer larger than the caches */
+static void *mf_deadline_noise(void *arg)
+{
+    (void)arg;
+    volatile char *memory = (volatile char *)malloc(MF_DEADLINE_NOISE);
+
+    while (mf_deadline_running)
+    {
+        for (long i = 0; i < MF_DEADLINE_NOISE; i += 64)
+            memory[i]++;
+    }
+
+    free((void *)memory);
+    return NULL;
+}
+
+static int mf_deadline_compare(const void *a, const void *b)
+{
+    double da = *(const double *)a;
+    double db = *(const double *)b;
+    return (da > db) - (da < db);
+}
+
+/* the parameter change of the current quarter second, run inside the callback like a Pd message */
+static void mf_deadline_change(mf_reverb *x, long step)
+{
+    switch (step % 4)
+    {
+        case 0:
+            mf_reverb_setWet(x, step % 8 ? 100 : 60);
+            break;
+        case 1:
+            mf_reverb_setModulation(x, step % 8 == 1 ? 2 : 0, .7f);
+            break;
+        case 2:
+            mf_reverb_setRoom(x, 6 + step % 5, 4, 3, .7f);
+            break;
+        case 3:
+            mf_reverb_configure(x, step % 8 == 3 ? 2 : 3, x->fs);
+            break;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    int vectorSize = 64;
+    int instances = 1;
+    double seconds = 10;
+    float fs = 48000;
+    int noise = 0, params = 0, ftz = 0, rt = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-b") && i + 1 < argc)
+            vectorSize = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            instances = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-fs") && i + 1 < argc)
+            fs = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-noise"))
+            noise = 1;
+        else if (!strcmp(argv[i], "-params"))
+            params = 1;
+        else if (!strcmp(argv[i], "-ftz"))
+            ftz = 1;
+        else if (!strcmp(argv[i], "-rt"))
+            rt = 1;
+        else
+            vectorSize = 0;
+    }
+
+    if (vectorSize < 1 || instances < 1 || seconds <= 0 || fs <= 0)
+    {
+        fprintf(stderr, "usage: mf_deadline [-b blocksize] [-n instances] [-s seconds] [-fs rate] [-noise] [-params] [-ftz] [-rt]\n");
+        return 1;
+    }
+
+    if (mf_kernels_select(NULL))
+        fprintf(stderr, "mf_deadline: MF_REVERB_ISA=%s is not supported, using %s\n", getenv("MF_REVERB_ISA"), mf_kernels_current.name);
+
+#if defined(__x86_64__) || defined(__i386__)
+    /* flush to zero and denormals are zero, as most audio hosts set them */
+    if (ftz)
+        _mm_setcsr(_mm_getcsr() | 0x8040);
+#endif
+
+    if (rt)
+    {
+        struct sched_param sp = {sched_get_priority_max(SCHED_FIFO)};
+        if (pthread_setschedparam(pthread_self(), SCHED_FIFO, &sp))
+            fprintf(stderr, "mf_deadline: no real-time priority, running with normal priority\n");
+    }
+
+    mf_reverb *reverb[instances];
+    for (int r = 0; r < instances; r++)
+    {
+        reverb[r] = mf_reverb_new(3, fs);
+        mf_reverb_setWet(reverb[r], 100);
+        mf_reverb_settle(reverb[r]);
+    }
+
+    pthread_t noiseThread;
+    if (noise)
+        pthread_create(&noiseThread, NULL, mf_deadline_noise, NULL);
+
+    double period = vectorSize / fs;
+    long blocks = (long)(seconds / period);
+    long blocksPerChange = (long)(.25 / period) + 1;
+    double *times = (double *)malloc(blocks * sizeof(double));
+    float in[vectorSize], outl[vectorSize], outr[vectorSize];
+    long misses = 0, late = 0;
+    srand(1);
+
+    double deadline = mf_deadline_now() + period;
+    for (long b = 0; b < blocks; b++)
+    {
+        /* half a second of noise, one and a half seconds of silence */
+        int burst = (long)(b * period * 2) % 4 == 0;
+        for (int i = 0; i < vectorSize; i++)
+            in[i] = burst ? .5f * (rand() / (float)RAND_MAX - .5f) : 0;
+
+        double start = mf_deadline_now();
+        MF_RTCHECK_ENTER();
+
+        if (params && b % blocksPerChange == 0)
+            for (int r = 0; r < instances; r++)
+                mf_deadline_change(reverb[r], b / blocksPerChange + r);
+
+        for (int r = 0; r < instances; r++)
+            mf_reverb_perform(reverb[r], in, outl, outr, vectorSize);
+
+        MF_RTCHECK_LEAVE();
+        double end = mf_deadline_now();
+        times[b] = end - start;
+        if (times[b] > period)
+            misses++;
+
+        /* a callback that was woken up late still has to finish within its own period */
+        if (end > deadline + period)
+        {
+            late++;
+            deadline = end;
+        }
+        mf_deadline_sleepUntil(deadline);
+        deadline += period;
+    }
+
+    mf_deadline_running = 0;
+    if (noise)
+        pthread_join(noiseThread, NULL);
+
+    double first = times[0];
+    qsort(times, blocks, sizeof(double), mf_deadline_compare);
+
+    printf("blocksize %d, %d instances, %.0f Hz, %.1f s, %s kernels%s%s%s\n", vectorSize, instances, fs, seconds,
+           mf_kernels_current.name, noise ? ", cache noise" : "", params ? ", parameter changes" : "", ftz ? ", ftz" : "");
+    printf("deadline %8.1f us\n", period * 1e6);
+    printf("first    %8.1f us\n", first * 1e6);
+    printf("p50      %8.1f us\n", times[blocks / 2] * 1e6);
+    printf("p99      %8.1f us\n", times[(long)(blocks * .99)] * 1e6);
+    printf("p99.9    %8.1f us\n", times[(long)(blocks * .999)] * 1e6);
+    printf("max      %8.1f us (%.0f%% of the deadline)\n", times[blocks - 1] * 1e6, 100 * times[blocks - 1] / period);
+    printf("misses   %8ld of %ld callbacks, %ld late wake-ups\n", misses, blocks, late);
+
+    for (int r = 0; r < instances; r++)
+        mf_reverb_free(reverb[r]);
+    free(times);
+    return misses ? 2 : 0;
+}
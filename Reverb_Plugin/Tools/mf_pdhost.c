@@ -0,0 +1,714 @@
+#include "mf_pdhost.h"
+#include "mf_rtcheck.h"
+#include <dlfcn.h>
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define MF_PDHOST_ARGS 6    /**< typed arguments of a method, as in Pd */
+#define MF_PDHOST_SIGNALS 8 /**< signal inlets and outlets of an object */
+#define MF_PDHOST_MESSAGES 4 /**< message outlets of an object */
+
+/* Pd passes up to 6 pointer-size and 5 float arguments in separate registers */
+typedef void *(*mf_pdhost_typed)(t_int, t_int, t_int, t_int, t_int, t_int,
+    t_floatarg, t_floatarg, t_floatarg, t_floatarg, t_floatarg);
+typedef void *(*mf_pdhost_gimme)(void *, t_symbol *, int, t_atom *);
+typedef void *(*mf_pdhost_newgimme)(t_symbol *, int, t_atom *);
+typedef void (*mf_pdhost_dspmethod)(void *, t_signal **);
+
+typedef struct mf_pdhost_method
+{
+    t_symbol *selector;
+    t_method fn;
+    t_atomtype args[MF_PDHOST_ARGS];
+    int count;
+} mf_pdhost_method;
+
+struct _class
+{
+    t_symbol *c_name;
+    t_newmethod c_new;
+    t_method c_free;
+    size_t c_size;
+    int c_flags;
+    mf_pdhost_method c_creator;
+    mf_pdhost_method *c_methods;
+    int c_nmethods;
+    t_method c_bang;
+    int c_signalOnset;  /**< offset of the float of the main signal inlet, -1 without one */
+    struct _class *c_next;
+};
+
+struct _outlet
+{
+    t_object *o_owner;
+    int o_signal;
+    int o_sent;  /**< messages sent, the last one is kept */
+    int o_argc;
+    t_atom o_argv[MF_PDHOST_LIST];
+};
+
+struct _inlet
+{
+    t_object *i_owner;
+};
+
+struct _clock
+{
+    void *c_owner;
+    t_method c_fn;
+    double c_time;  /**< logical time in ms when the clock fires */
+    int c_set;
+    struct _clock *c_next;
+};
+
+struct _garray
+{
+    t_pd g_pd;
+    int g_n;
+    t_word *g_vec;
+};
+
+/* the host side of an object: its signal inlets and outlets */
+typedef struct mf_pdhost_object
+{
+    t_pd *x;
+    int inlets;
+    t_float inletValue[MF_PDHOST_SIGNALS];
+    int outlets;
+    t_signal signals[2 * MF_PDHOST_SIGNALS];
+    int messageOutlets;
+    t_outlet *messages[MF_PDHOST_MESSAGES];
+    struct mf_pdhost_object *next;
+} mf_pdhost_object;
+
+typedef struct mf_pdhost_binding
+{
+    t_symbol *name;
+    t_pd *x;
+    struct mf_pdhost_binding *next;
+} mf_pdhost_binding;
+
+t_symbol s_pointer = {"pointer", 0, 0};
+t_symbol s_float = {"float", 0, 0};
+t_symbol s_symbol = {"symbol", 0, 0};
+t_symbol s_bang = {"bang", 0, 0};
+t_symbol s_list = {"list", 0, 0};
+t_symbol s_anything = {"anything", 0, 0};
+t_symbol s_signal = {"signal", 0, 0};
+t_symbol s__N = {"#N", 0, 0};
+t_symbol s__X = {"#X", 0, 0};
+t_symbol s_x = {"x", 0, 0};
+t_symbol s_y = {"y", 0, 0};
+t_symbol s_ = {"", 0, 0};
+
+t_class *garray_class;
+
+static t_symbol *mf_pdhost_symbols;
+static t_class *mf_pdhost_classes;
+static mf_pdhost_object *mf_pdhost_objects;
+static mf_pdhost_binding *mf_pdhost_bindings;
+static t_float mf_pdhost_sr = 44100;
+static int mf_pdhost_errorCount;
+static int mf_pdhost_postCount;
+static t_clock *mf_pdhost_clocks;
+static double mf_pdhost_time;
+static int mf_pdhost_vectorSize;
+static t_int *mf_pdhost_chain;
+static int mf_pdhost_chainSize;
+static int mf_pdhost_chainCapacity;
+
+t_symbol *gensym(const char *s)
+{
+    static t_symbol *predefined[] = {&s_pointer, &s_float, &s_symbol, &s_bang, &s_list,
+        &s_anything, &s_signal, &s__N, &s__X, &s_x, &s_y, &s_};
+
+    if (!mf_pdhost_symbols)
+    {
+        for (int i = 0; i < (int)(sizeof(predefined) / sizeof(predefined[0])); i++)
+        {
+            predefined[i]->s_next = mf_pdhost_symbols;
+            mf_pdhost_symbols = predefined[i];
+        }
+    }
+
+    for (t_symbol *sym = mf_pdhost_symbols; sym; sym = sym->s_next)
+    {
+        if (!strcmp(sym->s_name, s))
+            return sym;
+    }
+
+    t_symbol *sym = (t_symbol *)calloc(1, sizeof(t_symbol));
+    sym->s_name = strdup(s);
+    sym->s_next = mf_pdhost_symbols;
+    mf_pdhost_symbols = sym;
+    return sym;
+}
+
+void *getbytes(size_t nbytes)
+{
+    return calloc(1, nbytes ? nbytes : 1);
+}
+
+void *resizebytes(void *x, size_t oldsize, size_t newsize)
+{
+    char *y = (char *)realloc(x, newsize ? newsize : 1);
+    if (newsize > oldsize)
+        memset(y + oldsize, 0, newsize - oldsize);
+    return y;
+}
+
+void freebytes(void *x, size_t nbytes)
+{
+    (void)nbytes;
+    free(x);
+}
+
+void post(const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    mf_pdhost_postCount++;
+}
+
+void pd_error(void *object, const char *fmt, ...)
+{
+    (void)object;
+    va_list ap;
+    va_start(ap, fmt);
+    fputs("error: ", stderr);
+    vfprintf(stderr, fmt, ap);
+    va_end(ap);
+    fputc('\n', stderr);
+    mf_pdhost_errorCount++;
+}
+
+t_float sys_getsr(void)
+{
+    return mf_pdhost_sr;
+}
+
+int sys_getblksize(void)
+{
+    return 64;
+}
+
+t_float atom_getfloatarg(int which, int argc, t_atom *argv)
+{
+    return which < argc && argv[which].a_type == A_FLOAT ? argv[which].a_w.w_float : 0;
+}
+
+t_symbol *atom_getsymbolarg(int which, int argc, t_atom *argv)
+{
+    return which < argc && argv[which].a_type == A_SYMBOL ? argv[which].a_w.w_symbol : &s_;
+}
+
+/* reads the zero terminated argument types of class_new and class_addmethod */
+static void mf_pdhost_args(mf_pdhost_method *m, t_atomtype arg1, va_list ap)
+{
+    m->count = 0;
+    for (t_atomtype type = arg1; type != A_NULL && m->count < MF_PDHOST_ARGS; type = (t_atomtype)va_arg(ap, int))
+    {
+        m->args[m->count++] = type;
+    }
+}
+
+t_class *class_new(t_symbol *name, t_newmethod newmethod, t_method freemethod, size_t size, int flags, t_atomtype arg1, ...)
+{
+    t_class *c = (t_class *)calloc(1, sizeof(t_class));
+    va_list ap;
+
+    c->c_name = name;
+    c->c_new = newmethod;
+    c->c_free = freemethod;
+    c->c_size = size;
+    c->c_flags = flags;
+    c->c_signalOnset = -1;
+    c->c_creator.selector = name;
+    c->c_creator.fn = (t_method)newmethod;
+
+    va_start(ap, arg1);
+    mf_pdhost_args(&c->c_creator, arg1, ap);
+    va_end(ap);
+
+    c->c_next = mf_pdhost_classes;
+    mf_pdhost_classes = c;
+    return c;
+}
+
+void class_addmethod(t_class *c, t_method fn, t_symbol *sel, t_atomtype arg1, ...)
+{
+    va_list ap;
+
+    c->c_methods = (mf_pdhost_method *)realloc(c->c_methods, (c->c_nmethods + 1) * sizeof(mf_pdhost_method));
+    mf_pdhost_method *m = &c->c_methods[c->c_nmethods++];
+    m->selector = sel;
+    m->fn = fn;
+
+    va_start(ap, arg1);
+    mf_pdhost_args(m, arg1, ap);
+    va_end(ap);
+}
+
+#undef class_addbang
+void class_addbang(t_class *c, t_method fn)
+{
+    c->c_bang = fn;
+}
+
+void class_domainsignalin(t_class *c, int onset)
+{
+    c->c_signalOnset = onset;
+}
+
+static mf_pdhost_object *mf_pdhost_find(const void *x)
+{
+    for (mf_pdhost_object *o = mf_pdhost_objects; o; o = o->next)
+    {
+        if (o->x == (const t_pd *)x)
+            return o;
+    }
+    return NULL;
+}
+
+t_pd *pd_new(t_class *c)
+{
+    t_pd *x = (t_pd *)calloc(1, c->c_size);
+    mf_pdhost_object *o = (mf_pdhost_object *)calloc(1, sizeof(mf_pdhost_object));
+    mf_pdhost_object **last = &mf_pdhost_objects;
+
+    *x = c;
+    o->x = x;
+    if (c->c_signalOnset >= 0)
+        o->inlets = 1;
+
+    /* appended, so the DSP chain follows the order of creation */
+    while (*last)
+        last = &(*last)->next;
+    *last = o;
+    return x;
+}
+
+void pd_free(t_pd *x)
+{
+    t_class *c = *x;
+    mf_pdhost_object **o = &mf_pdhost_objects;
+
+    if (c->c_free)
+        ((void (*)(void *))c->c_free)(x);
+
+    while (*o && (*o)->x != x)
+        o = &(*o)->next;
+    if (*o)
+    {
+        mf_pdhost_object *dead = *o;
+        *o = dead->next;
+        for (int i = 0; i < dead->inlets + dead->outlets; i++)
+            free(dead->signals[i].s_vec);
+        free(dead);
+    }
+    free(x);
+}
+
+t_outlet *outlet_new(t_object *owner, t_symbol *s)
+{
+    t_outlet *outlet = (t_outlet *)calloc(1, sizeof(t_outlet));
+    mf_pdhost_object *o = mf_pdhost_find(owner);
+
+    outlet->o_owner = owner;
+    outlet->o_signal = s == &s_signal;
+    if (o && outlet->o_signal && o->outlets < MF_PDHOST_SIGNALS)
+        o->outlets++;
+    else if (o && !outlet->o_signal && o->messageOutlets < MF_PDHOST_MESSAGES)
+        o->messages[o->messageOutlets++] = outlet;
+    return outlet;
+}
+
+void outlet_free(t_outlet *x)
+{
+    mf_pdhost_object *o = mf_pdhost_find(x->o_owner);
+    for (int i = 0; o && i < o->messageOutlets; i++)
+    {
+        if (o->messages[i] == x)
+            o->messages[i] = NULL;
+    }
+    free(x);
+}
+
+/* nothing is connected, the outlet keeps the last message for mf_pdhost_messages */
+void outlet_list(t_outlet *x, t_symbol *s, int argc, t_atom *argv)
+{
+    (void)s;
+    x->o_argc = argc < MF_PDHOST_LIST ? argc : MF_PDHOST_LIST;
+    memcpy(x->o_argv, argv, x->o_argc * sizeof(t_atom));
+    x->o_sent++;
+}
+
+void outlet_float(t_outlet *x, t_float f)
+{
+    t_atom a;
+    SETFLOAT(&a, f);
+    outlet_list(x, &s_list, 1, &a);
+}
+
+t_inlet *signalinlet_new(t_object *owner, t_float f)
+{
+    t_inlet *inlet = (t_inlet *)calloc(1, sizeof(t_inlet));
+    mf_pdhost_object *o = mf_pdhost_find(owner);
+
+    inlet->i_owner = owner;
+    if (o && o->inlets < MF_PDHOST_SIGNALS)
+        o->inletValue[o->inlets++] = f;
+    return inlet;
+}
+
+void pd_bind(t_pd *x, t_symbol *s)
+{
+    mf_pdhost_binding *b = (mf_pdhost_binding *)malloc(sizeof(mf_pdhost_binding));
+    b->name = s;
+    b->x = x;
+    b->next = mf_pdhost_bindings;
+    mf_pdhost_bindings = b;
+}
+
+void pd_unbind(t_pd *x, t_symbol *s)
+{
+    for (mf_pdhost_binding **b = &mf_pdhost_bindings; *b; b = &(*b)->next)
+    {
+        if ((*b)->name == s && (*b)->x == x)
+        {
+            mf_pdhost_binding *dead = *b;
+            *b = dead->next;
+            free(dead);
+            return;
+        }
+    }
+}
+
+t_pd *pd_findbyclass(t_symbol *s, t_class *c)
+{
+    for (mf_pdhost_binding *b = mf_pdhost_bindings; b; b = b->next)
+    {
+        if (b->name == s && *b->x == c)
+            return b->x;
+    }
+    return NULL;
+}
+
+int garray_getfloatwords(t_garray *x, int *size, t_word **vec)
+{
+    *size = x->g_n;
+    *vec = x->g_vec;
+    return 1;
+}
+
+void mf_pdhost_array(const char *name, const t_float *values, int count)
+{
+    if (!garray_class)
+        garray_class = class_new(gensym("array"), 0, 0, sizeof(t_garray), CLASS_PD, A_NULL);
+
+    t_garray *x = (t_garray *)pd_new(garray_class);
+    x->g_n = count;
+    x->g_vec = (t_word *)calloc(count ? count : 1, sizeof(t_word));
+    for (int i = 0; i < count; i++)
+        x->g_vec[i].w_float = values[i];
+    pd_bind(&x->g_pd, gensym(name));
+}
+
+void dsp_add(t_perfroutine f, int n, ...)
+{
+    va_list ap;
+
+    if (mf_pdhost_chainSize + n + 2 > mf_pdhost_chainCapacity)
+    {
+        mf_pdhost_chainCapacity = 2 * (mf_pdhost_chainSize + n + 2);
+        mf_pdhost_chain = (t_int *)realloc(mf_pdhost_chain, mf_pdhost_chainCapacity * sizeof(t_int));
+    }
+
+    mf_pdhost_chain[mf_pdhost_chainSize++] = (t_int)f;
+    va_start(ap, n);
+    for (int i = 0; i < n; i++)
+        mf_pdhost_chain[mf_pdhost_chainSize++] = va_arg(ap, t_int);
+    va_end(ap);
+}
+
+t_clock *clock_new(void *owner, t_method fn)
+{
+    t_clock *x = (t_clock *)calloc(1, sizeof(t_clock));
+    x->c_owner = owner;
+    x->c_fn = fn;
+    x->c_next = mf_pdhost_clocks;
+    mf_pdhost_clocks = x;
+    return x;
+}
+
+void clock_delay(t_clock *x, double delaytime)
+{
+    x->c_time = mf_pdhost_time + delaytime;
+    x->c_set = 1;
+}
+
+void clock_unset(t_clock *x)
+{
+    x->c_set = 0;
+}
+
+void clock_free(t_clock *x)
+{
+    for (t_clock **c = &mf_pdhost_clocks; *c; c = &(*c)->c_next)
+    {
+        if (*c == x)
+        {
+            *c = x->c_next;
+            break;
+        }
+    }
+    free(x);
+}
+
+/* a callback may set, add or free clocks, so the search starts over after each one */
+static void mf_pdhost_clocksDue(void)
+{
+    for (t_clock *c = mf_pdhost_clocks; c; )
+    {
+        if (c->c_set && c->c_time <= mf_pdhost_time)
+        {
+            c->c_set = 0;
+            ((void (*)(void *))c->c_fn)(c->c_owner);
+            c = mf_pdhost_clocks;
+        }
+        else
+            c = c->c_next;
+    }
+}
+
+static t_int *mf_pdhost_done(t_int *w)
+{
+    (void)w;
+    return NULL;
+}
+
+void canvas_update_dsp(void)
+{
+    if (mf_pdhost_vectorSize)
+        mf_pdhost_dsp(mf_pdhost_vectorSize);
+}
+
+/* calls a method or creator with the argument convention of Pd */
+static int mf_pdhost_call(const mf_pdhost_method *m, void *x, int argc, t_atom *argv, void **result)
+{
+    t_int ints[MF_PDHOST_ARGS] = {0};
+    t_floatarg floats[5] = {0};
+    int ni = 0, nf = 0;
+
+    if (m->count == 1 && m->args[0] == A_GIMME)
+    {
+        if (x)
+            *result = ((mf_pdhost_gimme)m->fn)(x, m->selector, argc, argv);
+        else
+            *result = ((mf_pdhost_newgimme)m->fn)(m->selector, argc, argv);
+        return 0;
+    }
+
+    if (x)
+        ints[ni++] = (t_int)x;
+
+    for (int i = 0; i < m->count; i++)
+    {
+        int given = i < argc;
+        switch (m->args[i])
+        {
+            case A_FLOAT:
+            case A_DEFFLOAT:
+                if (given && argv[i].a_type != A_FLOAT)
+                    return -1;
+                if (!given && m->args[i] == A_FLOAT)
+                    return -1;
+                if (nf < 5)
+                    floats[nf++] = given ? argv[i].a_w.w_float : 0;
+                break;
+            case A_SYMBOL:
+            case A_DEFSYM:
+                if (given && argv[i].a_type != A_SYMBOL)
+                    return -1;
+                if (!given && m->args[i] == A_SYMBOL)
+                    return -1;
+                if (ni < MF_PDHOST_ARGS)
+                    ints[ni++] = (t_int)(given ? argv[i].a_w.w_symbol : &s_);
+                break;
+            default:
+                return -1;
+        }
+    }
+
+    *result = ((mf_pdhost_typed)m->fn)(ints[0], ints[1], ints[2], ints[3], ints[4], ints[5],
+        floats[0], floats[1], floats[2], floats[3], floats[4]);
+    return 0;
+}
+
+int mf_pdhost_load(const char *path, const char *setup)
+{
+    void *handle = dlopen(path, RTLD_NOW | RTLD_GLOBAL);
+    if (!handle)
+    {
+        fprintf(stderr, "mf_pdhost: %s\n", dlerror());
+        return -1;
+    }
+
+    void (*fn)(void) = (void (*)(void))dlsym(handle, setup);
+    if (!fn)
+    {
+        fprintf(stderr, "mf_pdhost: %s has no %s\n", path, setup);
+        return -1;
+    }
+
+    fn();
+    return 0;
+}
+
+void mf_pdhost_setSampleRate(t_float sr)
+{
+    mf_pdhost_sr = sr;
+}
+
+t_pd *mf_pdhost_new(const char *name, int argc, t_atom *argv)
+{
+    t_symbol *s = gensym(name);
+    void *x = NULL;
+
+    for (t_class *c = mf_pdhost_classes; c; c = c->c_next)
+    {
+        if (c->c_name == s && c->c_new)
+        {
+            if (mf_pdhost_call(&c->c_creator, NULL, argc, argv, &x))
+                fprintf(stderr, "mf_pdhost: bad arguments for %s\n", name);
+            return (t_pd *)x;
+        }
+    }
+
+    fprintf(stderr, "mf_pdhost: %s ... couldn't create\n", name);
+    return NULL;
+}
+
+void mf_pdhost_free(t_pd *x)
+{
+    pd_free(x);
+    canvas_update_dsp();
+}
+
+int mf_pdhost_send(t_pd *x, const char *selector, int argc, t_atom *argv)
+{
+    t_class *c = *x;
+    t_symbol *s = gensym(selector);
+    void *result;
+
+    if (s == &s_bang && c->c_bang)
+    {
+        ((void (*)(void *))c->c_bang)(x);
+        return 0;
+    }
+
+    for (int i = 0; i < c->c_nmethods; i++)
+    {
+        if (c->c_methods[i].selector == s)
+            return mf_pdhost_call(&c->c_methods[i], x, argc, argv, &result);
+    }
+
+    pd_error(x, "%s: no method for '%s'", c->c_name->s_name, selector);
+    return -1;
+}
+
+void mf_pdhost_dsp(int vectorSize)
+{
+    mf_pdhost_vectorSize = vectorSize;
+    mf_pdhost_chainSize = 0;
+
+    for (mf_pdhost_object *o = mf_pdhost_objects; o; o = o->next)
+    {
+        t_class *c = *o->x;
+        t_method fn = NULL;
+        t_signal *sp[2 * MF_PDHOST_SIGNALS];
+
+        for (int i = 0; i < c->c_nmethods; i++)
+        {
+            if (c->c_methods[i].selector == gensym("dsp"))
+                fn = c->c_methods[i].fn;
+        }
+        if (!fn || o->inlets + o->outlets == 0)
+            continue;
+
+        /* the main inlet starts with the float of the object, the others with their creation value */
+        if (c->c_signalOnset >= 0)
+            o->inletValue[0] = *(t_float *)((char *)o->x + c->c_signalOnset);
+
+        for (int i = 0; i < o->inlets + o->outlets; i++)
+        {
+            t_signal *signal = &o->signals[i];
+            free(signal->s_vec);
+            signal->s_vec = (t_sample *)calloc(vectorSize, sizeof(t_sample));
+            signal->s_n = vectorSize;
+            signal->s_vecsize = vectorSize;
+            signal->s_sr = mf_pdhost_sr;
+            for (int k = 0; i < o->inlets && k < vectorSize; k++)
+                signal->s_vec[k] = o->inletValue[i];
+            sp[i] = signal;
+        }
+
+        ((mf_pdhost_dspmethod)fn)(o->x, sp);
+    }
+
+    dsp_add(mf_pdhost_done, 0);
+}
+
+void mf_pdhost_tick(void)
+{
+    MF_RTCHECK_ENTER();
+    for (t_int *w = mf_pdhost_chain; w; )
+        w = (*(t_perfroutine)(*w))(w);
+    MF_RTCHECK_LEAVE();
+
+    /* like the scheduler of Pd, the clocks run between two blocks */
+    mf_pdhost_time += 1000. * mf_pdhost_vectorSize / mf_pdhost_sr;
+    mf_pdhost_clocksDue();
+}
+
+t_sample *mf_pdhost_inlet(t_pd *x, int index)
+{
+    mf_pdhost_object *o = mf_pdhost_find(x);
+    return o && index >= 0 && index < o->inlets ? o->signals[index].s_vec : NULL;
+}
+
+t_sample *mf_pdhost_outlet(t_pd *x, int index)
+{
+    mf_pdhost_object *o = mf_pdhost_find(x);
+    return o && index >= 0 && index < o->outlets ? o->signals[o->inlets + index].s_vec : NULL;
+}
+
+int mf_pdhost_messages(t_pd *x, int index, t_atom *argv, int *argc)
+{
+    mf_pdhost_object *o = mf_pdhost_find(x);
+    t_outlet *outlet = o && index >= 0 && index < o->messageOutlets ? o->messages[index] : NULL;
+
+    if (!outlet)
+        return -1;
+    if (argv && argc)
+    {
+        *argc = outlet->o_argc;
+        memcpy(argv, outlet->o_argv, outlet->o_argc * sizeof(t_atom));
+    }
+    return outlet->o_sent;
+}
+
+int mf_pdhost_errors(void)
+{
+    return mf_pdhost_errorCount;
+}
+
+int mf_pdhost_posts(void)
+{
+    return mf_pdhost_postCount;
+}
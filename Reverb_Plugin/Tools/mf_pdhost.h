@@ -0,0 +1,141 @@
+/**
+ * @file mf_pdhost.h
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Minimal Pd runtime <br>
+ * <br>
+ * @brief Loads the built external and drives it like Pd, without installing Pd <br>
+ * <br>
+ * mf_pdhost implements the part of m_pd.h that mf_reverb~ uses: symbols, <br>
+ * classes with their methods, objects with signal inlets and outlets, message <br>
+ * outlets that keep their last list, named <br>
+ * bindings, arrays, clocks, dsp_add and the console. A program linked with it and <br>
+ * with -rdynamic exports these functions, so an external loaded with dlopen <br>
+ * resolves them here instead of in Pd. Methods are called with the same <br>
+ * argument convention as Pd, so the real setup, new, dsp, perform and message <br>
+ * functions of the external run unchanged. There is one DSP chain for all <br>
+ * objects and no patch: the caller fills the inlet vectors and reads the <br>
+ * outlet vectors around every mf_pdhost_tick, which is marked as the audio <br>
+ * callback for mf_rtcheck. <br>
+ * <br>
+ */
+
+#ifndef mf_pdhost_h
+#define mf_pdhost_h
+#include "m_pd.h"
+
+#define MF_PDHOST_LIST 16 /**< atoms of a message outlet kept by mf_pdhost_messages */
+
+/**
+ * @brief Opens an external and calls its setup function<br>
+ * @param path The path of the compiled external <br>
+ * @param setup The name of the setup function, e.g. mf_reverb_tilde_setup <br>
+ * @return 0 on success, -1 if the file or the function can not be loaded <br>
+ */
+
+int mf_pdhost_load(const char *path, const char *setup);
+
+/**
+ * @brief Sets the sample rate returned by sys_getsr <br>
+ * @param sr The sample rate, 44100 by default <br>
+ * Objects read the sample rate when they are created, so set it first <br>
+ */
+
+void mf_pdhost_setSampleRate(t_float sr);
+
+/**
+ * @brief Creates an object like an object box in a patch<br>
+ * @param name The name of the class <br>
+ * @param argc The number of creation arguments <br>
+ * @param argv The creation arguments <br>
+ * @return the new object, or NULL if the class is unknown or its creator fails <br>
+ */
+
+t_pd *mf_pdhost_new(const char *name, int argc, t_atom *argv);
+
+/**
+ * @brief Frees an object and removes it from the DSP chain<br>
+ * @param x The object <br>
+ */
+
+void mf_pdhost_free(t_pd *x);
+
+/**
+ * @brief Sends a message to an object<br>
+ * @param x The object <br>
+ * @param selector The selector, bang for the bang method <br>
+ * @param argc The number of arguments <br>
+ * @param argv The arguments <br>
+ * @return 0 on success, -1 if the object has no such method or an argument is missing <br>
+ */
+
+int mf_pdhost_send(t_pd *x, const char *selector, int argc, t_atom *argv);
+
+/**
+ * @brief Creates a Pd array that objects find by its name<br>
+ * @param name The name of the array <br>
+ * @param values The values <br>
+ * @param count The number of values <br>
+ */
+
+void mf_pdhost_array(const char *name, const t_float *values, int count);
+
+/**
+ * @brief Builds the DSP chain of all objects in the order of their creation<br>
+ * @param vectorSize The block size <br>
+ * The dsp method of every object with signal inlets or outlets is called with <br>
+ * its own vectors. Unconnected inputs start with the value of their inlet. <br>
+ * canvas_update_dsp builds the chain again with the same block size. <br>
+ */
+
+void mf_pdhost_dsp(int vectorSize);
+
+/**
+ * @brief Runs the DSP chain for one block, then the clocks that are due<br>
+ * The logical time of the clocks advances by one block period per tick <br>
+ */
+
+void mf_pdhost_tick(void);
+
+/**
+ * @brief Returns the vector of a signal inlet<br>
+ * @param x The object <br>
+ * @param index The index of the signal inlet, 0 for the main inlet <br>
+ * @return the vector, or NULL before mf_pdhost_dsp or for a wrong index <br>
+ */
+
+t_sample *mf_pdhost_inlet(t_pd *x, int index);
+
+/**
+ * @brief Returns the vector of a signal outlet<br>
+ * @param x The object <br>
+ * @param index The index of the signal outlet <br>
+ * @return the vector, or NULL before mf_pdhost_dsp or for a wrong index <br>
+ */
+
+t_sample *mf_pdhost_outlet(t_pd *x, int index);
+
+/**
+ * @brief Returns the last list sent through a message outlet<br>
+ * @param x The object <br>
+ * @param index The index of the message outlet, counted without the signal outlets <br>
+ * @param argv Receives up to MF_PDHOST_LIST atoms of the last list, may be NULL <br>
+ * @param argc Receives the number of atoms <br>
+ * @return the number of messages sent so far, or -1 for a wrong index <br>
+ */
+
+int mf_pdhost_messages(t_pd *x, int index, t_atom *argv, int *argc);
+
+/**
+ * @brief Returns the number of errors posted with pd_error<br>
+ */
+
+int mf_pdhost_errors(void);
+
+/**
+ * @brief Returns the number of messages posted with post<br>
+ */
+
+int mf_pdhost_posts(void);
+
+#endif /* mf_pdhost_h */
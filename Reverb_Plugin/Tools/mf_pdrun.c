@@ -0,0 +1,322 @@
+/**
+ * @file mf_pdrun.c
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * End-to-end run of the compiled external <br>
+ * <br>
+ * @brief Loads mf_reverb~ into mf_pdhost, checks its messages and measures it <br>
+ * <br>
+ * mf_pdrun creates mf_reverb~ objects through their real setup and creator, <br>
+ * builds the DSP chain with their dsp method and runs the perform routine on <br>
+ * white noise. Before the benchmark it checks that the output is finite and <br>
+ * not silent, that the panic bang mutes and unmutes, that freeze sustains <br>
+ * the tail, that wet changes the output, that a send reaches a return over a <br>
+ * bus, that the diagnostics clock posts the clipping of a loud input and that <br>
+ * the meter outlet sends peaks that match the outputs. The program fails if a <br>
+ * check fails. -sig creates the objects with signal inlets. <br>
+ * Usage: mf_pdrun external [-b blocksize] [-n instances] [-s seconds] [-sr rate] [-sig] <br>
+ * <br>
+ */
+
+#include "mf_pdhost.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static int mf_pdrun_failed;
+
+static double mf_pdrun_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static void mf_pdrun_check(int ok, const char *what)
+{
+    printf("%-40s %s\n", what, ok ? "ok" : "FAILED");
+    if (!ok)
+        mf_pdrun_failed = 1;
+}
+
+static void mf_pdrun_noise(t_sample *vec, int n)
+{
+    for (int i = 0; i < n; i++)
+        vec[i] = rand() / (float)RAND_MAX - .5f;
+}
+
+/* runs the chain for the given time and returns the peak of the left outlet of x */
+static float mf_pdrun_run(t_pd *x, int vectorSize, float seconds, int input)
+{
+    long blocks = (long)(seconds * sys_getsr() / vectorSize);
+    t_sample *in = mf_pdhost_inlet(x, 0);
+    t_sample *out = mf_pdhost_outlet(x, 0);
+    float peak = 0;
+
+    for (long b = 0; b < blocks; b++)
+    {
+        if (input)
+            mf_pdrun_noise(in, vectorSize);
+        else
+            memset(in, 0, vectorSize * sizeof(t_sample));
+        mf_pdhost_tick();
+
+        for (int i = 0; i < vectorSize; i++)
+        {
+            if (!isfinite(out[i]))
+                return INFINITY;
+            if (fabsf(out[i]) > peak)
+                peak = fabsf(out[i]);
+        }
+    }
+    return peak;
+}
+
+static t_atom mf_pdrun_float(t_float f)
+{
+    t_atom a;
+    SETFLOAT(&a, f);
+    return a;
+}
+
+static t_atom mf_pdrun_symbol(const char *s)
+{
+    t_atom a;
+    SETSYMBOL(&a, gensym(s));
+    return a;
+}
+
+/* messages of a single object, with the dry signal removed by wet 100 and a silent input */
+static void mf_pdrun_test(int vectorSize, int sig)
+{
+    t_atom args[2] = {mf_pdrun_float(3), mf_pdrun_symbol("-sig")};
+    t_pd *x = mf_pdhost_new("mf_reverb~", sig ? 2 : 1, args);
+    t_atom wet = mf_pdrun_float(100);
+
+    mf_pdrun_check(x != NULL, "create mf_reverb~");
+    if (!x)
+        return;
+    mf_pdhost_send(x, "wet", 1, &wet);
+    mf_pdhost_dsp(vectorSize);
+
+    if (sig)
+    {
+        /* the signal inlets take over wet and level */
+        for (int i = 0; i < vectorSize; i++)
+        {
+            mf_pdhost_inlet(x, 1)[i] = 100;
+            mf_pdhost_inlet(x, 2)[i] = 1;
+        }
+    }
+
+    float peak = mf_pdrun_run(x, vectorSize, .5f, 1);
+    mf_pdrun_check(isfinite(peak) && peak > 1e-3f, "output is finite and not silent");
+
+    mf_pdhost_send(x, "bang", 0, NULL);
+    peak = mf_pdrun_run(x, vectorSize, .2f, 1);
+    peak = mf_pdrun_run(x, vectorSize, .1f, 1);
+    mf_pdrun_check(peak < 1e-4f, "bang mutes");
+
+    mf_pdhost_send(x, "bang", 0, NULL);
+    peak = mf_pdrun_run(x, vectorSize, .2f, 0);
+    mf_pdrun_check(peak > 1e-3f, "second bang unmutes, tail continues");
+
+    /* a tail of 3 s would fall by 60 dB in that time, a frozen one holds its level */
+    t_atom on = mf_pdrun_float(1);
+    mf_pdhost_send(x, "freeze", 1, &on);
+    float frozen = mf_pdrun_run(x, vectorSize, .2f, 0);
+    peak = mf_pdrun_run(x, vectorSize, 3, 1);
+    peak = mf_pdrun_run(x, vectorSize, .2f, 0);
+    mf_pdrun_check(peak > .5f * frozen && peak < 2 * frozen, "freeze sustains the tail");
+    on = mf_pdrun_float(0);
+    mf_pdhost_send(x, "freeze", 1, &on);
+
+    if (!sig)
+    {
+        wet = mf_pdrun_float(0);
+        mf_pdhost_send(x, "wet", 1, &wet);
+        peak = mf_pdrun_run(x, vectorSize, .2f, 0);
+        peak = mf_pdrun_run(x, vectorSize, .1f, 0);
+        mf_pdrun_check(peak < 1e-4f, "wet 0 leaves only the silent dry signal");
+    }
+
+    mf_pdhost_free(x);
+}
+
+/* a send with noise and a return with a silent input */
+static void mf_pdrun_testBus(int vectorSize)
+{
+    t_atom t60 = mf_pdrun_float(2);
+    t_atom name = mf_pdrun_symbol("mf_pdrun_bus");
+    t_atom wet = mf_pdrun_float(100);
+    t_pd *send = mf_pdhost_new("mf_reverb_send~", 1, &name);
+    t_pd *x = mf_pdhost_new("mf_reverb~", 1, &t60);
+
+    mf_pdrun_check(send && x, "create mf_reverb_send~ and return");
+    if (!send || !x)
+        return;
+    mf_pdhost_send(x, "wet", 1, &wet);
+    mf_pdhost_send(x, "bus", 1, &name);
+
+    long blocks = (long)(.5f * sys_getsr() / vectorSize);
+    float peak = 0;
+    for (long b = 0; b < blocks; b++)
+    {
+        mf_pdrun_noise(mf_pdhost_inlet(send, 0), vectorSize);
+        memset(mf_pdhost_inlet(x, 0), 0, vectorSize * sizeof(t_sample));
+        mf_pdhost_tick();
+        for (int i = 0; i < vectorSize; i++)
+            if (fabsf(mf_pdhost_outlet(x, 0)[i]) > peak)
+                peak = fabsf(mf_pdhost_outlet(x, 0)[i]);
+    }
+    mf_pdrun_check(isfinite(peak) && peak > 1e-3f, "send reaches the return");
+
+    mf_pdhost_free(send);
+    mf_pdhost_free(x);
+}
+
+/* a loud input clips, the clock of the diagnostics posts it from outside the perform routine */
+static void mf_pdrun_testDiag(int vectorSize)
+{
+    t_atom t60 = mf_pdrun_float(2);
+    t_atom on = mf_pdrun_float(1);
+    t_pd *x = mf_pdhost_new("mf_reverb~", 1, &t60);
+
+    if (!x)
+        return;
+    mf_pdhost_send(x, "diag", 1, &on);
+    mf_pdhost_dsp(vectorSize);
+
+    int posts = mf_pdhost_posts();
+    long blocks = (long)(.3f * sys_getsr() / vectorSize);
+    for (long b = 0; b < blocks; b++)
+    {
+        mf_pdrun_noise(mf_pdhost_inlet(x, 0), vectorSize);
+        for (int i = 0; i < vectorSize; i++)
+            mf_pdhost_inlet(x, 0)[i] *= 8;
+        mf_pdhost_tick();
+    }
+    mf_pdrun_check(mf_pdhost_posts() > posts, "diagnostics post clipping");
+
+    mf_pdhost_free(x);
+}
+
+/* the meter outlet sends peaks and RMS values that agree with the signal outlets */
+static void mf_pdrun_testMeter(int vectorSize)
+{
+    t_atom args[2] = {mf_pdrun_float(2), mf_pdrun_symbol("-meter")};
+    t_atom wet = mf_pdrun_float(50);
+    t_atom off = mf_pdrun_float(0);
+    t_pd *x = mf_pdhost_new("mf_reverb~", 2, args);
+    t_atom list[MF_PDHOST_LIST];
+    int count = 0;
+    float peak[2] = {0, 0};
+
+    if (!x)
+        return;
+    mf_pdhost_send(x, "wet", 1, &wet);
+    mf_pdhost_dsp(vectorSize);
+
+    /* the peaks of every list are compared with the outlets since the one before */
+    int sent = mf_pdhost_messages(x, 0, NULL, NULL);
+    int match = 1;
+    long blocks = (long)(.5f * sys_getsr() / vectorSize);
+    for (long b = 0; b < blocks; b++)
+    {
+        mf_pdrun_noise(mf_pdhost_inlet(x, 0), vectorSize);
+        mf_pdhost_tick();
+        for (int c = 0; c < 2; c++)
+        {
+            for (int i = 0; i < vectorSize; i++)
+                peak[c] = fabsf(mf_pdhost_outlet(x, c)[i]) > peak[c] ? fabsf(mf_pdhost_outlet(x, c)[i]) : peak[c];
+        }
+        if (mf_pdhost_messages(x, 0, list, &count) > sent)
+        {
+            sent = mf_pdhost_messages(x, 0, NULL, NULL);
+            match &= count == 8 && list[4].a_w.w_float == peak[0] && list[5].a_w.w_float == peak[1]
+                && list[6].a_w.w_float > 0 && list[6].a_w.w_float <= peak[0] && list[1].a_w.w_float > 0;
+            peak[0] = peak[1] = 0;
+        }
+    }
+    mf_pdrun_check(sent > 0 && match, "meter outlet");
+
+    mf_pdhost_send(x, "meter", 1, &off);
+    for (long b = 0; b < blocks; b++)
+        mf_pdhost_tick();
+    mf_pdrun_check(mf_pdhost_messages(x, 0, NULL, NULL) == sent, "meter 0 stops the outlet");
+
+    mf_pdhost_free(x);
+}
+
+int main(int argc, char **argv)
+{
+    const char *external = NULL;
+    int vectorSize = 64;
+    int instances = 1;
+    double seconds = 10;
+    float sr = 44100;
+    int sig = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-b") && i + 1 < argc)
+            vectorSize = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            instances = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-sr") && i + 1 < argc)
+            sr = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-sig"))
+            sig = 1;
+        else
+            external = argv[i];
+    }
+
+    if (!external || vectorSize < 1 || instances < 1 || sr <= 0)
+    {
+        fprintf(stderr, "usage: mf_pdrun external [-b blocksize] [-n instances] [-s seconds] [-sr rate] [-sig]\n");
+        return 1;
+    }
+
+    mf_pdhost_setSampleRate(sr);
+    if (mf_pdhost_load(external, "mf_reverb_tilde_setup"))
+        return 1;
+
+    srand(1);
+    mf_pdrun_test(vectorSize, sig);
+    mf_pdrun_testBus(vectorSize);
+    mf_pdrun_testDiag(vectorSize);
+    mf_pdrun_testMeter(vectorSize);
+    mf_pdrun_check(mf_pdhost_errors() == 0, "no errors posted");
+
+    /* the benchmark runs all instances in one chain, like a patch */
+    t_atom args[2] = {mf_pdrun_float(3), mf_pdrun_symbol("-sig")};
+    t_atom wet = mf_pdrun_float(50);
+    t_pd *x[instances];
+    for (int i = 0; i < instances; i++)
+    {
+        x[i] = mf_pdhost_new("mf_reverb~", sig ? 2 : 1, args);
+        mf_pdhost_send(x[i], "wet", 1, &wet);
+    }
+    mf_pdhost_dsp(vectorSize);
+
+    long blocks = (long)(seconds * sr / vectorSize);
+    double start = mf_pdrun_now();
+    for (long b = 0; b < blocks; b++)
+    {
+        for (int i = 0; i < instances; i++)
+            mf_pdrun_noise(mf_pdhost_inlet(x[i], 0), vectorSize);
+        mf_pdhost_tick();
+    }
+    double elapsed = mf_pdrun_now() - start;
+
+    printf("%d instances, blocksize %d, %.1f s: %.2f ns/sample per instance, %.1fx realtime\n",
+           instances, vectorSize, seconds, elapsed * 1e9 / ((double)blocks * vectorSize * instances), seconds / elapsed);
+
+    for (int i = 0; i < instances; i++)
+        mf_pdhost_free(x[i]);
+    return mf_pdrun_failed;
+}
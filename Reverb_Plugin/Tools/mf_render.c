@@ -0,0 +1,435 @@
+/**
+ * @file mf_render.c
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Offline batch renderer <br>
+ * <br>
+ * @brief Renders a list of files through the reverb on all cores <br>
+ * <br>
+ * mf_render reads a manifest with one job per line: <br>
+ * input.wav output.wav t60 wet [mod-depth mod-rate] <br>
+ * wet and the modulation use the same values as the messages of mf_reverb~. <br>
+ * The jobs are spread over per-thread queues, a thread that runs out of work <br>
+ * steals from the others. Every thread keeps one engine and reuses it for all <br>
+ * of its jobs. The output is a stereo 32 bit float WAV file including the tail. <br>
+ * The tail is t60 seconds long, with -trim dB it ends where the engine estimates <br>
+ * its output to have fallen below dB dBFS, see mf_reverb_remainingTail. <br>
+ * Inputs ending in .raw are read as mono 32 bit float at the rate set by -rawfs. <br>
+ * Inputs above MF_REVERB_MAX_FS are rejected. <br>
+ * Files are streamed through memory mappings in chunks of MF_RENDER_CHUNK frames, <br>
+ * which keeps the working set in the cache and the resident memory bounded. <br>
+ * The blocks of the engine are marked as the audio callback for mf_rtcheck. <br>
+ * Built with -DMF_REVERB_TRACE, -trace writes the trace points of the engine <br>
+ * and one event per file as Chrome trace JSON after all jobs are done. <br>
+ * Usage: mf_render [-j threads] [-rawfs rate] [-trim dB] [-trace file.json] manifest <br>
+ * <br>
+ */
+
+#include "mf_kernels.h"
+#include "mf_reverb.h"
+#include "mf_rtcheck.h"
+#include "mf_trace.h"
+#include "mf_wav.h"
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MF_RENDER_BLOCK 256
+#define MF_RENDER_CHUNK 4096 /**< 16 kB of mono input and 32 kB of stereo output fit in L2 */
+
+/**
+ * @struct mf_render_task
+ * @brief A single job of the manifest <br>
+ */
+
+typedef struct mf_render_task
+{
+    char input[1024];
+    char output[1024];
+    float t60;
+    float wet;
+    float modDepth;
+    float modRate;
+    long size;      /**< size of the input file, used to start with the longest jobs */
+    long frames;    /**< number of rendered frames */
+    int fs;         /**< sample rate of the input */
+    double seconds; /**< processing time */
+    int worker;     /**< index of the thread that rendered the job */
+    int failed;
+} mf_render_task;
+
+/**
+ * @struct mf_render_queue
+ * @brief The job queue of one thread <br>
+ * The owner takes jobs from the back, thieves from the front. <br>
+ * Jobs are whole files, so a mutex per queue is cheap enough. <br>
+ */
+
+typedef struct mf_render_queue
+{
+    pthread_mutex_t lock;
+    int *tasks;
+    int head;
+    int tail;
+} mf_render_queue;
+
+typedef struct mf_render_pool
+{
+    mf_render_task *tasks;
+    mf_render_queue *queues;
+    int workers;
+    int rawFs;
+    float trim; /**< level in dBFS that ends the tail, 0 renders t60 seconds */
+} mf_render_pool;
+
+typedef struct mf_render_worker
+{
+    mf_render_pool *pool;
+    int index;
+    long steals;
+} mf_render_worker;
+
+static double mf_render_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+static int mf_render_take(mf_render_queue *q, int fromBack)
+{
+    int task = -1;
+    pthread_mutex_lock(&q->lock);
+    if (q->head < q->tail)
+        task = fromBack ? q->tasks[--q->tail] : q->tasks[q->head++];
+    pthread_mutex_unlock(&q->lock);
+    return task;
+}
+
+static int mf_render_isRaw(const char *path)
+{
+    size_t length = strlen(path);
+    return length > 4 && !strcmp(path + length - 4, ".raw");
+}
+
+static void mf_render_file(mf_render_task *t, mf_reverb **engine, int rawFs, float trim)
+{
+    mf_wav in, out;
+    float mono[MF_RENDER_CHUNK];
+    float left[MF_RENDER_BLOCK], right[MF_RENDER_BLOCK];
+    int opened = mf_render_isRaw(t->input) ? mf_wav_openRaw(&in, t->input, 1, rawFs) : mf_wav_open(&in, t->input);
+
+    if (opened)
+    {
+        fprintf(stderr, "mf_render: can not read %s\n", t->input);
+        t->failed = 1;
+        return;
+    }
+    if (in.fs < 1 || in.fs > MF_REVERB_MAX_FS)
+    {
+        fprintf(stderr, "mf_render: %s: %d Hz is not supported, at most %d Hz\n", t->input, in.fs, MF_REVERB_MAX_FS);
+        mf_wav_close(&in);
+        t->failed = 1;
+        return;
+    }
+    if (mf_wav_create(&out, t->output, 2, in.fs))
+    {
+        fprintf(stderr, "mf_render: can not create %s\n", t->output);
+        mf_wav_close(&in);
+        t->failed = 1;
+        return;
+    }
+
+    if (*engine)
+        mf_reverb_configure(*engine, t->t60, in.fs);
+    else
+        *engine = mf_reverb_new(t->t60, in.fs);
+    mf_reverb *x = *engine;
+    mf_reverb_setLevel(x, 1);
+    mf_reverb_setWet(x, t->wet);
+    mf_reverb_setModulation(x, t->modDepth, t->modRate);
+    mf_reverb_settle(x);
+
+    t->fs = in.fs;
+    long tail = (long)(t->t60 * in.fs);
+    long total = in.frames + tail;
+    long remaining = 0;
+
+    for (long done = 0; ; )
+    {
+        long want = total - done;
+
+        /* the estimate is a bound and usually too long, so it is asked again when it is used up */
+        if (trim < 0 && done >= in.frames)
+        {
+            if (remaining == 0)
+                remaining = mf_reverb_remainingTail(x, trim);
+            if (remaining >= 0)
+                want = remaining;
+        }
+        if (want <= 0)
+            break;
+
+        /* the output is interleaved straight into the mapped file */
+        long count;
+        float *stereo = mf_wav_reserve(&out, want < MF_RENDER_CHUNK ? want : MF_RENDER_CHUNK, &count);
+        if (!stereo)
+        {
+            fprintf(stderr, "mf_render: write error on %s\n", t->output);
+            t->failed = 1;
+            break;
+        }
+
+        long got = mf_wav_read(&in, mono, count);
+        memset(mono + got, 0, (count - got) * sizeof(float));
+
+        MF_RTCHECK_ENTER();
+        for (long b = 0; b < count; b += MF_RENDER_BLOCK)
+        {
+            int n = count - b < MF_RENDER_BLOCK ? count - b : MF_RENDER_BLOCK;
+            mf_reverb_perform(x, mono + b, left, right, n);
+            for (int i = 0; i < n; i++)
+            {
+                stereo[2 * (b + i)] = left[i];
+                stereo[2 * (b + i) + 1] = right[i];
+            }
+        }
+
+        MF_RTCHECK_LEAVE();
+
+        mf_wav_commit(&out, count);
+        done += count;
+        if (remaining > 0)
+            remaining -= count;
+    }
+
+    t->frames = out.frames;
+    mf_wav_close(&in);
+    if (mf_wav_close(&out))
+    {
+        fprintf(stderr, "mf_render: can not complete %s\n", t->output);
+        t->failed = 1;
+    }
+}
+
+static void *mf_render_work(void *arg)
+{
+    mf_render_worker *w = (mf_render_worker *)arg;
+    mf_render_pool *pool = w->pool;
+    mf_reverb *engine = NULL;
+
+    for (;;)
+    {
+        int task = mf_render_take(&pool->queues[w->index], 1);
+
+        /* own queue is empty, steal from the others */
+        for (int i = 1; task < 0 && i < pool->workers; i++)
+        {
+            task = mf_render_take(&pool->queues[(w->index + i) % pool->workers], 0);
+            if (task >= 0)
+                w->steals++;
+        }
+
+        /* nothing is added while rendering, so empty queues mean we are done */
+        if (task < 0)
+            break;
+
+        mf_render_task *t = &pool->tasks[task];
+        double start = mf_render_now();
+        MF_TRACE_BEGIN(file);
+        mf_render_file(t, &engine, pool->rawFs, pool->trim);
+        MF_TRACE_END(file, t->input);
+        t->seconds = mf_render_now() - start;
+        t->worker = w->index;
+    }
+
+    if (engine)
+        mf_reverb_free(engine);
+    return NULL;
+}
+
+static int mf_render_bySize(const void *a, const void *b)
+{
+    long sa = ((const mf_render_task *)a)->size;
+    long sb = ((const mf_render_task *)b)->size;
+    return (sa < sb) - (sa > sb);
+}
+
+static int mf_render_readManifest(const char *path, mf_render_task **tasks)
+{
+    FILE *f = fopen(path, "r");
+    char line[4096];
+    int count = 0, capacity = 0;
+
+    if (!f)
+        return -1;
+
+    *tasks = NULL;
+    while (fgets(line, sizeof(line), f))
+    {
+        mf_render_task t;
+        memset(&t, 0, sizeof(t));
+        if (line[0] == '#')
+            continue;
+        int fields = sscanf(line, "%1023s %1023s %f %f %f %f", t.input, t.output, &t.t60, &t.wet, &t.modDepth, &t.modRate);
+        if (fields <= 0)
+            continue;
+        if (fields < 4)
+        {
+            fprintf(stderr, "mf_render: skipping malformed line: %s", line);
+            continue;
+        }
+
+        struct stat st;
+        t.size = stat(t.input, &st) ? 0 : st.st_size;
+
+        if (count == capacity)
+        {
+            capacity = capacity ? 2 * capacity : 64;
+            *tasks = (mf_render_task *)realloc(*tasks, capacity * sizeof(mf_render_task));
+        }
+        (*tasks)[count++] = t;
+    }
+
+    fclose(f);
+    return count;
+}
+
+int main(int argc, char **argv)
+{
+    int workers = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    int rawFs = 44100;
+    const char *manifest = NULL;
+    const char *trace = NULL;
+    float trim = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-j") && i + 1 < argc)
+            workers = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-rawfs") && i + 1 < argc)
+            rawFs = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-trim") && i + 1 < argc)
+            trim = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-trace") && i + 1 < argc)
+            trace = argv[++i];
+        else
+            manifest = argv[i];
+    }
+
+    if (!manifest || workers < 1 || trim > 0)
+    {
+        fprintf(stderr, "usage: mf_render [-j threads] [-rawfs rate] [-trim dB] [-trace file.json] manifest\n");
+        return 1;
+    }
+
+#ifndef MF_REVERB_TRACE
+    if (trace)
+        fprintf(stderr, "mf_render: built without MF_REVERB_TRACE, -trace is ignored\n");
+#endif
+
+    if (mf_kernels_select(NULL))
+        fprintf(stderr, "mf_render: MF_REVERB_ISA=%s is not supported, using %s\n", getenv("MF_REVERB_ISA"), mf_kernels_current.name);
+
+    mf_render_task *tasks;
+    int count = mf_render_readManifest(manifest, &tasks);
+    if (count < 0)
+    {
+        fprintf(stderr, "mf_render: can not read %s\n", manifest);
+        return 1;
+    }
+    if (count == 0)
+        return 0;
+    if (workers > count)
+        workers = count;
+
+    /* longest jobs first, dealt round robin, so stealing only has to balance the end */
+    qsort(tasks, count, sizeof(mf_render_task), mf_render_bySize);
+
+    mf_render_pool pool = {tasks, (mf_render_queue *)calloc(workers, sizeof(mf_render_queue)), workers, rawFs, trim};
+    for (int i = 0; i < workers; i++)
+    {
+        pthread_mutex_init(&pool.queues[i].lock, NULL);
+        pool.queues[i].tasks = (int *)malloc(count * sizeof(int));
+    }
+    for (int i = 0; i < count; i++)
+    {
+        mf_render_queue *q = &pool.queues[i % workers];
+        /* the owner pops from the back, so the longest job goes there */
+        q->tasks[q->tail++] = i;
+    }
+    for (int i = 0; i < workers; i++)
+    {
+        mf_render_queue *q = &pool.queues[i];
+        for (int a = q->head, b = q->tail - 1; a < b; a++, b--)
+        {
+            int swap = q->tasks[a];
+            q->tasks[a] = q->tasks[b];
+            q->tasks[b] = swap;
+        }
+    }
+
+    pthread_t threads[workers];
+    mf_render_worker state[workers];
+    double start = mf_render_now();
+
+    for (int i = 0; i < workers; i++)
+    {
+        state[i] = (mf_render_worker){&pool, i, 0};
+        pthread_create(&threads[i], NULL, mf_render_work, &state[i]);
+    }
+
+    long steals = 0;
+    for (int i = 0; i < workers; i++)
+    {
+        pthread_join(threads[i], NULL);
+        steals += state[i].steals;
+    }
+
+    double wall = mf_render_now() - start;
+    double audio = 0, busy = 0;
+    long frames = 0;
+    int failed = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        mf_render_task *t = &tasks[i];
+        if (t->failed)
+        {
+            failed++;
+            continue;
+        }
+        printf("%-40s %10ld frames %8.3f s %8.1fx realtime (thread %d)\n",
+               t->output, t->frames, t->seconds, (double)t->frames / t->fs / t->seconds, t->worker);
+        audio += (double)t->frames / t->fs;
+        busy += t->seconds;
+        frames += t->frames;
+    }
+
+    printf("%d files, %d failed, %d threads, %ld steals\n", count, failed, workers, steals);
+    printf("wall %.3f s, %.1f Mframes/s, %.1fx realtime, %.0f%% thread utilisation\n",
+           wall, frames / wall * 1e-6, audio / wall, 100 * busy / (wall * workers));
+
+#ifdef MF_REVERB_TRACE
+    /* the file names are part of the trace, so it is written before the tasks are freed */
+    if (trace)
+    {
+        long events = mf_trace_write(trace);
+        if (events < 0)
+            fprintf(stderr, "mf_render: can not write %s\n", trace);
+        else
+            printf("%ld trace events written to %s\n", events, trace);
+    }
+#endif
+
+    for (int i = 0; i < workers; i++)
+    {
+        pthread_mutex_destroy(&pool.queues[i].lock);
+        free(pool.queues[i].tasks);
+    }
+    free(pool.queues);
+    free(tasks);
+    return failed ? 2 : 0;
+}
@@ -0,0 +1,310 @@
+/**
+ * @file mf_rtcheck.c
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Real-time safety checker <br>
+ * <br>
+ * @brief Traps calls that must not happen in the audio callback <br>
+ * <br>
+ * mf_rtcheck is a library for LD_PRELOAD. It interposes the allocator, <br>
+ * mutexes, condition variables, semaphores, file and console I/O, sleeping <br>
+ * and mmap. Between MF_RTCHECK_ENTER and MF_RTCHECK_LEAVE of mf_rtcheck.h, <br>
+ * which mf_pdhost_tick, mf_render and mf_deadline put around the engine, every <br>
+ * such call is a violation. The first MF_RTCHECK_REPORTS violations are <br>
+ * printed to stderr with the call stack, the interposed function first. Names <br>
+ * of static functions are missing, addr2line resolves their offsets. At exit <br>
+ * the number of callbacks and violations is printed, and the program exits <br>
+ * with 1 if there was a violation or no callback was marked at all. The calls <br>
+ * themselves go on to the real functions, so the program behaves as usual. <br>
+ * Only calls through the dynamic linker are seen, inlined system calls and <br>
+ * calls inside libc are not. <br>
+ * Build: cc -O2 -shared -fPIC -ITools Tools/mf_rtcheck.c -ldl -o mf_rtcheck.so <br>
+ * Usage: LD_PRELOAD=./mf_rtcheck.so ./mf_pdrun ./mf_reverb~.pd_linux <br>
+ * <br>
+ */
+
+#define _GNU_SOURCE
+#include "mf_rtcheck.h"
+#include <dlfcn.h>
+#include <execinfo.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sched.h>
+#include <semaphore.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <time.h>
+#include <unistd.h>
+
+#define MF_RTCHECK_REPORTS 16  /**< violations printed with their call stack, later ones are only counted */
+#define MF_RTCHECK_FRAMES 32
+#define MF_RTCHECK_ARENA 65536 /**< serves dlsym, which allocates before the real allocator is known */
+
+/* initial-exec, so reading them never calls into the allocator */
+static __thread int mf_rtcheck_depth __attribute__((tls_model("initial-exec")));
+static __thread int mf_rtcheck_busy __attribute__((tls_model("initial-exec")));
+static long mf_rtcheck_callbacks;
+static long mf_rtcheck_violations;
+
+static char mf_rtcheck_arena[MF_RTCHECK_ARENA] __attribute__((aligned(16)));
+static size_t mf_rtcheck_used;
+static int mf_rtcheck_resolving;
+
+void mf_rtcheck_enter(void)
+{
+    if (mf_rtcheck_depth++ == 0)
+        __atomic_add_fetch(&mf_rtcheck_callbacks, 1, __ATOMIC_RELAXED);
+}
+
+void mf_rtcheck_leave(void)
+{
+    mf_rtcheck_depth--;
+}
+
+static void *mf_rtcheck_find(const char *name)
+{
+    mf_rtcheck_resolving = 1;
+    void *f = dlsym(RTLD_NEXT, name);
+    mf_rtcheck_resolving = 0;
+    return f;
+}
+
+static void *mf_rtcheck_bump(size_t size)
+{
+    size_t start = (mf_rtcheck_used + 15) & ~(size_t)15;
+    if (start + size > MF_RTCHECK_ARENA)
+        return NULL;
+    mf_rtcheck_used = start + size;
+    return mf_rtcheck_arena + start;
+}
+
+static int mf_rtcheck_inArena(const void *p)
+{
+    return (const char *)p >= mf_rtcheck_arena && (const char *)p < mf_rtcheck_arena + MF_RTCHECK_ARENA;
+}
+
+static __attribute__((noinline)) void mf_rtcheck_report(const char *name)
+{
+    long n = __atomic_add_fetch(&mf_rtcheck_violations, 1, __ATOMIC_RELAXED);
+    if (n > MF_RTCHECK_REPORTS)
+        return;
+
+    void *frames[MF_RTCHECK_FRAMES];
+    int count = backtrace(frames, MF_RTCHECK_FRAMES);
+    char line[160];
+    int length = snprintf(line, sizeof(line), "mf_rtcheck: %s in the audio callback%s\n",
+                          name, n == MF_RTCHECK_REPORTS ? ", further violations are only counted" : "");
+
+    /* the first frame is this function */
+    write(2, line, length);
+    backtrace_symbols_fd(frames + 1, count - 1, 2);
+}
+
+/* every wrapper runs between begin and mf_rtcheck_busy--, calls made by the real function are not reported again */
+static inline __attribute__((always_inline)) void mf_rtcheck_begin(const char *name)
+{
+    if (mf_rtcheck_busy++ == 0 && mf_rtcheck_depth > 0)
+        mf_rtcheck_report(name);
+}
+
+#define MF_RTCHECK_WRAP(type, name, params, args) \
+    static __typeof__(name) *mf_rtcheck_##name; \
+    type name params \
+    { \
+        if (!mf_rtcheck_##name) \
+            mf_rtcheck_##name = (__typeof__(name) *)mf_rtcheck_find(#name); \
+        mf_rtcheck_begin(#name); \
+        type result = mf_rtcheck_##name args; \
+        mf_rtcheck_busy--; \
+        return result; \
+    }
+
+static __typeof__(malloc) *mf_rtcheck_malloc;
+static __typeof__(calloc) *mf_rtcheck_calloc;
+static __typeof__(realloc) *mf_rtcheck_realloc;
+static __typeof__(free) *mf_rtcheck_free;
+
+void *malloc(size_t size)
+{
+    if (!mf_rtcheck_malloc)
+    {
+        if (mf_rtcheck_resolving)
+            return mf_rtcheck_bump(size);
+        mf_rtcheck_malloc = (__typeof__(malloc) *)mf_rtcheck_find("malloc");
+    }
+    mf_rtcheck_begin("malloc");
+    void *p = mf_rtcheck_malloc(size);
+    mf_rtcheck_busy--;
+    return p;
+}
+
+void *calloc(size_t count, size_t size)
+{
+    if (!mf_rtcheck_calloc)
+    {
+        /* the arena is static, so it is already cleared */
+        if (mf_rtcheck_resolving)
+            return size && count > SIZE_MAX / size ? NULL : mf_rtcheck_bump(count * size);
+        mf_rtcheck_calloc = (__typeof__(calloc) *)mf_rtcheck_find("calloc");
+    }
+    mf_rtcheck_begin("calloc");
+    void *p = mf_rtcheck_calloc(count, size);
+    mf_rtcheck_busy--;
+    return p;
+}
+
+void *realloc(void *p, size_t size)
+{
+    if (!mf_rtcheck_realloc)
+        mf_rtcheck_realloc = (__typeof__(realloc) *)mf_rtcheck_find("realloc");
+    mf_rtcheck_begin("realloc");
+
+    void *result;
+    if (mf_rtcheck_inArena(p))
+    {
+        /* the old size is unknown, but never more than the rest of the arena */
+        size_t available = mf_rtcheck_arena + MF_RTCHECK_ARENA - (char *)p;
+        result = malloc(size);
+        if (result)
+            memcpy(result, p, size < available ? size : available);
+    }
+    else
+        result = mf_rtcheck_realloc(p, size);
+
+    mf_rtcheck_busy--;
+    return result;
+}
+
+void free(void *p)
+{
+    if (mf_rtcheck_inArena(p))
+        return;
+    if (!mf_rtcheck_free)
+        mf_rtcheck_free = (__typeof__(free) *)mf_rtcheck_find("free");
+    mf_rtcheck_begin("free");
+    mf_rtcheck_free(p);
+    mf_rtcheck_busy--;
+}
+
+MF_RTCHECK_WRAP(int, posix_memalign, (void **p, size_t alignment, size_t size), (p, alignment, size))
+MF_RTCHECK_WRAP(void *, aligned_alloc, (size_t alignment, size_t size), (alignment, size))
+MF_RTCHECK_WRAP(void *, mmap, (void *address, size_t length, int protection, int flags, int fd, off_t offset), (address, length, protection, flags, fd, offset))
+MF_RTCHECK_WRAP(int, munmap, (void *address, size_t length), (address, length))
+
+MF_RTCHECK_WRAP(int, pthread_mutex_lock, (pthread_mutex_t *mutex), (mutex))
+MF_RTCHECK_WRAP(int, pthread_rwlock_rdlock, (pthread_rwlock_t *lock), (lock))
+MF_RTCHECK_WRAP(int, pthread_rwlock_wrlock, (pthread_rwlock_t *lock), (lock))
+MF_RTCHECK_WRAP(int, pthread_cond_wait, (pthread_cond_t *condition, pthread_mutex_t *mutex), (condition, mutex))
+MF_RTCHECK_WRAP(int, sem_wait, (sem_t *semaphore), (semaphore))
+
+MF_RTCHECK_WRAP(int, close, (int fd), (fd))
+MF_RTCHECK_WRAP(ssize_t, read, (int fd, void *data, size_t size), (fd, data, size))
+MF_RTCHECK_WRAP(ssize_t, write, (int fd, const void *data, size_t size), (fd, data, size))
+MF_RTCHECK_WRAP(FILE *, fopen, (const char *path, const char *mode), (path, mode))
+MF_RTCHECK_WRAP(int, fclose, (FILE *f), (f))
+MF_RTCHECK_WRAP(size_t, fread, (void *data, size_t size, size_t count, FILE *f), (data, size, count, f))
+MF_RTCHECK_WRAP(size_t, fwrite, (const void *data, size_t size, size_t count, FILE *f), (data, size, count, f))
+MF_RTCHECK_WRAP(int, fflush, (FILE *f), (f))
+MF_RTCHECK_WRAP(int, fputs, (const char *s, FILE *f), (s, f))
+MF_RTCHECK_WRAP(int, puts, (const char *s), (s))
+MF_RTCHECK_WRAP(int, vprintf, (const char *format, va_list args), (format, args))
+MF_RTCHECK_WRAP(int, vfprintf, (FILE *f, const char *format, va_list args), (f, format, args))
+
+MF_RTCHECK_WRAP(int, nanosleep, (const struct timespec *duration, struct timespec *rest), (duration, rest))
+MF_RTCHECK_WRAP(int, clock_nanosleep, (clockid_t clock, int flags, const struct timespec *time, struct timespec *rest), (clock, flags, time, rest))
+MF_RTCHECK_WRAP(int, usleep, (useconds_t duration), (duration))
+MF_RTCHECK_WRAP(unsigned int, sleep, (unsigned int seconds), (seconds))
+MF_RTCHECK_WRAP(int, sched_yield, (void), ())
+
+/* the variadic functions go on through their va_list versions */
+
+int printf(const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    mf_rtcheck_begin("printf");
+    int result = vprintf(format, args);
+    mf_rtcheck_busy--;
+    va_end(args);
+    return result;
+}
+
+int fprintf(FILE *f, const char *format, ...)
+{
+    va_list args;
+    va_start(args, format);
+    mf_rtcheck_begin("fprintf");
+    int result = vfprintf(f, format, args);
+    mf_rtcheck_busy--;
+    va_end(args);
+    return result;
+}
+
+static int mf_rtcheck_open(const char *name, int at, const char *path, int flags, va_list args)
+{
+    static __typeof__(openat) *real;
+    int mode = flags & (O_CREAT | O_TMPFILE) ? va_arg(args, int) : 0;
+    if (!real)
+        real = (__typeof__(openat) *)mf_rtcheck_find("openat");
+    mf_rtcheck_begin(name);
+    int fd = real(at, path, flags, mode);
+    mf_rtcheck_busy--;
+    return fd;
+}
+
+int open(const char *path, int flags, ...)
+{
+    va_list args;
+    va_start(args, flags);
+    int fd = mf_rtcheck_open("open", AT_FDCWD, path, flags, args);
+    va_end(args);
+    return fd;
+}
+
+int open64(const char *path, int flags, ...)
+{
+    va_list args;
+    va_start(args, flags);
+    int fd = mf_rtcheck_open("open64", AT_FDCWD, path, flags, args);
+    va_end(args);
+    return fd;
+}
+
+int openat(int at, const char *path, int flags, ...)
+{
+    va_list args;
+    va_start(args, flags);
+    int fd = mf_rtcheck_open("openat", at, path, flags, args);
+    va_end(args);
+    return fd;
+}
+
+/* backtrace loads libgcc on its first call, which must not happen in a callback */
+__attribute__((constructor))
+static void mf_rtcheck_start(void)
+{
+    void *frame;
+    backtrace(&frame, 1);
+}
+
+__attribute__((destructor))
+static void mf_rtcheck_finish(void)
+{
+    long callbacks = __atomic_load_n(&mf_rtcheck_callbacks, __ATOMIC_RELAXED);
+    long violations = __atomic_load_n(&mf_rtcheck_violations, __ATOMIC_RELAXED);
+
+    if (callbacks == 0)
+        fprintf(stderr, "mf_rtcheck: no audio callback was marked, the host does not call MF_RTCHECK_ENTER\n");
+    else
+        fprintf(stderr, "mf_rtcheck: %ld violations in %ld audio callbacks\n", violations, callbacks);
+
+    if (callbacks == 0 || violations)
+    {
+        fflush(NULL);
+        _exit(1);
+    }
+}
@@ -0,0 +1,36 @@
+/**
+ * @file mf_rtcheck.h
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Markers of the audio callback <br>
+ * <br>
+ * @brief Tells mf_rtcheck which code runs in the audio callback <br>
+ * <br>
+ * The hosts call MF_RTCHECK_ENTER before and MF_RTCHECK_LEAVE after the code <br>
+ * that runs in the audio callback of a real host. The markers are weak <br>
+ * references: a program started without mf_rtcheck.so in LD_PRELOAD has no <br>
+ * definition and the markers cost a compare, with the library preloaded they <br>
+ * resolve to it and the calls in between are checked. <br>
+ * <br>
+ */
+
+#ifndef mf_rtcheck_h
+#define mf_rtcheck_h
+
+/**
+ * @brief Marks the start of an audio callback on the calling thread<br>
+ * Callbacks may be nested, the check ends with the outermost one <br>
+ */
+
+void mf_rtcheck_enter(void) __attribute__((weak));
+
+/**
+ * @brief Marks the end of an audio callback on the calling thread<br>
+ */
+
+void mf_rtcheck_leave(void) __attribute__((weak));
+
+#define MF_RTCHECK_ENTER() do { if (mf_rtcheck_enter) mf_rtcheck_enter(); } while (0)
+#define MF_RTCHECK_LEAVE() do { if (mf_rtcheck_leave) mf_rtcheck_leave(); } while (0)
+
+#endif /* mf_rtcheck_h */
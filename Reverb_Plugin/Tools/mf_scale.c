@@ -0,0 +1,277 @@
+/**
+ * @file mf_scale.c
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Instance scaling benchmark <br>
+ * <br>
+ * @brief Measures how the engine scales from one to many instances <br>
+ * <br>
+ * mf_scale runs 1, 2, 4, ... up to -n engines in one loop, every engine once <br>
+ * per block with its own input and output vectors like the objects of a patch, <br>
+ * and prints the time per sample and instance for every step. As long as all <br>
+ * delay lines fit in the caches the time stays flat, beyond that it grows with <br>
+ * the misses. On Linux the last level cache and dTLB read misses of the <br>
+ * measured loop are counted with perf_event_open; where the counters are not <br>
+ * available, e.g. in a container or with a strict perf_event_paranoid, their <br>
+ * columns show a dash. The memory column is what the engines allocate, the <br>
+ * delay lines they actually run through are printed once. The load column is <br>
+ * the share of one core all engines need in real time. <br>
+ * Usage: mf_scale [-b blocksize] [-n instances] [-s seconds] [-fs rate] [-half] <br>
+ * <br>
+ */
+
+#include "mf_kernels.h"
+#include "mf_reverb.h"
+#include <string.h>
+#include <time.h>
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#define MF_SCALE_WARMUP .1f /**< seconds every step runs before it is measured, longer than every delay */
+
+/**
+ * @brief The hardware counters of the measured loop <br>
+ * MF_SCALE_LLC: read misses of the last level cache <br>
+ * MF_SCALE_DTLB: read misses of the data TLB <br>
+ */
+
+enum
+{
+    MF_SCALE_LLC,
+    MF_SCALE_DTLB,
+    MF_SCALE_COUNTERS
+};
+
+static double mf_scale_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return t.tv_sec + t.tv_nsec * 1e-9;
+}
+
+/* opens a counter of this thread in user space, -1 if the kernel or the CPU does not offer it */
+static int mf_scale_open(int counter)
+{
+#ifdef __linux__
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HW_CACHE;
+    attr.config = (counter == MF_SCALE_LLC ? PERF_COUNT_HW_CACHE_LL : PERF_COUNT_HW_CACHE_DTLB)
+        | PERF_COUNT_HW_CACHE_OP_READ << 8 | PERF_COUNT_HW_CACHE_RESULT_MISS << 16;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0);
+#else
+    return -1;
+#endif
+}
+
+static void mf_scale_start(const int *fd)
+{
+#ifdef __linux__
+    for (int c = 0; c < MF_SCALE_COUNTERS; c++)
+    {
+        if (fd[c] >= 0)
+        {
+            ioctl(fd[c], PERF_EVENT_IOC_RESET, 0);
+            ioctl(fd[c], PERF_EVENT_IOC_ENABLE, 0);
+        }
+    }
+#endif
+}
+
+/* stops the counters and scales them up if the kernel had to share the hardware with other events */
+static void mf_scale_stop(const int *fd, double *count)
+{
+    for (int c = 0; c < MF_SCALE_COUNTERS; c++)
+    {
+        count[c] = -1;
+#ifdef __linux__
+        uint64_t value[3];
+        if (fd[c] >= 0 && !ioctl(fd[c], PERF_EVENT_IOC_DISABLE, 0) && read(fd[c], value, sizeof(value)) == sizeof(value) && value[2] > 0)
+            count[c] = (double)value[0] * value[1] / value[2];
+#endif
+    }
+}
+
+/* the memory the engine allocates, whether its delays use it or not */
+static long mf_scale_allocated(mf_reverb *x)
+{
+    long bytes = sizeof(mf_reverb) + sizeof(mf_early);
+    for (int i = 0; i < 4; i++)
+        bytes += sizeof(*x->comb[i]);
+    for (int i = 0; i < 40; i++)
+        bytes += sizeof(*x->allpass[i]);
+    for (int c = 0; c < 2; c++)
+        bytes += x->decorrelator[c] ? sizeof(mf_velvet) : 0;
+    return bytes;
+}
+
+/* the part of the delay lines the filters run through */
+static long mf_scale_used(mf_reverb *x)
+{
+    long bytes = 0;
+    for (int i = 0; i < 4; i++)
+        bytes += x->comb[i]->delay * (x->half ? sizeof(uint16_t) : sizeof(float));
+    for (int i = 0; i < 2 * MF_REVERB_STAGES; i++)
+        bytes += x->allpass[i]->delay * (x->half ? sizeof(uint16_t) : sizeof(float));
+    return bytes;
+}
+
+static void mf_scale_noise(float *vec, int n)
+{
+    for (int i = 0; i < n; i++)
+        vec[i] = .1f * (rand() / (float)RAND_MAX - .5f);
+}
+
+/**
+ * @brief Runs one step of the sweep <br>
+ * @param instances The number of engines <br>
+ * @param vectorSize The block size <br>
+ * @param seconds The audio every engine processes while measured <br>
+ * @param fs The sample rate <br>
+ * @param half True for half-precision delay lines <br>
+ * @param fd The counters, -1 for the ones that are not available <br>
+ * @param count Returns the counters of the measured loop, -1 if not available <br>
+ * @param allocated Returns the memory one engine allocates <br>
+ * @param used Returns the delay-line memory one engine runs through <br>
+ * @return the time per sample and engine in ns <br>
+ */
+
+static double mf_scale_step(int instances, int vectorSize, float seconds, float fs, bool half, const int *fd,
+                            double *count, long *allocated, long *used)
+{
+    mf_reverb **x = (mf_reverb **)malloc(instances * sizeof(mf_reverb *));
+    float *in = (float *)malloc((size_t)instances * vectorSize * sizeof(float));
+    float *outl = (float *)malloc((size_t)instances * vectorSize * sizeof(float));
+    float *outr = (float *)malloc((size_t)instances * vectorSize * sizeof(float));
+
+    for (int e = 0; e < instances; e++)
+    {
+        x[e] = mf_reverb_new(3, fs);
+        mf_reverb_setWet(x[e], 100);
+        mf_reverb_settle(x[e]);
+        mf_reverb_setHalf(x[e], half);
+    }
+    *allocated = mf_scale_allocated(x[0]);
+    *used = mf_scale_used(x[0]);
+    srand(6);
+    mf_scale_noise(in, instances * vectorSize);
+
+    /* the warmup runs every delay line through once, so the first pass is not measured */
+    long warmup = (long)(MF_SCALE_WARMUP * fs / vectorSize) + 1;
+    long blocks = (long)(seconds * fs / vectorSize) + 1;
+    double start = 0;
+
+    for (long b = 0; b < warmup + blocks; b++)
+    {
+        if (b == warmup)
+        {
+            mf_scale_start(fd);
+            start = mf_scale_now();
+        }
+        for (int e = 0; e < instances; e++)
+            mf_reverb_perform(x[e], in + e * vectorSize, outl + e * vectorSize, outr + e * vectorSize, vectorSize);
+    }
+    double elapsed = mf_scale_now() - start;
+    mf_scale_stop(fd, count);
+
+    for (int e = 0; e < instances; e++)
+        mf_reverb_free(x[e]);
+    free(x);
+    free(in);
+    free(outl);
+    free(outr);
+
+    double samples = (double)blocks * vectorSize * instances;
+    for (int c = 0; c < MF_SCALE_COUNTERS; c++)
+    {
+        if (count[c] >= 0)
+            count[c] *= 1000 / samples;
+    }
+    return elapsed * 1e9 / samples;
+}
+
+int main(int argc, char **argv)
+{
+    int vectorSize = 64;
+    int instances = 1024;
+    float seconds = .5f;
+    float fs = 44100;
+    bool half = false;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-b") && i + 1 < argc)
+            vectorSize = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc)
+            instances = atoi(argv[++i]);
+        else if (!strcmp(argv[i], "-s") && i + 1 < argc)
+            seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-fs") && i + 1 < argc)
+            fs = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-half"))
+            half = true;
+        else
+        {
+            fprintf(stderr, "usage: mf_scale [-b blocksize] [-n instances] [-s seconds] [-fs rate] [-half]\n");
+            return 1;
+        }
+    }
+    if (vectorSize < 1 || instances < 1 || seconds <= 0 || fs <= 0)
+    {
+        fprintf(stderr, "usage: mf_scale [-b blocksize] [-n instances] [-s seconds] [-fs rate] [-half]\n");
+        return 1;
+    }
+
+    if (mf_kernels_select(NULL))
+        fprintf(stderr, "mf_scale: MF_REVERB_ISA=%s is not supported, using %s\n", getenv("MF_REVERB_ISA"), mf_kernels_current.name);
+
+    int fd[MF_SCALE_COUNTERS];
+    for (int c = 0; c < MF_SCALE_COUNTERS; c++)
+        fd[c] = mf_scale_open(c);
+
+    printf("blocksize %d, %.2f s per step, %s kernels, %s delay lines", vectorSize, seconds, mf_kernels_current.name, half ? "half-precision" : "float");
+    if (fd[MF_SCALE_LLC] < 0 && fd[MF_SCALE_DTLB] < 0)
+        printf(", no hardware counters");
+    printf("\n");
+    printf("%9s %10s %10s %12s %12s %8s\n", "instances", "memory", "ns/sample", "LLC miss/ks", "dTLB miss/ks", "load");
+
+    long allocated = 0, used = 0;
+    for (int n = 1; ; n = 2 * n < instances ? 2 * n : instances)
+    {
+        double count[MF_SCALE_COUNTERS];
+        double ns = mf_scale_step(n, vectorSize, seconds, fs, half, fd, count, &allocated, &used);
+        char column[MF_SCALE_COUNTERS][16];
+
+        for (int c = 0; c < MF_SCALE_COUNTERS; c++)
+        {
+            if (count[c] >= 0)
+                snprintf(column[c], sizeof(column[c]), "%.2f", count[c]);
+            else
+                strcpy(column[c], "-");
+        }
+        printf("%9d %7.1f MB %10.2f %12s %12s %7.1f%%\n", n, n * allocated / 1048576., ns,
+               column[MF_SCALE_LLC], column[MF_SCALE_DTLB], 100 * ns * 1e-9 * fs * n);
+        fflush(stdout);
+        if (n == instances)
+            break;
+    }
+    printf("each engine allocates %ld kB, its delay lines run through %ld kB\n", allocated / 1024, used / 1024);
+
+    for (int c = 0; c < MF_SCALE_COUNTERS; c++)
+    {
+#ifdef __linux__
+        if (fd[c] >= 0)
+            close(fd[c]);
+#endif
+    }
+    return 0;
+}
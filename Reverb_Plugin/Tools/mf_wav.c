@@ -0,0 +1,325 @@
+#include "mf_wav.h"
+#include <string.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#define MF_WAV_HEADER 56
+
+static uint32_t mf_wav_u32(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static uint16_t mf_wav_u16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static void mf_wav_put32(unsigned char *p, uint32_t v)
+{
+    p[0] = v; p[1] = v >> 8; p[2] = v >> 16; p[3] = v >> 24;
+}
+
+/* maps the whole input file, reading ahead sequentially */
+static int mf_wav_map(mf_wav *x, const char *path)
+{
+    struct stat st;
+    memset(x, 0, sizeof(mf_wav));
+
+    x->fd = open(path, O_RDONLY);
+    if (x->fd < 0)
+        return -1;
+
+    if (fstat(x->fd, &st) || st.st_size == 0)
+    {
+        close(x->fd);
+        x->fd = -1;
+        return -1;
+    }
+
+    x->mapSize = st.st_size;
+    x->map = (unsigned char *)mmap(NULL, x->mapSize, PROT_READ, MAP_PRIVATE, x->fd, 0);
+    if (x->map == MAP_FAILED)
+    {
+        close(x->fd);
+        x->fd = -1;
+        x->map = NULL;
+        return -1;
+    }
+
+    madvise(x->map, x->mapSize, MADV_SEQUENTIAL);
+    return 0;
+}
+
+int mf_wav_open(mf_wav *x, const char *path)
+{
+    if (mf_wav_map(x, path))
+        return -1;
+
+    const unsigned char *p = x->map;
+    const unsigned char *end = x->map + x->mapSize;
+
+    if (x->mapSize < 12 || memcmp(p, "RIFF", 4) || memcmp(p + 8, "WAVE", 4))
+        goto fail;
+
+    /* walk the chunks until the data chunk, the fmt chunk has to come first */
+    for (p += 12; p + 8 <= end; )
+    {
+        uint32_t size = mf_wav_u32(p + 4);
+        const unsigned char *body = p + 8;
+
+        if (!memcmp(p, "fmt ", 4))
+        {
+            if (size < 16 || body + size > end)
+                goto fail;
+            int tag = mf_wav_u16(body);
+            if (tag == 0xFFFE && size >= 26)
+                tag = mf_wav_u16(body + 24);
+            x->channels = mf_wav_u16(body + 2);
+            x->fs = mf_wav_u32(body + 4);
+            x->bits = mf_wav_u16(body + 14);
+            x->isFloat = tag == 3;
+            if ((tag != 1 && tag != 3) || x->channels < 1 || (x->isFloat && x->bits != 32))
+                goto fail;
+            if (!x->isFloat && x->bits != 16 && x->bits != 24 && x->bits != 32)
+                goto fail;
+        }
+        else if (!memcmp(p, "data", 4))
+        {
+            if (!x->channels)
+                goto fail;
+            /* files that were cut off or written while streaming can claim more data than they have */
+            long bytes = end - body < (long)size ? end - body : (long)size;
+            x->frames = bytes / (x->channels * (x->bits / 8));
+            x->data = (unsigned char *)body;
+            return 0;
+        }
+
+        if ((size_t)(end - body) < size + (size & 1))
+            break;
+        p = body + size + (size & 1);
+    }
+
+fail:
+    mf_wav_close(x);
+    return -1;
+}
+
+int mf_wav_openRaw(mf_wav *x, const char *path, int channels, int fs)
+{
+    if (channels < 1 || mf_wav_map(x, path))
+        return -1;
+
+    x->channels = channels;
+    x->bits = 32;
+    x->isFloat = 1;
+    x->fs = fs;
+    x->frames = x->mapSize / (4 * channels);
+    x->data = x->map;
+    return 0;
+}
+
+long mf_wav_read(mf_wav *x, float *mono, long frames)
+{
+    int bytes = x->bits / 8;
+    int frameBytes = bytes * x->channels;
+    float scale = 1.f / x->channels;
+
+    if (frames > x->frames - x->position)
+        frames = x->frames - x->position;
+
+    const unsigned char *p = x->data + x->position * frameBytes;
+
+    if (x->isFloat && x->channels == 1)
+        memcpy(mono, p, frames * sizeof(float));
+    else
+    {
+        for (long i = 0; i < frames; i++)
+        {
+            float sum = 0;
+            for (int c = 0; c < x->channels; c++, p += bytes)
+            {
+                if (x->isFloat)
+                {
+                    float f;
+                    memcpy(&f, p, 4);
+                    sum += f;
+                }
+                else if (bytes == 2)
+                    sum += (int16_t)mf_wav_u16(p) / 32768.f;
+                else if (bytes == 3)
+                    sum += (int32_t)((uint32_t)p[0] << 8 | (uint32_t)p[1] << 16 | (uint32_t)p[2] << 24) / 2147483648.f;
+                else
+                    sum += (int32_t)mf_wav_u32(p) / 2147483648.f;
+            }
+            mono[i] = sum * scale;
+        }
+    }
+
+    x->position += frames;
+
+    /* drop the pages that were already converted, so a long file does not fill the memory */
+    long consumed = (x->data - x->map) + x->position * frameBytes;
+    if (consumed - x->released >= MF_WAV_WINDOW)
+    {
+        long page = sysconf(_SC_PAGESIZE);
+        long aligned = consumed / page * page;
+        madvise(x->map + x->released, aligned - x->released, MADV_DONTNEED);
+        x->released = aligned;
+    }
+
+    return frames;
+}
+
+/* unmaps the current output window, starting its write back */
+static void mf_wav_retire(mf_wav *x)
+{
+    if (!x->map)
+        return;
+
+    msync(x->map, x->mapSize, MS_ASYNC);
+    munmap(x->map, x->mapSize);
+    x->map = NULL;
+
+#ifdef POSIX_FADV_DONTNEED
+    /* the window before has had a full window of time to be written, drop it from the cache */
+    if (x->mapOffset >= (long)x->mapSize)
+        posix_fadvise(x->fd, x->mapOffset - x->mapSize, x->mapSize, POSIX_FADV_DONTNEED);
+#endif
+}
+
+static int mf_wav_window(mf_wav *x, long offset)
+{
+    x->mapSize = MF_WAV_WINDOW;
+    x->mapOffset = offset;
+
+    if (ftruncate(x->fd, offset + MF_WAV_WINDOW))
+        return -1;
+
+    x->map = (unsigned char *)mmap(NULL, x->mapSize, PROT_READ | PROT_WRITE, MAP_SHARED, x->fd, offset);
+    if (x->map == MAP_FAILED)
+    {
+        x->map = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int mf_wav_create(mf_wav *x, const char *path, int channels, int fs)
+{
+    memset(x, 0, sizeof(mf_wav));
+
+    /* frames must not straddle two windows */
+    if (channels < 1 || channels > 2)
+        return -1;
+
+    x->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (x->fd < 0)
+        return -1;
+
+    x->channels = channels;
+    x->bits = 32;
+    x->isFloat = 1;
+    x->fs = fs;
+    x->writing = 1;
+
+    if (mf_wav_window(x, 0))
+    {
+        close(x->fd);
+        x->fd = -1;
+        return -1;
+    }
+
+    /* float files carry a fact chunk, which also puts the data on an 8 byte boundary */
+    unsigned char *header = x->map;
+    memcpy(header, "RIFF\0\0\0\0WAVEfmt ", 16);
+    mf_wav_put32(header + 16, 16);
+    header[20] = 3; header[21] = 0;
+    header[22] = channels; header[23] = 0;
+    mf_wav_put32(header + 24, fs);
+    mf_wav_put32(header + 28, fs * channels * 4);
+    header[32] = channels * 4; header[33] = 0;
+    header[34] = 32; header[35] = 0;
+    memcpy(header + 36, "fact", 4);
+    mf_wav_put32(header + 40, 4);
+    mf_wav_put32(header + 44, 0);
+    memcpy(header + 48, "data\0\0\0\0", 8);
+    return 0;
+}
+
+float *mf_wav_reserve(mf_wav *x, long frames, long *available)
+{
+    long frameBytes = 4 * x->channels;
+    long offset = MF_WAV_HEADER + x->frames * frameBytes;
+
+    if (offset + frameBytes > x->mapOffset + (long)x->mapSize || !x->map)
+    {
+        long next = x->mapOffset + x->mapSize;
+        mf_wav_retire(x);
+        if (mf_wav_window(x, next))
+            return NULL;
+    }
+
+    long room = (x->mapOffset + (long)x->mapSize - offset) / frameBytes;
+    *available = frames < room ? frames : room;
+    return (float *)(x->map + (offset - x->mapOffset));
+}
+
+void mf_wav_commit(mf_wav *x, long frames)
+{
+    x->frames += frames;
+}
+
+int mf_wav_write(mf_wav *x, const float *samples, long frames)
+{
+    while (frames > 0)
+    {
+        long available;
+        float *dest = mf_wav_reserve(x, frames, &available);
+        if (!dest)
+            return -1;
+        memcpy(dest, samples, available * 4 * x->channels);
+        mf_wav_commit(x, available);
+        samples += available * x->channels;
+        frames -= available;
+    }
+    return 0;
+}
+
+int mf_wav_close(mf_wav *x)
+{
+    int result = 0;
+
+    if (x->writing)
+    {
+        uint32_t data = x->frames * x->channels * 4;
+        unsigned char size[4];
+
+        mf_wav_retire(x);
+        if (ftruncate(x->fd, MF_WAV_HEADER + data))
+            result = -1;
+        else
+        {
+            mf_wav_put32(size, data + MF_WAV_HEADER - 8);
+            if (pwrite(x->fd, size, 4, 4) != 4)
+                result = -1;
+            mf_wav_put32(size, x->frames);
+            if (pwrite(x->fd, size, 4, 44) != 4)
+                result = -1;
+            mf_wav_put32(size, data);
+            if (pwrite(x->fd, size, 4, 52) != 4)
+                result = -1;
+        }
+    }
+    else if (x->map)
+        munmap(x->map, x->mapSize);
+
+    if (x->fd >= 0 && close(x->fd) && x->writing)
+        result = -1;
+    memset(x, 0, sizeof(mf_wav));
+    x->fd = -1;
+    return result;
+}
@@ -0,0 +1,149 @@
+/**
+ * @file mf_wav.h
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Reading and writing of WAV files <br>
+ * <br>
+ * @brief Memory mapped WAV file access for the offline tools <br>
+ * <br>
+ * mf_wav reads 16, 24 and 32 bit integer and 32 bit float WAV files as well <br>
+ * as headerless 32 bit float RAW files, and writes 32 bit float WAV files. <br>
+ * Both directions work on memory mappings: samples are converted straight <br>
+ * from the mapped input, and output is written straight into a mapped <br>
+ * window of the file. Already processed parts of both files are released <br>
+ * every MF_WAV_WINDOW bytes, so the resident memory stays bounded no matter <br>
+ * how long the files are. <br>
+ * <br>
+ */
+
+#ifndef mf_wav_h
+#define mf_wav_h
+#include <stdio.h>
+#include <stdlib.h>
+
+/** size of the mapped output windows and the release granularity of the input */
+#define MF_WAV_WINDOW (16 << 20)
+
+/**
+ * @struct mf_wav
+ * @brief A structure for an open WAV file <br>
+ * @var mf_wav::fd The file descriptor <br>
+ * @var mf_wav::channels The number of interleaved channels <br>
+ * @var mf_wav::bits The bits per sample <br>
+ * @var mf_wav::isFloat True for IEEE float samples <br>
+ * @var mf_wav::fs The sample rate <br>
+ * @var mf_wav::frames The number of frames in the file <br>
+ * @var mf_wav::position The index of the next frame <br>
+ * @var mf_wav::writing True for a file created with mf_wav_create <br>
+ * @var mf_wav::map The mapping of the input file or of the current output window <br>
+ * @var mf_wav::mapSize The size of the mapping in bytes <br>
+ * @var mf_wav::mapOffset The file offset of the mapping <br>
+ * @var mf_wav::data The first sample of the current mapping <br>
+ * @var mf_wav::released Bytes at the start of the input mapping that were already released <br>
+ */
+
+typedef struct mf_wav
+{
+    int fd;
+    int channels;
+    int bits;
+    int isFloat;
+    int fs;
+    long frames;
+    long position;
+    int writing;
+    unsigned char *map;
+    size_t mapSize;
+    long mapOffset;
+    unsigned char *data;
+    long released;
+} mf_wav;
+
+/**
+ * @related mf_wav
+ * @brief Opens a WAV file for reading<br>
+ * @param x My wav object <br>
+ * @param path The path of the file <br>
+ * @return 0 on success, -1 if the file can not be read <br>
+ */
+
+int mf_wav_open(mf_wav *x, const char *path);
+
+/**
+ * @related mf_wav
+ * @brief Opens a headerless file of 32 bit float samples for reading<br>
+ * @param x My wav object <br>
+ * @param path The path of the file <br>
+ * @param channels The number of interleaved channels <br>
+ * @param fs The sample rate <br>
+ * @return 0 on success, -1 if the file can not be read <br>
+ */
+
+int mf_wav_openRaw(mf_wav *x, const char *path, int channels, int fs);
+
+/**
+ * @related mf_wav
+ * @brief Reads frames and mixes them down to mono<br>
+ * @param x My wav object <br>
+ * @param mono The output vector <br>
+ * @param frames The maximum number of frames to read <br>
+ * @return the number of frames read, 0 at the end of the file <br>
+ */
+
+long mf_wav_read(mf_wav *x, float *mono, long frames);
+
+/**
+ * @related mf_wav
+ * @brief Creates a 32 bit float WAV file for writing<br>
+ * @param x My wav object <br>
+ * @param path The path of the file <br>
+ * @param channels The number of channels, 1 or 2 <br>
+ * @param fs The sample rate <br>
+ * @return 0 on success, -1 if the file can not be created <br>
+ */
+
+int mf_wav_create(mf_wav *x, const char *path, int channels, int fs);
+
+/**
+ * @related mf_wav
+ * @brief Gives direct access to the mapped file for the next frames<br>
+ * @param x My wav object <br>
+ * @param frames The number of frames the caller wants to write <br>
+ * @param available Returns how many frames fit, at most frames <br>
+ * @return a pointer to the interleaved samples in the file, NULL on error <br>
+ * The frames are only part of the file after mf_wav_commit <br>
+ */
+
+float *mf_wav_reserve(mf_wav *x, long frames, long *available);
+
+/**
+ * @related mf_wav
+ * @brief Appends frames written to the memory returned by mf_wav_reserve<br>
+ * @param x My wav object <br>
+ * @param frames The number of written frames <br>
+ */
+
+void mf_wav_commit(mf_wav *x, long frames);
+
+/**
+ * @related mf_wav
+ * @brief Appends interleaved frames to a file created with mf_wav_create<br>
+ * @param x My wav object <br>
+ * @param samples The interleaved samples <br>
+ * @param frames The number of frames <br>
+ * @return 0 on success, -1 on a write error <br>
+ */
+
+int mf_wav_write(mf_wav *x, const float *samples, long frames);
+
+/**
+ * @related mf_wav
+ * @brief Closes the file<br>
+ * @param x My wav object <br>
+ * The header of a written file is completed before closing <br>
+ * @return 0 on success, -1 if the header or the size of a written file could not be set <br>
+ */
+
+int mf_wav_close(mf_wav *x);
+
+#endif /* mf_wav_h */
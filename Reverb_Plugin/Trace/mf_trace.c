@@ -0,0 +1,149 @@
+#include "mf_trace.h"
+
+#ifdef MF_REVERB_TRACE
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+typedef struct mf_trace_event
+{
+    const char *name;
+    uint64_t start;
+    uint64_t end;
+} mf_trace_event;
+
+/* written by one thread only, the count is published after the event */
+typedef struct mf_trace_ring
+{
+    uint64_t count;
+    int thread;
+    mf_trace_event events[MF_TRACE_EVENTS];
+} mf_trace_ring;
+
+static mf_trace_ring *mf_trace_rings[MF_TRACE_THREADS];
+static int mf_trace_threads;
+static __thread mf_trace_ring *mf_trace_local;
+static __thread int mf_trace_full;
+
+uint64_t mf_trace_now(void)
+{
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (uint64_t)t.tv_sec * 1000000000u + t.tv_nsec;
+}
+
+static mf_trace_ring *mf_trace_claim(void)
+{
+    int index = __atomic_fetch_add(&mf_trace_threads, 1, __ATOMIC_RELAXED);
+    if (index >= MF_TRACE_THREADS)
+    {
+        mf_trace_full = 1;
+        return NULL;
+    }
+
+    mf_trace_ring *ring = (mf_trace_ring *)calloc(1, sizeof(mf_trace_ring));
+    if (!ring)
+    {
+        mf_trace_full = 1;
+        return NULL;
+    }
+    ring->thread = index + 1;
+    __atomic_store_n(&mf_trace_rings[index], ring, __ATOMIC_RELEASE);
+    return ring;
+}
+
+void mf_trace_record(const char *name, uint64_t start, uint64_t end)
+{
+    mf_trace_ring *ring = mf_trace_local;
+    if (!ring)
+    {
+        if (mf_trace_full)
+            return;
+        ring = mf_trace_local = mf_trace_claim();
+        if (!ring)
+            return;
+    }
+
+    mf_trace_event *e = &ring->events[ring->count & (MF_TRACE_EVENTS - 1)];
+    e->name = name;
+    e->start = start;
+    e->end = end;
+    __atomic_store_n(&ring->count, ring->count + 1, __ATOMIC_RELEASE);
+}
+
+/* names are C strings from the code or file names, only quotes, backslashes and control characters need escaping */
+static void mf_trace_writeName(FILE *f, const char *name)
+{
+    fputc('"', f);
+    for (const char *c = name; *c; c++)
+    {
+        if (*c == '"' || *c == '\\')
+            fprintf(f, "\\%c", *c);
+        else if ((unsigned char)*c < 0x20)
+            fprintf(f, "\\u%04x", *c);
+        else
+            fputc(*c, f);
+    }
+    fputc('"', f);
+}
+
+long mf_trace_write(const char *path)
+{
+    FILE *f = fopen(path, "w");
+    if (!f)
+        return -1;
+
+    int threads = __atomic_load_n(&mf_trace_threads, __ATOMIC_RELAXED);
+    if (threads > MF_TRACE_THREADS)
+        threads = MF_TRACE_THREADS;
+
+    /* timestamps start at the earliest event, Chrome expects microseconds */
+    uint64_t origin = UINT64_MAX;
+    for (int t = 0; t < threads; t++)
+    {
+        mf_trace_ring *ring = __atomic_load_n(&mf_trace_rings[t], __ATOMIC_ACQUIRE);
+        if (!ring)
+            continue;
+        uint64_t count = __atomic_load_n(&ring->count, __ATOMIC_ACQUIRE);
+        uint64_t first = count > MF_TRACE_EVENTS ? count - MF_TRACE_EVENTS : 0;
+        for (uint64_t i = first; i < count; i++)
+            if (ring->events[i & (MF_TRACE_EVENTS - 1)].start < origin)
+                origin = ring->events[i & (MF_TRACE_EVENTS - 1)].start;
+    }
+
+    long written = 0;
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[\n");
+
+    for (int t = 0; t < threads; t++)
+    {
+        mf_trace_ring *ring = __atomic_load_n(&mf_trace_rings[t], __ATOMIC_ACQUIRE);
+        if (!ring)
+            continue;
+
+        fprintf(f, "%s{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%d,\"args\":{\"name\":\"thread %d\"}}",
+                written ? ",\n" : "", ring->thread, ring->thread);
+        written++;
+
+        uint64_t count = __atomic_load_n(&ring->count, __ATOMIC_ACQUIRE);
+        uint64_t first = count > MF_TRACE_EVENTS ? count - MF_TRACE_EVENTS : 0;
+        for (uint64_t i = first; i < count; i++)
+        {
+            mf_trace_event *e = &ring->events[i & (MF_TRACE_EVENTS - 1)];
+            fprintf(f, ",\n{\"name\":");
+            mf_trace_writeName(f, e->name);
+            if (e->end)
+                fprintf(f, ",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f", (e->start - origin) * 1e-3, (e->end - e->start) * 1e-3);
+            else
+                fprintf(f, ",\"ph\":\"i\",\"s\":\"t\",\"ts\":%.3f", (e->start - origin) * 1e-3);
+            fprintf(f, ",\"pid\":1,\"tid\":%d}", ring->thread);
+            written++;
+        }
+    }
+
+    fprintf(f, "\n]}\n");
+    if (fclose(f))
+        return -1;
+    return written;
+}
+
+#endif /* MF_REVERB_TRACE */
@@ -0,0 +1,82 @@
+/**
+ * @file mf_trace.h
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Trace points <br>
+ * <br>
+ * @brief Records the time of every processing stage for a timeline view <br>
+ * <br>
+ * The trace points only exist if the code is compiled with -DMF_REVERB_TRACE, <br>
+ * otherwise the macros are empty and mf_trace.c does not need to be linked. <br>
+ * Every thread writes its events into its own ring of MF_TRACE_EVENTS events, <br>
+ * so recording takes no lock and only needs two clock reads. A full ring <br>
+ * overwrites its oldest events. The ring of a thread is allocated by its first <br>
+ * event, at most MF_TRACE_THREADS threads are recorded. mf_trace_write stores <br>
+ * the rings as Chrome trace JSON, which chrome://tracing and ui.perfetto.dev <br>
+ * open. Timestamps come from CLOCK_MONOTONIC, the clock Perfetto uses itself. <br>
+ * <br>
+ */
+
+#ifndef mf_trace_h
+#define mf_trace_h
+
+#define MF_TRACE_EVENTS 65536 /**< events per thread, a power of two */
+#define MF_TRACE_THREADS 64
+
+#ifdef MF_REVERB_TRACE
+#include <stdint.h>
+
+/**
+ * @brief Starts a stage, stores the current time in a new variable<br>
+ * @param start The name of the variable <br>
+ */
+
+#define MF_TRACE_BEGIN(start) uint64_t start = mf_trace_now()
+
+/**
+ * @brief Ends a stage that was started with MF_TRACE_BEGIN<br>
+ * @param start The variable of MF_TRACE_BEGIN <br>
+ * @param name The name of the stage, a string that lives until mf_trace_write <br>
+ */
+
+#define MF_TRACE_END(start, name) mf_trace_record((name), (start), mf_trace_now())
+
+/**
+ * @brief Records a single point in time, e.g. a parameter change<br>
+ * @param name The name of the event, a string that lives until mf_trace_write <br>
+ */
+
+#define MF_TRACE_INSTANT(name) mf_trace_record((name), mf_trace_now(), 0)
+
+/**
+ * @brief Returns the current time in nanoseconds<br>
+ */
+
+uint64_t mf_trace_now(void);
+
+/**
+ * @brief Adds an event to the ring of the calling thread<br>
+ * @param name The name of the event <br>
+ * @param start The start of the event in nanoseconds <br>
+ * @param end The end of the event, 0 for a single point in time <br>
+ */
+
+void mf_trace_record(const char *name, uint64_t start, uint64_t end);
+
+/**
+ * @brief Writes the events of all threads as Chrome trace JSON<br>
+ * @param path The output file <br>
+ * @return the number of events written, or -1 if the file can not be created <br>
+ * The threads should not record while their rings are written. <br>
+ */
+
+long mf_trace_write(const char *path);
+
+#else
+
+#define MF_TRACE_BEGIN(start)
+#define MF_TRACE_END(start, name)
+#define MF_TRACE_INSTANT(name)
+
+#endif /* MF_REVERB_TRACE */
+#endif /* mf_trace_h */
@@ -0,0 +1,55 @@
+#include "mf_velvet.h"
+#include "math.h"
+#include "mf_kernels.h"
+#include <string.h>
+
+mf_velvet *mf_velvet_new(void)
+{
+    mf_velvet *x = (mf_velvet *)malloc(sizeof(mf_velvet));
+    x->taps = 0;
+    x->counter = 0;
+    mf_velvet_clearBuffer(x);
+    return x;
+}
+
+void mf_velvet_free(mf_velvet *x)
+{
+    free(x);
+}
+
+/* a small generator of our own, so a seed gives the same sequence on every platform */
+static float mf_velvet_random(unsigned int *state)
+{
+    *state = *state * 1664525u + 1013904223u;
+    return (*state >> 8) / 16777216.f;
+}
+
+void mf_velvet_setSequence(mf_velvet *x, float length, int taps, unsigned int seed, float fs)
+{
+    if (taps > MF_VELVET_TAPS) taps = MF_VELVET_TAPS;
+    if (taps < 1) taps = 1;
+
+    float samples = length * fs;
+    if (samples > MF_VELVET_LENGTH - MF_VELVET_CHUNK) samples = MF_VELVET_LENGTH - MF_VELVET_CHUNK;
+    if (samples < taps) samples = taps;
+
+    float cell = samples / taps;
+    float scale = 1 / sqrtf(taps);
+
+    for (int t = 0; t < taps; t++)
+    {
+        x->position[t] = (int)(t * cell + mf_velvet_random(&seed) * (cell - 1) + .5f);
+        x->gain[t] = mf_velvet_random(&seed) < .5f ? -scale : scale;
+    }
+    x->taps = taps;
+}
+
+void mf_velvet_clearBuffer(mf_velvet *x)
+{
+    memset(x->buffer, 0, sizeof(x->buffer));
+}
+
+void mf_velvet_perform(mf_velvet *x, const float *in, float *out, int vectorSize)
+{
+    mf_kernels_runTaps(x->buffer, MF_VELVET_LENGTH, MF_VELVET_CHUNK, &x->counter, x->position, x->gain, x->taps, in, out, vectorSize, false);
+}
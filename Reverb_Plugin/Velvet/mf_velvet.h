@@ -0,0 +1,96 @@
+/**
+ * @file mf_velvet.h
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Velvet-noise decorrelator <br>
+ * <br>
+ * @brief Audio Object for a sparse FIR filter with random +1/-1 taps <br>
+ * <br>
+ * A velvet-noise sequence splits its length into one grid cell per tap and <br>
+ * puts a single pulse of random sign at a random position in every cell. <br>
+ * Filtering with it spreads the input over the length of the sequence with a <br>
+ * flat spectrum on average, and two sequences with different seeds give two <br>
+ * decorrelated outputs. This is the job of the allpass chains of mf_reverb, <br>
+ * with a few dozen taps instead of ten recursive stages per channel. The <br>
+ * delay line is mirrored like the one of mf_early, so all taps of a chunk go <br>
+ * to a single call of the tap kernel. <br>
+ * <br>
+ */
+
+#ifndef mf_velvet_h
+#define mf_velvet_h
+#include <stdio.h>
+#include <stdlib.h>
+
+#define MF_VELVET_TAPS 64
+#define MF_VELVET_LENGTH 4096 /**< length of the delay line, a power of two */
+#define MF_VELVET_CHUNK 512   /**< longer blocks are processed in chunks of this size */
+
+/**
+ * @struct mf_velvet
+ * @brief A structure for the velvet-noise decorrelator <br>
+ * @var mf_velvet::taps The number of taps <br>
+ * @var mf_velvet::counter The index of the next sample written to the delay line <br>
+ * @var mf_velvet::position The delays of the taps in samples <br>
+ * @var mf_velvet::gain The gains of the taps, +1 or -1 scaled to keep the energy <br>
+ * @var mf_velvet::buffer An array to store the delayed samples, followed by the mirrored start <br>
+ */
+
+typedef struct mf_velvet
+{
+    int taps;
+    int counter;
+    int position[MF_VELVET_TAPS];
+    float gain[MF_VELVET_TAPS];
+    float buffer[MF_VELVET_LENGTH + MF_VELVET_CHUNK];
+} mf_velvet;
+
+/**
+ * @related mf_velvet
+ * @brief Creates a new velvet-noise decorrelator without taps<br>
+ * @return a pointer to the newly created mf_velvet object <br>
+ */
+
+mf_velvet *mf_velvet_new(void);
+
+/**
+ * @related mf_velvet
+ * @brief Frees a velvet-noise decorrelator<br>
+ * @param x My velvet object <br>
+ */
+
+void mf_velvet_free(mf_velvet *x);
+
+/**
+ * @related mf_velvet
+ * @brief Generates a velvet-noise sequence <br>
+ * @param x My velvet object <br>
+ * @param length The length of the sequence in seconds <br>
+ * @param taps The number of pulses, at most MF_VELVET_TAPS <br>
+ * @param seed The seed of the pulse positions and signs, the same seed gives the same sequence <br>
+ * @param fs The sample rate <br>
+ * Sequences longer than the delay line allows are shortened <br>
+ */
+
+void mf_velvet_setSequence(mf_velvet *x, float length, int taps, unsigned int seed, float fs);
+
+/**
+ * @related mf_velvet
+ * @brief Clears the delay line<br>
+ * @param x My velvet object <br>
+ */
+
+void mf_velvet_clearBuffer(mf_velvet *x);
+
+/**
+ * @related mf_velvet
+ * @brief Filters a block with the sequence <br>
+ * @param x My velvet object <br>
+ * @param in The input vector <br>
+ * @param out The output vector, may be the input <br>
+ * @param vectorSize The vectorSize <br>
+ */
+
+void mf_velvet_perform(mf_velvet *x, const float *in, float *out, int vectorSize);
+
+#endif /* mf_velvet_h */
@@ -14,10 +14,15 @@
 
 
 #include "m_pd.h"
-#include "mf_allpass.h"
-#include "mf_comb.h"
+#include "mf_reverb.h"
+#include "mf_kernels.h"
+#include "mf_reverb_send_pd.h"
 #include <math.h>
 #include <stdbool.h>
+#include <string.h>
+
+#define MF_REVERB_TILDE_DRAIN 100 /**< ms between two drains of the diagnostics ring */
+#define MF_REVERB_TILDE_METER 50  /**< default ms between two lists of the meter outlet */
 
 static t_class *mf_reverb_tilde_class;
 
@@ -28,10 +33,15 @@ static t_class *mf_reverb_tilde_class;
  * @var mf_reverb_tilde::x_obj Necessary for every signal object in Pure Data <br>
  * @var mf_reverb_tilde::f Also necessary for signal objects, float dummy dataspace <br>
  * for converting a float to signal if no signal is connected (CLASS_MAINSIGNALIN) <br>
- * @var mf_reverb_tilde::mf_allpass The comb filter object for the processing <br>
- * @var mf_reverb_tilde::mf_comb The comb filter object for the processing <br>
- * @var mf_reverb_tilde::wetlevel The value of how wet/dry the mix is <br>
+ * @var mf_reverb_tilde::reverb The reverb engine holding the comb and allpass filters <br>
  * @var mf_reverb_tilde::off The boolean object for the resetting of the output <br>
+ * @var mf_reverb_tilde::signalInlets True if wet and level come from signal inlets (-sig) <br>
+ * @var mf_reverb_tilde::snapshot The slot of the snapshot message, allocated when first used <br>
+ * @var mf_reverb_tilde::bus The bus of the mf_reverb_send~ objects that is processed as well, or NULL <br>
+ * @var mf_reverb_tilde::clock The clock that drains the diagnostics ring on the main thread <br>
+ * @var mf_reverb_tilde::meterClock The clock that sends the meter <br>
+ * @var mf_reverb_tilde::meterInterval The ms between two lists of the meter outlet, 0 for none <br>
+ * @var mf_reverb_tilde::x_meter The control outlet of the meter (-meter), or NULL <br>
  * @var mf_reverb_tilde::x_outl A signal outlet for the processed left signal <br>
  * @var mf_reverb_tilde::x_outr A signal outlet for the processed right signal
  */
@@ -40,29 +50,30 @@ typedef struct mf_reverb_tilde
 {
     t_object  x_obj;
     t_sample f;
-    mf_allpass *allpass[40];
-    mf_comb *comb[4];
-    float t60;
-    t_sample level;
-    float wetLevel;
+    mf_reverb *reverb;
     bool off;
+    bool signalInlets;
+    mf_reverb_snapshot *snapshot;
+    mf_reverb_bus *bus;
+    t_clock *clock;
+    t_clock *meterClock;
+    float meterInterval;
     t_outlet *x_outl;
     t_outlet *x_outr;
+    t_outlet *x_meter;
 
     
 } mf_reverb_tilde;
 
+void mf_reverb_tilde_drain(mf_reverb_tilde* x);
+void mf_reverb_tilde_sendMeter(mf_reverb_tilde* x);
+
 
 /**
  * @related mf_reverb_tilde
  * @brief Calculates the output vector including reverb effect<br>
  * @param w A pointer to the object, input and output vectors.<br>
- * @var mf_reverb_tilde_perform::comb_out1[n] Output of comb filter 1 <br>
- * @var mf_reverb_tilde_perform::comb_out2[n] Output of comb filter 2 <br>
- * @var mf_reverb_tilde_perform::comb_out3[n] Output of comb filter 3 <br>
- * @var mf_reverb_tilde_perform::comb_out4[n] Output of comb filter 4 <br>
- * @var mf_reverb_tilde_perform::buffer1[n] Output buffer 1 <br>
- * @var mf_reverb_tilde_perform::buffer2[n] Output buffer 2 <br>
+ * The processing itself is done by mf_reverb_perform <br>
  * @var mf_reverb_tilde_perform::off The boolean object for the resetting of the output <br>
  * @var mf_reverb_tilde::x_outl A signal outlet for the processed left signal <br>
  * @var mf_reverb_tilde::x_outr A signal outlet for the processed right signal
@@ -78,58 +89,24 @@ t_int *mf_reverb_tilde_perform(t_int *w)
     
     mf_reverb_tilde *x = (mf_reverb_tilde *)(w[1]);
     t_sample  *in = (t_sample *)(w[2]);
-    t_sample  *outl =  (t_sample *)(w[3]);
-    t_sample  *outr =  (t_sample *)(w[4]);
-    int n =  (int)(w[5]);
-    
-    
-        
-    t_sample comb_out1[n];
-    t_sample comb_out2[n];
-    t_sample comb_out3[n];
-    t_sample comb_out4[n];
-    t_sample buffer1[n];
-    t_sample buffer2[n];
-    
-    
-    for (int i = 0; i < n; i++)
-    {
-        comb_out1[i] = 0;
-        comb_out2[i] = 0;
-        comb_out3[i] = 0;
-        comb_out4[i] = 0;
-        buffer1[i] = 0;
-        buffer2[i] = 0;
-    }
-    
-    mf_comb_perform(x->comb[0], in, comb_out1, n);
-    mf_comb_perform(x->comb[1], in, comb_out2, n);
-    mf_comb_perform(x->comb[2], in, comb_out3, n);
-    mf_comb_perform(x->comb[3], in, comb_out4, n);
-    
-    /* Assigns the values of the summed comb-filtered signals to buffer1 and buffer2 */
-    for (int i = 0; i<n; i++)
-    {
-        buffer1[i] = (comb_out1[i] + comb_out2[i] + comb_out3[i] + comb_out4[i])/4;
-        buffer2[i] = buffer1[i];
-    }
+    t_sample  *wet = (t_sample *)(w[3]);
+    t_sample  *level = (t_sample *)(w[4]);
+    t_sample  *outl =  (t_sample *)(w[5]);
+    t_sample  *outr =  (t_sample *)(w[6]);
+    int n =  (int)(w[7]);
+    t_sample *send = NULL;
+
+    if (x->bus && n <= x->bus->size)
+        send = x->bus->vec;
+
+    mf_reverb_performSignal(x->reverb, in, send, wet, level, outl, outr, n);
+
+    /* the sends of the next block sum into a cleared bus */
+    if (send)
+        memset(send, 0, n * sizeof(t_sample));
 
-    /* separates the allpass-filtered signals to the buffer1 and buffer2  */
-    for( int i = 0; i<20; i++)
-    {
-        if (i % 2 == 0) mf_allpass_perform(x->allpass[i], buffer1, buffer1, n);
-        else mf_allpass_perform(x->allpass[i], buffer2, buffer2, n);
-    }
-    
-    /* The original signal is mixed with the processed signal */
-    for(int i = 0; i<n; i++)
-    {
-        outl[i] = x->level * (in[i] + x->wetLevel * buffer1[i]) ;
-        outr[i] = x->level * (in[i] + x->wetLevel * buffer2[i]);
-    }
-    
     /* return a pointer to the dataspace for the next dsp-object */
-    return (w+6);
+    return (w+8);
 }
 
 /**
@@ -141,7 +118,12 @@ t_int *mf_reverb_tilde_perform(t_int *w)
  */
 void mf_reverb_tilde_dsp(mf_reverb_tilde *x, t_signal **sp)
 {
-    dsp_add(mf_reverb_tilde_perform, 5, x, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec , sp[0]->s_n);
+    if (x->bus)
+        mf_reverb_bus_resize(x->bus, sp[0]->s_n);
+    if (x->signalInlets)
+        dsp_add(mf_reverb_tilde_perform, 7, x, sp[0]->s_vec, sp[1]->s_vec, sp[2]->s_vec, sp[3]->s_vec, sp[4]->s_vec, sp[0]->s_n);
+    else
+        dsp_add(mf_reverb_tilde_perform, 7, x, sp[0]->s_vec, NULL, NULL, sp[1]->s_vec, sp[2]->s_vec, sp[0]->s_n);
 }
 
 /**
@@ -153,18 +135,18 @@ void mf_reverb_tilde_dsp(mf_reverb_tilde *x, t_signal **sp)
  */
 void mf_reverb_tilde_free(mf_reverb_tilde *x)
 {
-    for (int i = 0; i < 4; i++)
-    {
-        mf_comb_free(x->comb[i]);
-    }
-    
-    for (int i = 0; i < 40; i++) 
-    {
-        mf_allpass_free(x->allpass[i]);
-    }
+    mf_reverb_free(x->reverb);
+    if (x->snapshot)
+        mf_reverb_snapshot_free(x->snapshot);
+    if (x->bus)
+        mf_reverb_bus_release(x->bus, 1);
+    clock_free(x->clock);
+    clock_free(x->meterClock);
     
     outlet_free(x->x_outl);
     outlet_free(x->x_outr);
+    if (x->x_meter)
+        outlet_free(x->x_meter);
     
 }
 
@@ -173,18 +155,18 @@ void mf_reverb_tilde_free(mf_reverb_tilde *x)
  * @brief Panic button to mute output<br>
  * @param x A pointer the mf_reverb_tilde object <br>
  * The function mutes output<br>
- * of the reverb object
+ * of the reverb object, faded over MF_REVERB_SMOOTH
  */
 void mf_reverb_tilde_panic(mf_reverb_tilde *x)
 {
     if (x->off == false)
     {
-        x->level = 0;
+        mf_reverb_setLevel(x->reverb, 0);
         x->off = true;
     }
     else
     {
-        x->level = 1;
+        mf_reverb_setLevel(x->reverb, 1);
         x->off = false;
     }
 }
@@ -192,37 +174,55 @@ void mf_reverb_tilde_panic(mf_reverb_tilde *x)
 /**
  * @related mf_reverb_tilde
  * @brief Creates a new mf_reverb_tilde object.<br>
- * @param f sets the reverberation time in seconds. <br>
+ * @param s The name of the class <br>
+ * @param argc The number of creation arguments <br>
+ * @param argv The reverberation time in seconds and the optional flag -sig, <br>
+ * which adds signal inlets for the wet level (0 to 100) and the output level, <br>
+ * and -meter, which adds a control outlet for the meter that starts sending <br>
+ * every MF_REVERB_TILDE_METER ms <br>
  * For more information please refer to the <a href = "https://github.com/pure-data/externals-howto" > Pure Data Docs </a> <br>
  */
-void *mf_reverb_tilde_new(t_floatarg f)
+void *mf_reverb_tilde_new(t_symbol *s, int argc, t_atom *argv)
 {
+    (void)s;
     mf_reverb_tilde *x = (mf_reverb_tilde *)pd_new(mf_reverb_tilde_class);
-    //The main inlet is created automatically
-    x->x_outl = outlet_new(&x->x_obj, &s_signal);
-    x->x_outr = outlet_new(&x->x_obj, &s_signal);
-    x->t60 = f;
-    x->level = 1;
-    x->off = false;
+    float t60 = 0;
+    bool meter = false;
 
-    for (int i = 0; i<4; i++)
+    x->signalInlets = false;
+    for (int i = 0; i < argc; i++)
     {
-        x->comb[i] = mf_comb_new();
-        mf_comb_setDelay(x-> comb[i], floor((.03 + i*.005) * sys_getsr()));
-        mf_comb_setGain(x-> comb[i], x->t60, sys_getsr());
-        mf_comb_clearBuffer(x->comb[i]);
+        if (argv[i].a_type == A_FLOAT)
+            t60 = atom_getfloatarg(i, argc, argv);
+        else if (atom_getsymbolarg(i, argc, argv) == gensym("-sig"))
+            x->signalInlets = true;
+        else if (atom_getsymbolarg(i, argc, argv) == gensym("-meter"))
+            meter = true;
     }
-    
-    
-    int dly_allpass[40] = {262,171,355,290,244,327,487,251,162,592,313,432,502,616,340,85,291,119,450,52,336,350,326,159,350,482,485,380,468,222,74,309,403,399,163,183,330,321,73,226};
-    
-  
 
-    for(int i = 0; i < 40; i++)
+    //The main inlet is created automatically
+    if (x->signalInlets)
+    {
+        signalinlet_new(&x->x_obj, 0);
+        signalinlet_new(&x->x_obj, 1);
+    }
+    x->x_outl = outlet_new(&x->x_obj, &s_signal);
+    x->x_outr = outlet_new(&x->x_obj, &s_signal);
+    x->x_meter = meter ? outlet_new(&x->x_obj, &s_list) : NULL;
+    x->off = false;
+    x->bus = NULL;
+    x->snapshot = NULL;
+    x->reverb = mf_reverb_new(t60, sys_getsr());
+    if (sys_getsr() > MF_REVERB_MAX_FS)
+        pd_error(x, "mf_reverb~: above %d Hz the longest combs are shortened", MF_REVERB_MAX_FS);
+    x->clock = clock_new(x, (t_method)mf_reverb_tilde_drain);
+    x->meterClock = clock_new(x, (t_method)mf_reverb_tilde_sendMeter);
+    x->meterInterval = 0;
+    if (meter)
     {
-        x->allpass[i] = mf_allpass_new();
-        mf_allpass_setDelay(x-> allpass[i], dly_allpass[i]);
-        mf_allpass_clearBuffer(x->allpass[i]);
+        x->meterInterval = MF_REVERB_TILDE_METER;
+        mf_reverb_setMetering(x->reverb, true);
+        clock_delay(x->meterClock, x->meterInterval);
     }
     
     return (void *)x;
@@ -234,11 +234,330 @@ void *mf_reverb_tilde_new(t_floatarg f)
  * @param x A pointer the mf_reverb_tilde object <br>
  * @param wet Value from the slider to set wet level <br>
  * The function sets the wet level<br>
- * of the reverb object
+ * of the reverb object, smoothed over MF_REVERB_SMOOTH
  */
 void mf_reverb_tilde_wet(mf_reverb_tilde* x, float wet)
 {
-    x->wetLevel = wet/200;
+    mf_reverb_setWet(x->reverb, wet);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Modulates the delays of the comb and allpass filters<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * @param depth The modulation depth in milliseconds, 0 turns it off <br>
+ * @param rate The LFO frequency in Hz <br>
+ * Every filter gets a slightly detuned rate and its own start phase, <br>
+ * so the modulation does not move all delays in parallel
+ */
+void mf_reverb_tilde_mod(mf_reverb_tilde* x, float depth, float rate)
+{
+    mf_reverb_setModulation(x->reverb, depth, rate);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Switches between float and fixed-point processing<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * @param on 1 for the Q15 filters, 0 for float <br>
+ */
+void mf_reverb_tilde_fixed(mf_reverb_tilde* x, float on)
+{
+    mf_reverb_setFixedPoint(x->reverb, on != 0);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Calculates the early reflections of a shoebox room<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * @param width The width of the room in metres, 0 turns the early reflections off <br>
+ * @param depth The depth of the room in metres <br>
+ * @param height The height of the room in metres <br>
+ * @param reflection The reflection coefficient of the walls from 0 to 1 <br>
+ */
+void mf_reverb_tilde_room(mf_reverb_tilde* x, float width, float depth, float height, float reflection)
+{
+    if (width <= 0 || depth <= 0 || height <= 0)
+        mf_reverb_setTaps(x->reverb, NULL, NULL, 0);
+    else
+        mf_reverb_setRoom(x->reverb, width, depth, height, reflection);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Loads the early reflections from a Pd array<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * @param name The name of an array holding pairs of delay in ms and gain, <br>
+ * no name turns the early reflections off <br>
+ */
+void mf_reverb_tilde_taps(mf_reverb_tilde* x, t_symbol *name)
+{
+    float time[MF_EARLY_TAPS], gain[MF_EARLY_TAPS];
+    t_garray *array;
+    t_word *vec;
+    int points;
+
+    if (name == &s_)
+    {
+        mf_reverb_setTaps(x->reverb, NULL, NULL, 0);
+        return;
+    }
+    if (!(array = (t_garray *)pd_findbyclass(name, garray_class)) || !garray_getfloatwords(array, &points, &vec))
+    {
+        pd_error(x, "mf_reverb~: %s: no such array", name->s_name);
+        return;
+    }
+
+    int taps = points / 2 < MF_EARLY_TAPS ? points / 2 : MF_EARLY_TAPS;
+    if (points / 2 > MF_EARLY_TAPS)
+        pd_error(x, "mf_reverb~: %s: only the first %d taps are used", name->s_name, MF_EARLY_TAPS);
+
+    for (int t = 0; t < taps; t++)
+    {
+        time[t] = vec[2 * t].w_float;
+        gain[t] = vec[2 * t + 1].w_float;
+    }
+    mf_reverb_setTaps(x->reverb, time, gain, taps);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Processes the bus of mf_reverb_send~ objects<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * @param name The name of the bus, no name stops reading a bus <br>
+ * The bus is processed like the main input, but not mixed into the dry signal <br>
+ */
+void mf_reverb_tilde_bus(mf_reverb_tilde* x, t_symbol *name)
+{
+    if (x->bus)
+        mf_reverb_bus_release(x->bus, 1);
+    x->bus = name == &s_ ? NULL : mf_reverb_bus_get(name, 1);
+    canvas_update_dsp();
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Saves the complete state of the reverb, including the tail<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * The slot is allocated with the first snapshot and reused afterwards <br>
+ */
+void mf_reverb_tilde_snapshot(mf_reverb_tilde* x)
+{
+    if (!x->snapshot)
+        x->snapshot = mf_reverb_snapshot_new();
+    mf_reverb_save(x->reverb, x->snapshot);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Goes back to the state of the last snapshot<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ */
+void mf_reverb_tilde_restore(mf_reverb_tilde* x)
+{
+    if (!x->snapshot || mf_reverb_restore(x->reverb, x->snapshot))
+        pd_error(x, "mf_reverb~: no snapshot to restore at this sample rate");
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Switches between the allpass chains and the velvet-noise decorrelators<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * @param on 1 for velvet noise, 0 for the allpass chains <br>
+ */
+void mf_reverb_tilde_velvet(mf_reverb_tilde* x, float on)
+{
+    mf_reverb_setVelvet(x->reverb, on != 0);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Freezes the current tail<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * @param on 1 to sustain the tail forever and ignore the input, 0 to release it <br>
+ * The comb delay lines are replayed without feedback arithmetic, see mf_reverb_setFreeze <br>
+ */
+void mf_reverb_tilde_freeze(mf_reverb_tilde* x, float on)
+{
+    mf_reverb_setFreeze(x->reverb, on != 0);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Switches the delay lines between float and half precision<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * @param on 1 for half precision, 0 for float <br>
+ */
+void mf_reverb_tilde_half(mf_reverb_tilde* x, float on)
+{
+    mf_reverb_setHalf(x->reverb, on != 0);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Sets the CPU budget of the adaptive mode<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * @param percent The allowed processing time in percent of the block period, <br>
+ * 0 turns the adaptive mode off <br>
+ * Under pressure allpass stages are faded out, see mf_reverb_setBudget <br>
+ */
+void mf_reverb_tilde_budget(mf_reverb_tilde* x, float percent)
+{
+    mf_reverb_setBudget(x->reverb, percent / 100);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Prints the measured load and the number of allpass stages in use<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ */
+void mf_reverb_tilde_load(mf_reverb_tilde* x)
+{
+    mf_reverb *r = x->reverb;
+    if (r->budget > 0)
+        post("mf_reverb~: load %.1f%% of %.1f%%, %d of %d allpass stages", 100 * r->load, 100 * r->budget, r->stages, MF_REVERB_STAGES);
+    else
+        post("mf_reverb~: no budget, %d of %d allpass stages", r->stages, MF_REVERB_STAGES);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Prints how often an infinite or NaN output was recovered<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ */
+void mf_reverb_tilde_recoveries(mf_reverb_tilde* x)
+{
+    post("mf_reverb~: %ld blocks recovered, %ld delay lines cleared", x->reverb->recoveries, x->reverb->clearedLines);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Posts the events of the diagnostics ring<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * Called by the clock every MF_REVERB_TILDE_DRAIN ms. Overruns, clipping and <br>
+ * denormals come in every block they last, so they are summed up per drain <br>
+ */
+void mf_reverb_tilde_drain(mf_reverb_tilde* x)
+{
+    mf_diag *d = x->reverb->diag;
+    mf_diag_event e;
+    int count[MF_DIAG_TYPES] = {0};
+    uint32_t first[MF_DIAG_TYPES];
+    float worst[MF_DIAG_TYPES];
+
+    while (mf_diag_pop(d, &e))
+    {
+        if (e.type == MF_DIAG_RECOVERY)
+            post("mf_reverb~: block %u: %s, %g delay lines cleared", e.block, mf_diag_name(e.type), e.value);
+        else if (e.type == MF_DIAG_STAGES)
+            post("mf_reverb~: block %u: %s %g of %d", e.block, mf_diag_name(e.type), e.value, MF_REVERB_STAGES);
+        else if (count[e.type]++ == 0)
+        {
+            first[e.type] = e.block;
+            worst[e.type] = e.value;
+        }
+        else if (e.value > worst[e.type])
+            worst[e.type] = e.value;
+    }
+
+    if (count[MF_DIAG_OVERRUN])
+        post("mf_reverb~: %d %s blocks from block %u, up to %.0f%% of the block period",
+             count[MF_DIAG_OVERRUN], mf_diag_name(MF_DIAG_OVERRUN), first[MF_DIAG_OVERRUN], 100 * worst[MF_DIAG_OVERRUN]);
+    if (count[MF_DIAG_CLIP])
+        post("mf_reverb~: %d %s blocks from block %u, peak %.2f",
+             count[MF_DIAG_CLIP], mf_diag_name(MF_DIAG_CLIP), first[MF_DIAG_CLIP], worst[MF_DIAG_CLIP]);
+    if (count[MF_DIAG_DENORMAL])
+        post("mf_reverb~: %d %s blocks from block %u, up to %.0f%% of the samples",
+             count[MF_DIAG_DENORMAL], mf_diag_name(MF_DIAG_DENORMAL), first[MF_DIAG_DENORMAL], 100 * worst[MF_DIAG_DENORMAL]);
+
+    uint32_t dropped = mf_diag_dropped(d);
+    if (dropped)
+        post("mf_reverb~: %u diagnostics events dropped", dropped);
+
+    if (x->reverb->diagnostics)
+        clock_delay(x->clock, MF_REVERB_TILDE_DRAIN);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Switches the diagnostics of the audio thread on or off<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * @param on 1 to post overruns, clipping, denormals, recoveries and stage changes, 0 to stop <br>
+ * The perform routine only pushes events into a lock-free ring, the clock posts them <br>
+ */
+void mf_reverb_tilde_diag(mf_reverb_tilde* x, float on)
+{
+    mf_reverb_setDiagnostics(x->reverb, on != 0);
+    if (on != 0)
+        clock_delay(x->clock, MF_REVERB_TILDE_DRAIN);
+    else
+        clock_unset(x->clock);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Sends the meter through the meter outlet<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * Called by the meter clock. The list holds the linear peak of wet left and right, <br>
+ * the RMS of wet left and right, then the peak and RMS of both outputs the same way, <br>
+ * all measured since the last list. Without new blocks nothing is sent <br>
+ */
+void mf_reverb_tilde_sendMeter(mf_reverb_tilde* x)
+{
+    float peak[4], rms[4];
+    t_atom list[8];
+
+    if (mf_reverb_readMeter(x->reverb, peak, rms) > 0)
+    {
+        for (int c = 0; c < 2; c++)
+        {
+            SETFLOAT(&list[c], peak[c]);
+            SETFLOAT(&list[2 + c], rms[c]);
+            SETFLOAT(&list[4 + c], peak[2 + c]);
+            SETFLOAT(&list[6 + c], rms[2 + c]);
+        }
+        outlet_list(x->x_meter, &s_list, 8, list);
+    }
+
+    if (x->meterInterval > 0)
+        clock_delay(x->meterClock, x->meterInterval);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Sets how often the meter outlet sends<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * @param ms The ms between two lists, 0 stops the meter <br>
+ * The peaks and RMS values are measured in the mix kernel while it writes the outputs <br>
+ */
+void mf_reverb_tilde_meter(mf_reverb_tilde* x, float ms)
+{
+    if (!x->x_meter)
+    {
+        pd_error(x, "mf_reverb~: create the object with -meter for a meter outlet");
+        return;
+    }
+
+    x->meterInterval = ms > 0 ? ms : 0;
+    mf_reverb_setMetering(x->reverb, ms > 0);
+    if (ms > 0)
+        clock_delay(x->meterClock, x->meterInterval);
+    else
+        clock_unset(x->meterClock);
+}
+
+/**
+ * @related mf_reverb_tilde
+ * @brief Forces the instruction set of the DSP kernels<br>
+ * @param x A pointer the mf_reverb_tilde object <br>
+ * @param isa scalar, sse2, avx2, avx512 or auto for the best supported one <br>
+ * The kernels are shared, so this affects all mf_reverb~ objects <br>
+ */
+void mf_reverb_tilde_isa(mf_reverb_tilde* x, t_symbol *isa)
+{
+    if (mf_kernels_select(strcmp(isa->s_name, "auto") ? isa->s_name : NULL))
+        pd_error(x, "mf_reverb~: %s kernels are not supported on this CPU", isa->s_name);
+    post("mf_reverb~: using %s kernels", mf_kernels_current.name);
 }
 
 /**
@@ -248,18 +567,40 @@ void mf_reverb_tilde_wet(mf_reverb_tilde* x, float wet)
  */
 void mf_reverb_tilde_setup(void)
 {
+    if (mf_kernels_select(NULL))
+        post("mf_reverb~: MF_REVERB_ISA=%s is not supported on this CPU", getenv("MF_REVERB_ISA"));
+    post("mf_reverb~: using %s kernels", mf_kernels_current.name);
+
       mf_reverb_tilde_class = class_new(gensym("mf_reverb~"),
             (t_newmethod)mf_reverb_tilde_new,
             (t_method)mf_reverb_tilde_free,
         sizeof(mf_reverb_tilde),
             CLASS_DEFAULT,
-            A_DEFFLOAT, 0);
+            A_GIMME, 0);
 
     class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_dsp, gensym("dsp"), 0);
     class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_wet, gensym("wet"), A_DEFFLOAT,0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_mod, gensym("mod"), A_DEFFLOAT, A_DEFFLOAT, 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_fixed, gensym("fixed"), A_DEFFLOAT, 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_room, gensym("room"), A_DEFFLOAT, A_DEFFLOAT, A_DEFFLOAT, A_DEFFLOAT, 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_taps, gensym("taps"), A_DEFSYM, 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_bus, gensym("bus"), A_DEFSYM, 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_snapshot, gensym("snapshot"), 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_restore, gensym("restore"), 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_isa, gensym("isa"), A_DEFSYM, 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_velvet, gensym("velvet"), A_DEFFLOAT, 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_half, gensym("half"), A_DEFFLOAT, 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_freeze, gensym("freeze"), A_DEFFLOAT, 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_budget, gensym("budget"), A_DEFFLOAT, 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_load, gensym("load"), 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_recoveries, gensym("recoveries"), 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_diag, gensym("diag"), A_DEFFLOAT, 0);
+    class_addmethod(mf_reverb_tilde_class, (t_method)mf_reverb_tilde_meter, gensym("meter"), A_DEFFLOAT, 0);
     class_addbang(mf_reverb_tilde_class, mf_reverb_tilde_panic);
     
 
 
       CLASS_MAINSIGNALIN(mf_reverb_tilde_class, mf_reverb_tilde, f);
+
+    mf_reverb_send_tilde_setup();
 }
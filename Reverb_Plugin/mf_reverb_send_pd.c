@@ -0,0 +1,158 @@
+#include "m_pd.h"
+#include "mf_reverb_send_pd.h"
+#include <string.h>
+
+static t_class *mf_reverb_bus_class;
+static t_class *mf_reverb_send_tilde_class;
+
+mf_reverb_bus *mf_reverb_bus_get(t_symbol *name, int isReturn)
+{
+    mf_reverb_bus *x = (mf_reverb_bus *)pd_findbyclass(name, mf_reverb_bus_class);
+
+    if (!x)
+    {
+        x = (mf_reverb_bus *)pd_new(mf_reverb_bus_class);
+        x->name = name;
+        x->users = 0;
+        x->returns = 0;
+        x->size = 0;
+        x->vec = NULL;
+        pd_bind(&x->b_pd, name);
+    }
+
+    x->users++;
+    if (isReturn)
+        x->returns++;
+    return x;
+}
+
+void mf_reverb_bus_release(mf_reverb_bus *x, int isReturn)
+{
+    if (isReturn)
+        x->returns--;
+    if (--x->users > 0)
+        return;
+
+    pd_unbind(&x->b_pd, x->name);
+    if (x->vec)
+        freebytes(x->vec, x->size * sizeof(t_sample));
+    pd_free(&x->b_pd);
+}
+
+void mf_reverb_bus_resize(mf_reverb_bus *x, int n)
+{
+    if (n <= x->size)
+        return;
+
+    if (x->vec)
+        freebytes(x->vec, x->size * sizeof(t_sample));
+    x->vec = (t_sample *)getbytes(n * sizeof(t_sample));
+    memset(x->vec, 0, n * sizeof(t_sample));
+    x->size = n;
+}
+
+
+/**
+ * @struct mf_reverb_send_tilde
+ * @brief The Pure Data struct of the mf_reverb_send~ object. <br>
+ * @var mf_reverb_send_tilde::x_obj Necessary for every signal object in Pure Data <br>
+ * @var mf_reverb_send_tilde::f Float dummy dataspace for the signal inlet <br>
+ * @var mf_reverb_send_tilde::bus The bus the signal is summed into <br>
+ */
+
+typedef struct mf_reverb_send_tilde
+{
+    t_object x_obj;
+    t_sample f;
+    mf_reverb_bus *bus;
+} mf_reverb_send_tilde;
+
+/**
+ * @related mf_reverb_send_tilde
+ * @brief Adds the input vector to the bus<br>
+ * @param w A pointer to the object, input vector and vector size.<br>
+ */
+
+t_int *mf_reverb_send_tilde_perform(t_int *w)
+{
+    mf_reverb_send_tilde *x = (mf_reverb_send_tilde *)(w[1]);
+    t_sample *in = (t_sample *)(w[2]);
+    int n = (int)(w[3]);
+    mf_reverb_bus *bus = x->bus;
+
+    /* nothing clears the bus without a return */
+    if (bus->returns > 0 && n <= bus->size)
+    {
+        t_sample *vec = bus->vec;
+        for (int i = 0; i < n; i++)
+            vec[i] += in[i];
+    }
+
+    return (w+4);
+}
+
+/**
+ * @related mf_reverb_send_tilde
+ * @brief Adds mf_reverb_send_tilde_perform to the signal chain. <br>
+ * @param x A pointer the mf_reverb_send_tilde object <br>
+ * @param sp A pointer the input vector <br>
+ */
+void mf_reverb_send_tilde_dsp(mf_reverb_send_tilde *x, t_signal **sp)
+{
+    mf_reverb_bus_resize(x->bus, sp[0]->s_n);
+    dsp_add(mf_reverb_send_tilde_perform, 3, x, sp[0]->s_vec, sp[0]->s_n);
+}
+
+/**
+ * @related mf_reverb_send_tilde
+ * @brief Sends to another bus<br>
+ * @param x A pointer the mf_reverb_send_tilde object <br>
+ * @param name The name of the bus <br>
+ * The vector of the new bus is resized with the next DSP update <br>
+ */
+void mf_reverb_send_tilde_set(mf_reverb_send_tilde *x, t_symbol *name)
+{
+    mf_reverb_bus *bus = mf_reverb_bus_get(name, 0);
+    mf_reverb_bus_release(x->bus, 0);
+    x->bus = bus;
+    canvas_update_dsp();
+}
+
+/**
+ * @related mf_reverb_send_tilde
+ * @brief Frees our object<br>
+ * @param x A pointer the mf_reverb_send_tilde object <br>
+ */
+void mf_reverb_send_tilde_free(mf_reverb_send_tilde *x)
+{
+    mf_reverb_bus_release(x->bus, 0);
+}
+
+/**
+ * @related mf_reverb_send_tilde
+ * @brief Creates a new mf_reverb_send~ object.<br>
+ * @param name The name of the bus, the same as in the bus message of mf_reverb~ <br>
+ */
+void *mf_reverb_send_tilde_new(t_symbol *name)
+{
+    mf_reverb_send_tilde *x = (mf_reverb_send_tilde *)pd_new(mf_reverb_send_tilde_class);
+    x->f = 0;
+    x->bus = mf_reverb_bus_get(name, 0);
+    return (void *)x;
+}
+
+void mf_reverb_send_tilde_setup(void)
+{
+    mf_reverb_bus_class = class_new(gensym("mf_reverb_bus"), 0, 0, sizeof(mf_reverb_bus), CLASS_PD, 0);
+
+    mf_reverb_send_tilde_class = class_new(gensym("mf_reverb_send~"),
+        (t_newmethod)mf_reverb_send_tilde_new,
+        (t_method)mf_reverb_send_tilde_free,
+        sizeof(mf_reverb_send_tilde),
+        CLASS_DEFAULT,
+        A_DEFSYM, 0);
+
+    class_addmethod(mf_reverb_send_tilde_class, (t_method)mf_reverb_send_tilde_dsp, gensym("dsp"), 0);
+    class_addmethod(mf_reverb_send_tilde_class, (t_method)mf_reverb_send_tilde_set, gensym("set"), A_SYMBOL, 0);
+    CLASS_MAINSIGNALIN(mf_reverb_send_tilde_class, mf_reverb_send_tilde, f);
+}
@@ -0,0 +1,77 @@
+/**
+ * @file mf_reverb_send_pd.h
+ * @author Marquis Fields, Miguel Reyes Botello & Malte Schneider<br>
+ * Audiocommunication Group, Technical University Berlin <br>
+ * Send bus of mf_reverb~ <br>
+ * <br>
+ * @brief Named buses that mf_reverb_send~ objects sum into and mf_reverb~ reads <br>
+ * <br>
+ * A bus is a hidden Pd object bound to its name. It is created by the first <br>
+ * send or return that uses the name and freed with the last one. The vector <br>
+ * is only resized in the dsp methods, so the perform routines just add to it <br>
+ * and the return clears it after reading, without locks or allocation. Like <br>
+ * throw~ and catch~, a send that is sorted after the return in the DSP chain <br>
+ * arrives one block later. Sends and return have to run at the same block size. <br>
+ * <br>
+ */
+
+#ifndef mf_reverb_send_pd_h
+#define mf_reverb_send_pd_h
+#include "m_pd.h"
+
+/**
+ * @struct mf_reverb_bus
+ * @brief A named bus <br>
+ * @var mf_reverb_bus::b_pd The class pointer, needed to bind the bus to its name <br>
+ * @var mf_reverb_bus::name The name of the bus <br>
+ * @var mf_reverb_bus::users The number of sends and returns using the bus <br>
+ * @var mf_reverb_bus::returns The number of returns, without one the sends do not sum <br>
+ * @var mf_reverb_bus::size The length of the vector <br>
+ * @var mf_reverb_bus::vec The sum of the sends of the current block <br>
+ */
+
+typedef struct mf_reverb_bus
+{
+    t_pd b_pd;
+    t_symbol *name;
+    int users;
+    int returns;
+    int size;
+    t_sample *vec;
+} mf_reverb_bus;
+
+/**
+ * @related mf_reverb_bus
+ * @brief Finds the bus of the given name or creates it<br>
+ * @param name The name of the bus <br>
+ * @param isReturn True if the caller is a return <br>
+ * @return the bus, to be released with mf_reverb_bus_release <br>
+ */
+
+mf_reverb_bus *mf_reverb_bus_get(t_symbol *name, int isReturn);
+
+/**
+ * @related mf_reverb_bus
+ * @brief Releases a bus and frees it with its last user<br>
+ * @param x The bus <br>
+ * @param isReturn True if the caller is a return <br>
+ */
+
+void mf_reverb_bus_release(mf_reverb_bus *x, int isReturn);
+
+/**
+ * @related mf_reverb_bus
+ * @brief Makes sure the vector holds a block, only called from dsp methods<br>
+ * @param x The bus <br>
+ * @param n The block size <br>
+ */
+
+void mf_reverb_bus_resize(mf_reverb_bus *x, int n);
+
+/**
+ * @brief Setup of mf_reverb_send~, called by mf_reverb_tilde_setup<br>
+ */
+
+void mf_reverb_send_tilde_setup(void);
+
+#endif /* mf_reverb_send_pd_h */